@@ -0,0 +1,298 @@
+// randomizor-stream: writes raw engine output to stdout at memory speed, e.g., for
+//
+//     randomizor-stream --engine xoshiro256plus | RNG_test stdin64
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread randomizor-stream.cpp -o randomizor-stream
+//
+// Options:
+//     --engine xoshiro256plus | splitmix64 | pcg32     (default xoshiro256plus)
+//              or any other engine of src/Xoshiro.hpp: xoshiro256plusplus, xoshiro256starstar,
+//              xoshiro128plus, xoshiro128plusplus, xoshiro128starstar, xoroshiro128plus,
+//              xoroshiro128plusplus, xoroshiro128starstar
+//     --output raw | uniform | normal                  (default raw)
+//     --lanes  N      number of interleaved engines    (default 16)
+//     --seed   S                                       (default 0)
+//     --bytes  N      stop after N bytes; 0 = never    (default 0)
+//     --stats         report throughput on stderr
+//
+// raw writes the engine output words in native byte order. uniform and normal write float32 in the
+// exact layout of the Metal kernels, with one lane per GPU thread (see src/Lanes.hpp).
+// The output of splitmix64 and pcg32 is the scalar stream for every lane count; the xoshiro
+// engines interleave lanes that are one Jump() apart (--lanes 1 gives the scalar stream).
+//
+// If stdout is a pipe, the buffers are handed to the pipe with vmsplice, without copying.
+
+#define NDEBUG
+
+#include <iostream>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../Randomizor_CPU.hpp"
+#include "../src/PCG.hpp"
+#include "../src/Lanes.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+// Writes n bytes to fd. Returns false if the reader went away or on error.
+bool Emit( const int fd, const unsigned char * p, size_t n, bool & use_vmsplice )
+{
+    while( n > 0 )
+    {
+        ssize_t written;
+
+#if defined(__linux__)
+        if( use_vmsplice )
+        {
+            struct iovec iov { const_cast<unsigned char *>(p), n };
+
+            written = ::vmsplice( fd, &iov, 1, 0 );
+
+            if( (written < 0) && ((errno == EINVAL) || (errno == EBADF) || (errno == ENOSYS)) )
+            {
+                use_vmsplice = false;
+                continue;
+            }
+        }
+        else
+#endif
+        {
+            written = ::write( fd, p, n );
+        }
+
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        p += written;
+        n -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+// Fills buffer with bytes bytes from lanes; bytes must be a multiple of 16 * lanes.LaneCount().
+template<typename Lanes_T>
+void Generate( Lanes_T & lanes, const std::string & output, unsigned char * buffer, const size_t bytes, std::vector<std::uint32_t> & bits )
+{
+    using R = typename Lanes_T::result_type;
+
+    const size_t L = lanes.LaneCount();
+
+    if( output == "uniform" )
+    {
+        Randomizor::Uniform_Chunks( lanes, reinterpret_cast<float *>(buffer), bytes / (16 * L), bits.data() );
+    }
+    else if( output == "normal" )
+    {
+        Randomizor::Normal_Chunks( lanes, reinterpret_cast<float *>(buffer), bytes / (16 * L), bits.data() );
+    }
+    else
+    {
+        R * out = reinterpret_cast<R *>(buffer);
+
+        const size_t rounds = bytes / (sizeof(R) * L);
+
+        for( size_t r = 0; r < rounds; ++r )
+        {
+            lanes.Next( &out[r * L] );
+        }
+    }
+}
+
+template<typename Lanes_T>
+int Run( Lanes_T & lanes, const std::string & output, const size_t limit, const bool stats )
+{
+    const int fd = STDOUT_FILENO;
+
+    bool use_vmsplice = false;
+
+    size_t buffer_bytes = size_t(1) << 20;
+
+#if defined(__linux__) && defined(F_SETPIPE_SZ)
+    // Zero-copy hand-over requires that a buffer is not overwritten while its pages are still in
+    // the pipe. With two buffers of the pipe's capacity, vmsplice of one buffer can only complete
+    // after the reader has drained the other one.
+    if( ::fcntl( fd, F_SETPIPE_SZ, static_cast<int>(buffer_bytes) ) >= 0 || ::fcntl( fd, F_GETPIPE_SZ ) > 0 )
+    {
+        buffer_bytes = static_cast<size_t>( ::fcntl( fd, F_GETPIPE_SZ ) );
+        use_vmsplice = true;
+    }
+#endif
+
+    const size_t granularity = 16 * lanes.LaneCount();
+
+    if( buffer_bytes % granularity != 0 )
+    {
+        // The buffers would not match the pipe's capacity; copy instead.
+        use_vmsplice = false;
+
+        buffer_bytes = std::max( granularity, (buffer_bytes / granularity) * granularity );
+    }
+
+    const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+    unsigned char * buffers [2];
+
+    for( auto & buffer : buffers )
+    {
+        buffer = static_cast<unsigned char *>(
+            std::aligned_alloc( page_size, ((buffer_bytes + page_size - 1) / page_size) * page_size )
+        );
+    }
+
+    std::vector<std::uint32_t> bits ( 4 * lanes.LaneCount() );
+
+    size_t total = 0;
+
+    const auto start = Clock::now();
+
+    for( size_t k = 0; (limit == 0) || (total < limit); k ^= 1 )
+    {
+        Generate( lanes, output, buffers[k], buffer_bytes, bits );
+
+        const size_t n = (limit == 0) ? buffer_bytes : std::min( buffer_bytes, limit - total );
+
+        if( !Emit( fd, buffers[k], n, use_vmsplice ) )
+        {
+            break;
+        }
+
+        total += n;
+    }
+
+    if( stats )
+    {
+        const double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cerr << "randomizor-stream: " << total << " bytes in " << time << " s = "
+                  << static_cast<double>(total) / time * 1e-9 << " GB/s"
+                  << (use_vmsplice ? " (vmsplice)" : " (write)") << std::endl;
+    }
+
+    for( auto & buffer : buffers )
+    {
+        std::free( buffer );
+    }
+
+    return 0;
+}
+
+// Runs the xoshiro engine Engine if name is its lower-case class name; returns -1 otherwise.
+template<typename Engine>
+int RunXoshiro(
+    const std::string & name, const std::uint64_t seed, const size_t lane_count,
+    const std::string & output, const size_t limit, const bool stats
+)
+{
+    std::string engine_name = Engine::ClassName();
+
+    for( char & c : engine_name )
+    {
+        c = static_cast<char>( std::tolower( static_cast<unsigned char>(c) ) );
+    }
+
+    if( name != engine_name )
+    {
+        return -1;
+    }
+
+    Randomizor::XoshiroLanes<Engine> lanes ( Engine( seed ), lane_count );
+
+    return Run( lanes, output, limit, stats );
+}
+
+int main(int argc, const char * argv[])
+{
+    std::string engine = "xoshiro256plus";
+    std::string output = "raw";
+    size_t      lane_count = 16;
+    std::uint64_t seed = 0;
+    size_t      limit  = 0;
+    bool        stats  = false;
+
+    for( int i = 1; i < argc; ++i )
+    {
+        const std::string arg   = argv[i];
+        const std::string value = (i + 1 < argc) ? std::string(argv[i+1]) : std::string();
+
+        try
+        {
+            if( arg == "--engine" )      { engine     = value;              ++i; }
+            else if( arg == "--output" ) { output     = value;              ++i; }
+            else if( arg == "--lanes" )  { lane_count = std::stoull(value); ++i; }
+            else if( arg == "--seed" )   { seed       = std::stoull(value); ++i; }
+            else if( arg == "--bytes" )  { limit      = std::stoull(value); ++i; }
+            else if( arg == "--stats" )  { stats      = true; }
+            else
+            {
+                std::cerr << "randomizor-stream: Unknown option " << arg << "." << std::endl;
+                return 1;
+            }
+        }
+        catch( ... )
+        {
+            std::cerr << "randomizor-stream: Invalid value \"" << value << "\" for " << arg << "." << std::endl;
+            return 1;
+        }
+    }
+
+    if( (output != "raw") && (output != "uniform") && (output != "normal") )
+    {
+        std::cerr << "randomizor-stream: Unknown output " << output << "." << std::endl;
+        return 1;
+    }
+
+    lane_count = std::max( size_t(1), lane_count );
+
+    // A reader that exits early (e.g., head) ends the stream normally.
+    std::signal( SIGPIPE, SIG_IGN );
+
+    for( auto run : {
+        RunXoshiro<Randomizor::Xoshiro256Plus>,       RunXoshiro<Randomizor::Xoshiro256PlusPlus>,
+        RunXoshiro<Randomizor::Xoshiro256StarStar>,   RunXoshiro<Randomizor::Xoshiro128Plus>,
+        RunXoshiro<Randomizor::Xoshiro128PlusPlus>,   RunXoshiro<Randomizor::Xoshiro128StarStar>,
+        RunXoshiro<Randomizor::Xoroshiro128Plus>,     RunXoshiro<Randomizor::Xoroshiro128PlusPlus>,
+        RunXoshiro<Randomizor::Xoroshiro128StarStar>
+    } )
+    {
+        const int result = run( engine, seed, lane_count, output, limit, stats );
+
+        if( result >= 0 )
+        {
+            return result;
+        }
+    }
+
+    if( engine == "splitmix64" )
+    {
+        Randomizor::SplitMix64Lanes lanes ( seed, lane_count );
+
+        return Run( lanes, output, limit, stats );
+    }
+    else if( engine == "pcg32" )
+    {
+        Randomizor::PCG32Lanes lanes ( Randomizor::PCG32( seed ), lane_count );
+
+        return Run( lanes, output, limit, stats );
+    }
+
+    std::cerr << "randomizor-stream: Unknown engine " << engine << "." << std::endl;
+
+    return 1;
+}
@@ -0,0 +1,79 @@
+// randomizor-tune: measures the tuning profile of Randomizor_CPU on this machine (see
+// src/Tuning.hpp) and writes it to a file, e.g.,
+//
+//     randomizor-tune --output ~/.randomizor.profile
+//
+// Programs then load it at startup with
+//
+//     TuningProfile profile;
+//     profile.Load( path );
+//     Randomizor_CPU gen ( 1024, profile.CPU_thread_count );
+//     gen.ApplyProfile( profile );
+//
+// or measure and save it on first use with Randomizor_CPU::LoadOrAutotune( path ).
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread randomizor-tune.cpp -o randomizor-tune
+//
+// Options:
+//     --output  PATH   where to write the profile      (default randomizor.profile)
+//     --threads N      largest thread count to try     (default: all hardware threads)
+//     --reps    N      repetitions per measurement     (default 7)
+
+#define NDEBUG
+
+#include <iostream>
+#include <cstdlib>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+int main( int argc, char ** argv )
+{
+    std::string path    = "randomizor.profile";
+    size_t      threads = 0;
+    size_t      reps    = 7;
+
+    for( int i = 1; i < argc; ++i )
+    {
+        const std::string arg = argv[i];
+
+        if( i + 1 >= argc )
+        {
+            std::cerr << "Missing value for " << arg << "." << std::endl;
+            return 1;
+        }
+
+        const std::string value = argv[++i];
+
+        if( arg == "--output" )
+        {
+            path = value;
+        }
+        else if( arg == "--threads" )
+        {
+            threads = std::strtoull( value.c_str(), nullptr, 10 );
+        }
+        else if( arg == "--reps" )
+        {
+            reps = std::max<size_t>( 1, std::strtoull( value.c_str(), nullptr, 10 ) );
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << "." << std::endl;
+            return 1;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const Randomizor::TuningProfile profile = Randomizor::Randomizor_CPU::Autotune( threads, reps );
+
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << profile.Text();
+    std::cerr << "Measured in " << time << " s." << std::endl;
+
+    return profile.Save( path ) ? 0 : 1;
+}
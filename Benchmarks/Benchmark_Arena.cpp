@@ -0,0 +1,180 @@
+// Page faults and dTLB misses of a workload that repeatedly resizes its reservoir:
+// a fresh std::vector per request versus one Arena that grows in place.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_Arena.cpp -o Benchmark_Arena
+//
+// dTLB misses are read with perf_event_open; if that is not permitted
+// (see /proc/sys/kernel/perf_event_paranoid), they are reported as -1.
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include <sys/resource.h>
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+#endif
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+class TLBCounter
+{
+public:
+
+    TLBCounter()
+    {
+#if defined(__linux__)
+        perf_event_attr attr = {};
+        attr.size           = sizeof(perf_event_attr);
+        attr.type           = PERF_TYPE_HW_CACHE;
+        attr.config         = PERF_COUNT_HW_CACHE_DTLB
+                            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        fd = static_cast<int>( ::syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+#endif
+    }
+
+    ~TLBCounter()
+    {
+        if( fd >= 0 )
+        {
+            ::close( fd );
+        }
+    }
+
+    void Start()
+    {
+#if defined(__linux__)
+        if( fd >= 0 )
+        {
+            ::ioctl( fd, PERF_EVENT_IOC_RESET,  0 );
+            ::ioctl( fd, PERF_EVENT_IOC_ENABLE, 0 );
+        }
+#endif
+    }
+
+    long long Stop()
+    {
+        long long count = -1;
+#if defined(__linux__)
+        if( fd >= 0 )
+        {
+            ::ioctl( fd, PERF_EVENT_IOC_DISABLE, 0 );
+
+            if( ::read( fd, &count, sizeof(count) ) != sizeof(count) )
+            {
+                count = -1;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+
+    int fd = -1;
+};
+
+long MinorFaults()
+{
+    struct rusage usage;
+    ::getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_minflt;
+}
+
+template<typename F>
+void Measure( const std::string & name, F && workload )
+{
+    TLBCounter tlb;
+
+    const long faults = MinorFaults();
+
+    tlb.Start();
+
+    const auto start = Clock::now();
+
+    workload();
+
+    const double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const long long tlb_misses = tlb.Stop();
+
+    std::cout << name << " | " << time << " | " << (MinorFaults() - faults) << " | " << tlb_misses << std::endl;
+}
+
+int main(int argc, const char * argv[])
+{
+    const size_t max_n        = (argc > 1) ? std::stoull(argv[1]) : (size_t(1) << 28);
+    const size_t request_count = 64;
+
+    // Sizes jump up and down between max_n/64 and max_n.
+    std::vector<size_t> sizes ( request_count );
+    {
+        std::mt19937_64 engine ( 1 );
+        std::uniform_real_distribution<double> dist ( std::log2(max_n) - 6., std::log2(max_n) );
+
+        for( auto & n : sizes )
+        {
+            n = static_cast<size_t>( std::exp2( dist(engine) ) ) / 4 * 4;
+        }
+    }
+
+    const size_t thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+
+    std::cout << "workload | time [s] | minor page faults | dTLB read misses" << std::endl;
+
+    {
+        Randomizor::Randomizor_CPU gen ( 64 * thread_count, thread_count );
+        gen.Seed( std::uint64_t(1) );
+
+        Measure( "std::vector per request",
+            [&]()
+            {
+                for( const size_t n : sizes )
+                {
+                    std::vector<float> b ( n );
+                    gen.LoadReservoir( b.data(), n );
+                    gen.Fill_Uniform();
+                }
+            }
+        );
+    }
+
+    {
+        Randomizor::Randomizor_CPU gen ( 64 * thread_count, thread_count );
+        gen.Seed( std::uint64_t(1) );
+
+        Measure( "arena",
+            [&]()
+            {
+                for( const size_t n : sizes )
+                {
+                    gen.RequireReservoir( n );
+                    gen.Fill_Uniform();
+                }
+            }
+        );
+    }
+
+    {
+        Randomizor::Arena arena ( size_t(1) << 30, Randomizor::Arena::HugePages::Explicit );
+
+        valprint( "explicit huge pages available", arena.ExplicitHugePages() );
+    }
+
+    return 0;
+}
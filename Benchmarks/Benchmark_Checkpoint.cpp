@@ -0,0 +1,73 @@
+// Save and restore of a Randomizor_CPU with one million streams.
+// Checks that a restored generator continues exactly where the saved one stopped.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_Checkpoint.cpp -o Benchmark_Checkpoint
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, const char * argv[])
+{
+    const std::string path = (argc > 1) ? std::string(argv[1]) : std::string("Randomizor_checkpoint.bin");
+    
+    const size_t stream_count     = size_t(1) << 20;
+    const size_t CPU_thread_count = 8;
+    const size_t n                = size_t(1) << 24;
+    
+    Randomizor::Randomizor_CPU gen ( stream_count, CPU_thread_count );
+    
+    gen.Seed( std::uint64_t(20230626) );
+    gen.RequireReservoir( n );
+    gen.Fill_Normal();
+    
+    auto start = Clock::now();
+    
+    gen.Save( path );
+    
+    const double t_save = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    gen.Fill_Normal();
+    
+    std::vector<float> expected ( gen.Reservoir(), gen.Reservoir() + n );
+    
+    Randomizor::Randomizor_CPU restored ( stream_count, CPU_thread_count );
+    
+    start = Clock::now();
+    
+    const bool success = restored.Load( path );
+    
+    const double t_load = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    start = Clock::now();
+    
+    restored.Load( path, false );
+    
+    const double t_load_unverified = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    restored.RequireReservoir( n );
+    restored.Fill_Normal();
+    
+    const bool identical = std::equal( expected.begin(), expected.end(), restored.Reservoir() );
+    
+    valprint("streams                   ", stream_count      );
+    valprint("checkpoint size [MiB]     ", static_cast<double>(stream_count * sizeof(Randomizor::Xoshiro256Plus::state_type)) / (1024. * 1024.) );
+    valprint("save [ms]                 ", 1000. * t_save    );
+    valprint("load, verified [ms]       ", 1000. * t_load    );
+    valprint("load, unverified [ms]     ", 1000. * t_load_unverified );
+    valprint("load succeeded            ", success           );
+    valprint("continuation is identical ", identical         );
+    
+    std::remove( path.c_str() );
+    
+    return (success && identical) ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+// Throughput of the conversion policies of src/Helpers.hpp, for every ISA level that the machine
+// supports, both for the bare conversion of precomputed bits and for the full uniform kernel.
+// Also reports the smallest and largest value that each policy produced.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -pthread Benchmark_Conversion.cpp -o Benchmark_Conversion
+// (without -march=native, so that the dispatch has something to choose from).
+
+#define NDEBUG
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+using namespace Randomizor;
+
+using Clock = std::chrono::steady_clock;
+
+template<typename F>
+double Throughput( F && f, const size_t bytes, const size_t repetitions = 10 )
+{
+    f();
+
+    double t_min = std::numeric_limits<double>::max();
+
+    for( size_t rep = 0; rep < repetitions; ++rep )
+    {
+        const auto start = Clock::now();
+        f();
+        t_min = std::min( t_min, std::chrono::duration<double>(Clock::now() - start).count() );
+    }
+
+    return static_cast<double>(bytes) / t_min * 1e-9;
+}
+
+template<typename Conversion>
+void Run( const std::string & name, const std::vector<std::uint64_t> & bits, std::vector<float> & a )
+{
+    const size_t n = a.size();
+
+    for( ISA isa : { ISA::Generic, ISA::AVX2, ISA::AVX512 } )
+    {
+        if( !Supports( isa ) )
+        {
+            continue;
+        }
+
+        UniformFromBits_Kernel_T convert;
+        Uniform_Kernel_T<>       uniform;
+
+        switch( isa )
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            case ISA::AVX2:
+            {
+                convert = Kernels_AVX2::UniformFromBits<Conversion>;
+                uniform = Kernels_AVX2::Uniform<Conversion>;
+                break;
+            }
+            case ISA::AVX512:
+            {
+                convert = Kernels_AVX512::UniformFromBits<Conversion>;
+                uniform = Kernels_AVX512::Uniform<Conversion>;
+                break;
+            }
+#endif
+            default:
+            {
+                convert = Kernels_Generic::UniformFromBits<Conversion>;
+                uniform = Kernels_Generic::Uniform<Conversion>;
+                break;
+            }
+        }
+
+        const double conversion_bw = Throughput( [&](){ convert( bits.data(), a.data(), n ); }, n * sizeof(float) );
+
+        Xoshiro256Plus random_engine ( 1 );
+
+        const double kernel_bw = Throughput( [&](){ uniform( random_engine, a.data(), n ); }, n * sizeof(float) );
+
+        const auto [min, max] = std::minmax_element( a.begin(), a.end() );
+
+        std::cout << name << " | " << ISAName(isa) << " | " << conversion_bw << " | " << kernel_bw
+                  << " | " << *min << " | " << *max << std::endl;
+    }
+}
+
+int main()
+{
+    const size_t n = size_t(1) << 22;
+
+    std::vector<std::uint64_t> bits ( n );
+    std::vector<float>         a    ( n );
+
+    Xoshiro256Plus random_engine ( 0 );
+
+    for( auto & b : bits )
+    {
+        b = random_engine();
+    }
+
+    std::cout << std::setprecision(9);
+
+    std::cout << "policy | ISA | conversion [GB/s] | uniform kernel [GB/s] | min | max" << std::endl;
+
+    Run<Conversion_Standard>  ( "standard [0,1)",     bits, a );
+    Run<Conversion_ExponentOR>( "exponent-OR [0,1)",  bits, a );
+    Run<Conversion_OpenClosed>( "(0,1]",              bits, a );
+    Run<Conversion_Open>      ( "(0,1)",              bits, a );
+    Run<Conversion_Dense>     ( "dense [2^-42,1)",    bits, a );
+
+    return 0;
+}
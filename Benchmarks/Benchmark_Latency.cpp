@@ -0,0 +1,81 @@
+// Per-request latency of small Fill_Normal requests issued from several request-handling threads,
+// once through the inline path (the calling thread alone) and once forced through the thread pool.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_Latency.cpp -o Benchmark_Latency
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+int main()
+{
+    const size_t request_thread_count = 4;
+    const size_t CPU_thread_count     = 8;
+    const size_t request_count        = 20000;  // per request thread
+    
+    Randomizor::Randomizor_CPU gen ( 1024, CPU_thread_count );
+    
+    gen.RequireSeed();
+    gen.TuneInlineThreshold();
+    
+    valprint("tuned inline threshold", gen.InlineThreshold() );
+    
+    const size_t tuned_threshold = gen.InlineThreshold();
+    
+    std::cout << "path   | size  | p50 [us] | p99 [us]" << std::endl;
+    
+    for( const size_t threshold : { tuned_threshold, size_t(0) } )
+    {
+        gen.SetInlineThreshold( threshold );
+        
+        for( const size_t n : { size_t(10), size_t(100), size_t(1000), size_t(10000) } )
+        {
+            std::vector<std::vector<double>> latencies ( request_thread_count, std::vector<double>( request_count ) );
+            
+            ParallelDo(
+                [&]( const size_t thread )
+                {
+                    std::vector<float> a ( n );
+                    
+                    std::vector<double> & l = latencies[thread];
+                    
+                    for( size_t r = 0; r < request_count; ++r )
+                    {
+                        const auto start = Clock::now();
+                        
+                        gen.Fill_Normal( a.data(), n );
+                        
+                        l[r] = std::chrono::duration<double,std::micro>(Clock::now() - start).count();
+                    }
+                },
+                request_thread_count
+            );
+            
+            std::vector<double> all;
+            
+            for( const auto & l : latencies )
+            {
+                all.insert( all.end(), l.begin(), l.end() );
+            }
+            
+            std::sort( all.begin(), all.end() );
+            
+            std::cout
+                << (n <= threshold ? "inline" : "pool  ") << " | "
+                << n << " | "
+                << all[all.size() / 2] << " | "
+                << all[(all.size() * 99) / 100] << std::endl;
+        }
+    }
+    
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Cost of the metrics on small requests, which is where it matters most, and a dump of the
+// collected counters. Build it twice, with and without -DRANDOMIZOR_METRICS, and compare the time
+// per call; without the flag the export is empty.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread -DRANDOMIZOR_METRICS Benchmark_Metrics.cpp -o Benchmark_Metrics
+
+#define NDEBUG
+
+#include <iostream>
+
+#include "../Randomizor_CPU.hpp"
+#include "../Randomizor_QMC.hpp"
+
+using namespace Tools;
+using namespace Randomizor;
+
+using Clock = std::chrono::steady_clock;
+
+int main()
+{
+    const size_t thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+
+    Randomizor_CPU gen ( 64 * thread_count, thread_count );
+
+    gen.Seed( std::uint64_t(0) );
+
+    std::vector<float> a ( size_t(1) << 22 );
+
+    for( size_t n : { size_t(16), size_t(256), size_t(4096) } )
+    {
+        const size_t calls = (size_t(1) << 24) / n;
+
+        const auto start = Clock::now();
+
+        for( size_t k = 0; k < calls; ++k )
+        {
+            gen.Fill_Normal( a.data(), n );
+        }
+
+        const double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << "Fill_Normal( a, " << n << " ): " << time / static_cast<double>(calls) * 1e9 << " ns per call" << std::endl;
+    }
+
+    gen.RequireReservoir( a.size() );
+    gen.Fill_Uniform();
+    gen.Fill_Normal();
+    gen.Fill_Uniform( a.data(), a.size() );
+
+    Randomizor_QMC<Sobol> sobol ( 8, Scrambling::Owen, 0, thread_count );
+
+    sobol.Fill_Uniform( a.data(), a.size() );
+
+    std::cout << std::endl << Metrics::ToJSON() << std::endl << Metrics::ToPrometheus();
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Fill bandwidth with a reservoir that was zeroed by a single thread (thus placed on one NUMA node)
+// versus a reservoir that was first touched by the pinned threads that fill it.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_NUMA.cpp -o Benchmark_NUMA
+//
+// Usage: Benchmark_NUMA [reservoir size in GiB, default 4]
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+template<typename F>
+double Bandwidth( F && fill, const size_t bytes, const size_t repetitions = 5 )
+{
+    fill();
+    
+    double t_min = std::numeric_limits<double>::max();
+    
+    for( size_t rep = 0; rep < repetitions; ++rep )
+    {
+        const auto start = Clock::now();
+        fill();
+        t_min = std::min( t_min, std::chrono::duration<double>(Clock::now() - start).count() );
+    }
+    
+    return static_cast<double>(bytes) / t_min * 1e-9;
+}
+
+int main(int argc, const char * argv[])
+{
+    const double GiB = (argc > 1) ? std::atof(argv[1]) : 4.;
+    
+    const size_t n = static_cast<size_t>( GiB * 1024. * 1024. * 1024. / sizeof(float) ) / 4 * 4;
+    
+    const auto nodes = Randomizor::NUMANodeCPUs();
+    
+    size_t cpu_count = 0;
+    
+    for( size_t node = 0; node < nodes.size(); ++node )
+    {
+        valprint("CPUs on NUMA node " + ToString(node), nodes[node].size() );
+        cpu_count += nodes[node].size();
+    }
+    
+    std::cout << "threads | one-node reservoir [GB/s] | first-touch + pinned [GB/s]" << std::endl;
+    
+    for( size_t thread_count = 1; thread_count <= cpu_count; thread_count *= 2 )
+    {
+        const size_t stream_count = 64 * thread_count;
+        
+        double one_node;
+        {
+            // Zeroed by the main thread: all pages end up on the main thread's node.
+            std::vector<float> b ( n );
+            
+            Randomizor::Randomizor_CPU gen ( stream_count, thread_count, false );
+            
+            gen.Seed( std::uint64_t(1) );
+            gen.LoadReservoir( b.data(), n );
+            
+            one_node = Bandwidth( [&](){ gen.Fill_Uniform(); }, n * sizeof(float) );
+        }
+        
+        double first_touch;
+        {
+            Randomizor::Randomizor_CPU gen ( stream_count, thread_count, true );
+            
+            gen.Seed( std::uint64_t(1) );
+            gen.RequireReservoir( n );
+            
+            first_touch = Bandwidth( [&](){ gen.Fill_Uniform(); }, n * sizeof(float) );
+        }
+        
+        std::cout << thread_count << " | " << one_node << " | " << first_touch << std::endl;
+    }
+    
+    return 0;
+}
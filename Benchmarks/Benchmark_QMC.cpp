@@ -0,0 +1,136 @@
+// Integration error and fill throughput of the quasi-random samplers, compared with Randomizor_CPU.
+// The integrand is prod_j (1 + (x_j - 1/2) / j) over the unit cube, whose integral is 1; the
+// scrambled sequences report the RMS error over independent seeds.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_QMC.cpp -o Benchmark_QMC
+
+#define NDEBUG
+
+#include <iostream>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+#include "../Randomizor_QMC.hpp"
+
+using namespace Tools;
+using namespace Randomizor;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t dimension = 8;
+constexpr size_t seed_count = 8;
+
+double Integral( const std::vector<float> & a, const size_t point_count )
+{
+    double sum = 0;
+
+    for( size_t i = 0; i < point_count; ++i )
+    {
+        double f = 1;
+
+        for( size_t j = 0; j < dimension; ++j )
+        {
+            f *= 1. + (static_cast<double>(a[dimension * i + j]) - 0.5) / static_cast<double>(j + 1);
+        }
+
+        sum += f;
+    }
+
+    return sum / static_cast<double>(point_count);
+}
+
+// Fills with fill( seed, pointer, count ) and returns the RMS error over the seeds.
+template<typename F>
+double RMSError( F && fill, const size_t point_count )
+{
+    std::vector<float> a ( dimension * point_count );
+
+    double sum = 0;
+
+    for( size_t seed = 0; seed < seed_count; ++seed )
+    {
+        fill( seed, a.data(), a.size() );
+
+        const double error = Integral( a, point_count ) - 1.;
+
+        sum += error * error;
+    }
+
+    return std::sqrt( sum / seed_count );
+}
+
+template<typename Sampler_T>
+double Throughput( Sampler_T & sampler, const size_t n )
+{
+    std::vector<float> a ( n );
+
+    sampler.Fill_Uniform( a.data(), n );
+
+    const auto start = Clock::now();
+    sampler.Fill_Uniform( a.data(), n );
+    const double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return static_cast<double>(n * sizeof(float)) / time * 1e-9;
+}
+
+int main()
+{
+    const size_t thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+
+    std::cout << "points | pseudo-random | Sobol (Owen) | Sobol (shift) | Halton (Owen)" << std::endl;
+
+    for( size_t point_count = size_t(1) << 10; point_count <= (size_t(1) << 20); point_count *= 4 )
+    {
+        const double e_prng = RMSError(
+            [&]( const size_t seed, float * a, const size_t n )
+            {
+                Randomizor_CPU gen ( 64, thread_count );
+                gen.Seed( static_cast<std::uint64_t>(seed) );
+                gen.Fill_Uniform( a, n );
+            },
+            point_count
+        );
+
+        const double e_sobol = RMSError(
+            [&]( const size_t seed, float * a, const size_t n )
+            {
+                Randomizor_QMC<Sobol> gen ( dimension, Scrambling::Owen, seed, thread_count );
+                gen.Fill_Uniform( a, n );
+            },
+            point_count
+        );
+
+        const double e_shift = RMSError(
+            [&]( const size_t seed, float * a, const size_t n )
+            {
+                Randomizor_QMC<Sobol> gen ( dimension, Scrambling::DigitalShift, seed, thread_count );
+                gen.Fill_Uniform( a, n );
+            },
+            point_count
+        );
+
+        const double e_halton = RMSError(
+            [&]( const size_t seed, float * a, const size_t n )
+            {
+                Randomizor_QMC<Halton> gen ( dimension, Scrambling::Owen, seed, thread_count );
+                gen.Fill_Uniform( a, n );
+            },
+            point_count
+        );
+
+        std::cout << point_count << " | " << e_prng << " | " << e_sobol << " | " << e_shift << " | " << e_halton << std::endl;
+    }
+
+    const size_t n = dimension * (size_t(1) << 22);
+
+    Randomizor_CPU         prng   ( 64 * thread_count, thread_count );
+    Randomizor_QMC<Sobol>  sobol  ( dimension, Scrambling::Owen, 0, thread_count );
+    Randomizor_QMC<Halton> halton ( dimension, Scrambling::Owen, 0, thread_count );
+
+    std::cout << std::endl;
+    std::cout << "Fill_Uniform [GB/s]: pseudo-random " << Throughput( prng, n )
+              << ", Sobol " << Throughput( sobol, n ) << ", Halton " << Throughput( halton, n ) << std::endl;
+
+    return 0;
+}
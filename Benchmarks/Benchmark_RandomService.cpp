@@ -0,0 +1,113 @@
+// Many worker threads that need a few thousand normals per tick:
+// per-thread engines versus one RandomService that coalesces the requests into bulk fills.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_RandomService.cpp -o Benchmark_RandomService
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+#include "../src/RandomService.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+int main()
+{
+    const size_t worker_count     = 32;
+    const size_t tick_count       = 200;
+    const size_t CPU_thread_count = 8;
+    
+    std::cout << "samples per tick | per-thread engines [Msamples/s] | RandomService [Msamples/s] | batches | p99 latency [us]" << std::endl;
+    
+    for( const size_t n : { size_t(1000), size_t(4000), size_t(16000) } )
+    {
+        const double total = static_cast<double>(worker_count * tick_count * n);
+        
+        // Per-thread engines.
+        double t_engines;
+        {
+            const auto start = Clock::now();
+            
+            ParallelDo(
+                [&]( const size_t thread )
+                {
+                    Randomizor::Xoshiro256Plus random_engine ( static_cast<std::uint64_t>(thread) );
+                    
+                    std::vector<float> a ( n );
+                    
+                    for( size_t tick = 0; tick < tick_count; ++tick )
+                    {
+                        Randomizor::Normal_Kernel( random_engine, a.data(), n );
+                    }
+                },
+                worker_count
+            );
+            
+            t_engines = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        
+        // RandomService.
+        double t_service;
+        size_t batch_count;
+        double p99;
+        {
+            Randomizor::Randomizor_CPU gen ( 1024, CPU_thread_count );
+            
+            gen.RequireSeed();
+            gen.SetInlineThreshold(0);
+            
+            Randomizor::RandomService<Randomizor::Randomizor_CPU> service ( gen, worker_count * n / 2 );
+            
+            std::vector<std::vector<double>> latencies ( worker_count, std::vector<double>( tick_count ) );
+            
+            const auto start = Clock::now();
+            
+            ParallelDo(
+                [&]( const size_t thread )
+                {
+                    std::vector<float> a ( n );
+                    
+                    for( size_t tick = 0; tick < tick_count; ++tick )
+                    {
+                        const auto request_start = Clock::now();
+                        
+                        service.Fill_Normal( a.data(), n );
+                        
+                        latencies[thread][tick] = std::chrono::duration<double,std::micro>(Clock::now() - request_start).count();
+                    }
+                },
+                worker_count
+            );
+            
+            t_service = std::chrono::duration<double>(Clock::now() - start).count();
+            
+            batch_count = service.BatchCount();
+            
+            std::vector<double> all;
+            
+            for( const auto & l : latencies )
+            {
+                all.insert( all.end(), l.begin(), l.end() );
+            }
+            
+            std::sort( all.begin(), all.end() );
+            
+            p99 = all[(all.size() * 99) / 100];
+        }
+        
+        std::cout
+            << n << " | "
+            << total / t_engines * 1e-6 << " | "
+            << total / t_service * 1e-6 << " | "
+            << batch_count << " | "
+            << p99 << std::endl;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Fill bandwidth with ordinary (cached) stores versus non-temporal streaming stores,
+// for reservoirs below and above the size of the last-level cache.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_StreamingStore.cpp -o Benchmark_StreamingStore
+//
+// Usage: Benchmark_StreamingStore [thread count, default hardware_concurrency]
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+template<typename F>
+double Bandwidth( F && fill, const size_t bytes, const size_t repetitions = 5 )
+{
+    fill();
+
+    double t_min = std::numeric_limits<double>::max();
+
+    for( size_t rep = 0; rep < repetitions; ++rep )
+    {
+        const auto start = Clock::now();
+        fill();
+        t_min = std::min( t_min, std::chrono::duration<double>(Clock::now() - start).count() );
+    }
+
+    return static_cast<double>(bytes) / t_min * 1e-9;
+}
+
+int main(int argc, const char * argv[])
+{
+    const size_t thread_count = (argc > 1)
+                              ? std::stoull(argv[1])
+                              : std::max( 1u, std::thread::hardware_concurrency() );
+
+    const size_t llc = Randomizor::LastLevelCacheSize();
+
+    valprint( "last-level cache [bytes]", llc );
+
+    Randomizor::Randomizor_CPU gen ( 64 * thread_count, thread_count );
+
+    gen.Seed( std::uint64_t(1) );
+
+    std::cout << "reservoir [MiB] | uniform cached [GB/s] | uniform streaming [GB/s] | normal cached [GB/s] | normal streaming [GB/s] | identical" << std::endl;
+
+    for( size_t bytes = llc / 8; bytes <= 16 * llc; bytes *= 4 )
+    {
+        const size_t n = bytes / sizeof(float) / 4 * 4;
+
+        gen.RequireReservoir( n );
+
+        double bw [4];
+
+        for( int normal = 0; normal < 2; ++normal )
+        {
+            for( int streaming = 0; streaming < 2; ++streaming )
+            {
+                gen.SetStreamingThreshold( streaming ? 0 : std::numeric_limits<size_t>::max() );
+
+                bw[2 * normal + streaming] = Bandwidth(
+                    [&]()
+                    {
+                        if( normal )
+                        {
+                            gen.Fill_Normal();
+                        }
+                        else
+                        {
+                            gen.Fill_Uniform();
+                        }
+                    },
+                    n * sizeof(float)
+                );
+            }
+        }
+
+        // Both modes must produce the same samples from the same states.
+        bool identical;
+        {
+            gen.Save( "Benchmark_StreamingStore.states" );
+
+            gen.SetStreamingThreshold( std::numeric_limits<size_t>::max() );
+            gen.Fill_Normal();
+            std::vector<float> cached ( gen.Reservoir(), gen.Reservoir() + n );
+
+            gen.Load( "Benchmark_StreamingStore.states", false );
+
+            gen.SetStreamingThreshold( 0 );
+            gen.Fill_Normal();
+
+            identical = std::equal( cached.begin(), cached.end(), gen.Reservoir() );
+
+            std::remove( "Benchmark_StreamingStore.states" );
+        }
+
+        std::cout << (bytes >> 20) << " | " << bw[0] << " | " << bw[1] << " | " << bw[2] << " | " << bw[3] << " | " << identical << std::endl;
+    }
+
+    return 0;
+}
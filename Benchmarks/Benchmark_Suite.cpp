@@ -0,0 +1,436 @@
+// Benchmark suite: sweeps engines x distributions x output types x sizes x thread counts and writes
+// the results as JSON, so that two releases can be compared run by run.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_Suite.cpp -o Benchmark_Suite
+//
+// Options (lists are comma-separated):
+//     --engines  xoshiro256plus,xoshiro256plusplus,xoshiro128plus,splitmix64,pcg32,mt19937_64,Randomizor_CPU
+//     --dists    uniform,normal,bits
+//     --types    f32,f64,u64         (bits only with u64; uniform and normal only with f32, f64)
+//     --threads  1,2,4,...           (default: powers of 2 up to the hardware concurrency)
+//     --min-bytes N                  (default 1024)
+//     --max-bytes N | ram            (default 2^28; ram means 60 % of the physical memory)
+//     --reps     N                   (default 5)
+//     --json     path                (default benchmark_suite.json)
+//
+// Sizes go up by factors of 4. Every configuration runs once for warm-up (which also faults in the
+// pages) and then reps times. The report contains the median, mean and standard deviation of the
+// time, and samples/s, GB/s and cycles/sample of the median run. Cycles are TSC (reference) cycles
+// summed over all threads; they are -1 where there is no TSC.
+//
+// The engines of the Randomizor family and the STL baseline (std::mt19937_64 with the std::
+// distributions) run in the same harness: the output is split into blocks, each with its own engine,
+// handed out by the ThreadPool. Randomizor_CPU measures the public Fill_Uniform / Fill_Normal /
+// Fill_Bits of the sampler (f32 and u64 only), including dispatch and streaming stores.
+
+#define NDEBUG
+
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <ctime>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#include "../Randomizor_CPU.hpp"
+#include "../src/PCG.hpp"
+
+using namespace Tools;
+using namespace Randomizor;
+
+using Clock = std::chrono::steady_clock;
+
+std::uint64_t Cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+constexpr bool has_cycles =
+#if defined(__x86_64__) || defined(__i386__)
+    true;
+#else
+    false;
+#endif
+
+std::vector<std::string> Split( const std::string & s )
+{
+    std::vector<std::string> result;
+
+    std::stringstream stream ( s );
+
+    std::string item;
+
+    while( std::getline( stream, item, ',' ) )
+    {
+        if( !item.empty() )
+        {
+            result.push_back( item );
+        }
+    }
+
+    return result;
+}
+
+struct Config
+{
+    std::string engine;
+    std::string dist;
+    std::string type;
+    size_t      bytes;
+    size_t      threads;
+};
+
+struct Measurement
+{
+    std::vector<double> times;
+    std::vector<double> cycles;
+};
+
+// Fills n samples of type T in blocks; kernel( engine, pointer, count ) fills one block.
+template<typename Engine, typename T, typename Kernel_T>
+void BlockFill( ThreadPool & pool, T * a, const size_t n, Kernel_T && kernel )
+{
+    constexpr size_t block_size = size_t(1) << 16;
+
+    const size_t block_count = (n + block_size - 1) / block_size;
+
+    pool.ParallelFor(
+        block_count,
+        [&]( const size_t k, const size_t thread )
+        {
+            (void)thread;
+
+            const size_t i_begin = k * block_size;
+            const size_t i_end   = std::min( i_begin + block_size, n );
+
+            Engine random_engine ( SplitMix64{ k }() );
+
+            kernel( random_engine, &a[i_begin], i_end - i_begin );
+        }
+    );
+}
+
+// Returns a function that fills the buffer for the configuration, or an empty one if the
+// combination does not exist.
+template<typename Engine>
+std::function<void(void *, size_t)> RandomizorEngineFill( ThreadPool & pool, const Config & c )
+{
+    if( c.type == "f32" && c.dist == "uniform" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<Engine>( pool, static_cast<float *>(p), n,
+                []( Engine & e, float * a, size_t m ) { Kernels<Engine>().uniform( e, a, m ); } );
+        };
+    }
+    if( c.type == "f32" && c.dist == "normal" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<Engine>( pool, static_cast<float *>(p), n,
+                []( Engine & e, float * a, size_t m ) { Kernels<Engine>().normal( e, a, m ); } );
+        };
+    }
+    if( c.type == "f64" && c.dist == "uniform" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<Engine>( pool, static_cast<double *>(p), n,
+                []( Engine & e, double * a, size_t m ) { Uniform_Kernel( e, a, m ); } );
+        };
+    }
+    if( c.type == "f64" && c.dist == "normal" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<Engine>( pool, static_cast<double *>(p), n,
+                []( Engine & e, double * a, size_t m ) { Normal_Kernel( e, a, m ); } );
+        };
+    }
+    if( c.type == "u64" && c.dist == "bits" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<Engine>( pool, static_cast<std::uint64_t *>(p), n,
+                []( Engine & e, std::uint64_t * a, size_t m ) { Kernels<Engine>().bits( e, a, m ); } );
+        };
+    }
+
+    return {};
+}
+
+template<typename T>
+std::function<void(void *, size_t)> STLFill( ThreadPool & pool, const std::string & dist )
+{
+    if( dist == "uniform" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<std::mt19937_64>( pool, static_cast<T *>(p), n,
+                []( std::mt19937_64 & e, T * a, size_t m )
+                {
+                    std::uniform_real_distribution<T> d;
+                    for( size_t i = 0; i < m; ++i ) { a[i] = d(e); }
+                }
+            );
+        };
+    }
+    if( dist == "normal" )
+    {
+        return [&pool]( void * p, size_t n ) {
+            BlockFill<std::mt19937_64>( pool, static_cast<T *>(p), n,
+                []( std::mt19937_64 & e, T * a, size_t m )
+                {
+                    std::normal_distribution<T> d;
+                    for( size_t i = 0; i < m; ++i ) { a[i] = d(e); }
+                }
+            );
+        };
+    }
+
+    return {};
+}
+
+std::function<void(void *, size_t)> MakeFill( ThreadPool & pool, std::unique_ptr<Randomizor_CPU> & sampler, const Config & c )
+{
+    if( c.engine == "xoshiro256plus"     ) { return RandomizorEngineFill<Xoshiro256Plus    >( pool, c ); }
+    if( c.engine == "xoshiro256plusplus" ) { return RandomizorEngineFill<Xoshiro256PlusPlus>( pool, c ); }
+    if( c.engine == "xoshiro128plus"     ) { return RandomizorEngineFill<Xoshiro128Plus    >( pool, c ); }
+    if( c.engine == "splitmix64"         ) { return RandomizorEngineFill<SplitMix64        >( pool, c ); }
+    if( c.engine == "pcg32"              ) { return RandomizorEngineFill<PCG32             >( pool, c ); }
+
+    if( c.engine == "mt19937_64" )
+    {
+        if( c.type == "f32" ) { return STLFill<float> ( pool, c.dist ); }
+        if( c.type == "f64" ) { return STLFill<double>( pool, c.dist ); }
+        if( c.type == "u64" && c.dist == "bits" )
+        {
+            return [&pool]( void * p, size_t n ) {
+                BlockFill<std::mt19937_64>( pool, static_cast<std::uint64_t *>(p), n,
+                    []( std::mt19937_64 & e, std::uint64_t * a, size_t m ) { for( size_t i = 0; i < m; ++i ) { a[i] = e(); } } );
+            };
+        }
+        return {};
+    }
+
+    if( c.engine == "Randomizor_CPU" )
+    {
+        if( !sampler || sampler->CPU_thread_count != c.threads )
+        {
+            sampler = std::make_unique<Randomizor_CPU>( 64 * c.threads, c.threads );
+            sampler->Seed( std::uint64_t(0) );
+        }
+
+        Randomizor_CPU * gen = sampler.get();
+
+        if( c.type == "f32" && c.dist == "uniform" ) { return [gen]( void * p, size_t n ) { gen->Fill_Uniform( static_cast<float *>(p), n ); }; }
+        if( c.type == "f32" && c.dist == "normal"  ) { return [gen]( void * p, size_t n ) { gen->Fill_Normal ( static_cast<float *>(p), n ); }; }
+        if( c.type == "u64" && c.dist == "bits"    ) { return [gen]( void * p, size_t n ) { gen->Fill_Bits   ( static_cast<std::uint64_t *>(p), n ); }; }
+        return {};
+    }
+
+    eprint("Benchmark_Suite: Unknown engine "+c.engine+".");
+
+    return {};
+}
+
+size_t TypeSize( const std::string & type )
+{
+    return (type == "f32") ? sizeof(float) : sizeof(double);
+}
+
+double Median( std::vector<double> v )
+{
+    std::sort( v.begin(), v.end() );
+
+    return v[v.size() / 2];
+}
+
+std::string JSONString( const std::string & s )
+{
+    return "\"" + s + "\"";
+}
+
+int main( int argc, const char * argv[] )
+{
+    std::vector<std::string> engines = { "xoshiro256plus", "xoshiro256plusplus", "xoshiro128plus", "splitmix64", "pcg32", "mt19937_64", "Randomizor_CPU" };
+    std::vector<std::string> dists   = { "uniform", "normal", "bits" };
+    std::vector<std::string> types   = { "f32", "f64", "u64" };
+    std::vector<size_t>      thread_counts;
+
+    size_t      min_bytes = 1024;
+    size_t      max_bytes = size_t(1) << 28;
+    size_t      reps      = 5;
+    std::string json_path = "benchmark_suite.json";
+
+    for( int i = 1; i + 1 < argc; i += 2 )
+    {
+        const std::string arg   = argv[i];
+        const std::string value = argv[i+1];
+
+        if(      arg == "--engines"   ) { engines = Split( value ); }
+        else if( arg == "--dists"     ) { dists   = Split( value ); }
+        else if( arg == "--types"     ) { types   = Split( value ); }
+        else if( arg == "--threads"   ) { for( const auto & t : Split( value ) ) { thread_counts.push_back( std::stoull(t) ); } }
+        else if( arg == "--min-bytes" ) { min_bytes = std::stoull( value ); }
+        else if( arg == "--max-bytes" ) { max_bytes = (value == "ram") ? (Randomizor::Arena::PhysicalMemorySize() / 10) * 6 : std::stoull( value ); }
+        else if( arg == "--reps"      ) { reps = std::max( size_t(1), size_t(std::stoull( value )) ); }
+        else if( arg == "--json"      ) { json_path = value; }
+        else
+        {
+            eprint("Benchmark_Suite: Unknown option "+arg+".");
+            return 1;
+        }
+    }
+
+    if( thread_counts.empty() )
+    {
+        const size_t hw = std::max( 1u, std::thread::hardware_concurrency() );
+
+        for( size_t t = 1; t < hw; t *= 2 )
+        {
+            thread_counts.push_back( t );
+        }
+
+        thread_counts.push_back( hw );
+    }
+
+    // Factors of 4 from min_bytes on, and max_bytes itself.
+    std::vector<size_t> sizes;
+
+    for( size_t bytes = min_bytes; bytes < max_bytes; bytes *= 4 )
+    {
+        sizes.push_back( bytes );
+    }
+
+    sizes.push_back( max_bytes );
+
+    // One buffer for all runs; the largest run faults in all of it.
+    const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+    std::unique_ptr<void, decltype(&std::free)> buffer (
+        std::aligned_alloc( page_size, ((max_bytes + page_size - 1) / page_size) * page_size ), &std::free
+    );
+
+    if( !buffer )
+    {
+        eprint("Benchmark_Suite: Could not allocate "+ToString(max_bytes)+" bytes.");
+        return 1;
+    }
+
+    std::ofstream json ( json_path );
+
+    {
+        const std::time_t now = std::time( nullptr );
+        char date [32];
+        std::strftime( date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime( &now ) );
+
+        json << "{\n";
+        json << "  \"date\": "     << JSONString( date ) << ",\n";
+        json << "  \"compiler\": " << JSONString( __VERSION__ ) << ",\n";
+        json << "  \"isa\": "      << JSONString( ISAName( Kernels().isa ) ) << ",\n";
+        json << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+        json << "  \"physical_memory\": " << Randomizor::Arena::PhysicalMemorySize() << ",\n";
+        json << "  \"repetitions\": " << reps << ",\n";
+        json << "  \"results\": [\n";
+    }
+
+    std::cout << "engine | dist | type | bytes | threads | median [s] | stddev [s] | samples/s | GB/s | cycles/sample" << std::endl;
+
+    bool first_result = true;
+
+    std::unique_ptr<Randomizor_CPU> sampler;
+
+    for( const size_t threads : thread_counts )
+    {
+        ThreadPool pool ( threads );
+
+        for( const auto & engine : engines )
+        {
+            for( const auto & dist : dists )
+            {
+                for( const auto & type : types )
+                {
+                    for( const size_t bytes : sizes )
+                    {
+                        const Config c { engine, dist, type, bytes, threads };
+
+                        const auto fill = MakeFill( pool, sampler, c );
+
+                        if( !fill )
+                        {
+                            break;
+                        }
+
+                        const size_t n = bytes / TypeSize( type );
+
+                        fill( buffer.get(), n );
+
+                        Measurement m;
+
+                        for( size_t rep = 0; rep < reps; ++rep )
+                        {
+                            const std::uint64_t c_start = Cycles();
+                            const auto          t_start = Clock::now();
+
+                            fill( buffer.get(), n );
+
+                            m.times.push_back( std::chrono::duration<double>(Clock::now() - t_start).count() );
+                            m.cycles.push_back( static_cast<double>( Cycles() - c_start ) );
+                        }
+
+                        double mean = 0;
+
+                        for( double t : m.times ) { mean += t; }
+
+                        mean /= static_cast<double>(reps);
+
+                        double var = 0;
+
+                        for( double t : m.times ) { var += (t - mean) * (t - mean); }
+
+                        var /= static_cast<double>( std::max( size_t(1), reps - 1 ) );
+
+                        const double median          = Median( m.times );
+                        const double samples_per_s   = static_cast<double>(n) / median;
+                        const double GB_per_s        = static_cast<double>(n * TypeSize( type )) / median * 1e-9;
+                        const double cycles_per_sample = has_cycles
+                            ? Median( m.cycles ) * static_cast<double>(threads) / static_cast<double>(n)
+                            : -1.;
+
+                        std::cout << engine << " | " << dist << " | " << type << " | " << bytes << " | " << threads
+                                  << " | " << median << " | " << std::sqrt(var) << " | " << samples_per_s
+                                  << " | " << GB_per_s << " | " << cycles_per_sample << std::endl;
+
+                        json << (first_result ? "" : ",\n") << "    {"
+                             << " \"engine\": "            << JSONString( engine )
+                             << ", \"distribution\": "     << JSONString( dist )
+                             << ", \"type\": "             << JSONString( type )
+                             << ", \"bytes\": "            << bytes
+                             << ", \"samples\": "          << n
+                             << ", \"threads\": "          << threads
+                             << ", \"time_median\": "      << median
+                             << ", \"time_mean\": "        << mean
+                             << ", \"time_variance\": "    << var
+                             << ", \"samples_per_s\": "    << samples_per_s
+                             << ", \"GB_per_s\": "         << GB_per_s
+                             << ", \"cycles_per_sample\": " << cycles_per_sample
+                             << " }";
+
+                        first_result = false;
+                    }
+                }
+            }
+        }
+    }
+
+    json << "\n  ]\n}\n";
+
+    std::cout << "Results written to " << json_path << "." << std::endl;
+
+    return 0;
+}
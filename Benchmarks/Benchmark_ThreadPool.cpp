@@ -0,0 +1,106 @@
+// Scaling of the work-stealing ThreadPool versus the static JobPointer split for Fill_Normal.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Benchmark_ThreadPool.cpp -o Benchmark_ThreadPool
+
+#define NDEBUG
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+#include "../Randomizor_CPU.hpp"
+
+using namespace Tools;
+
+using Clock = std::chrono::steady_clock;
+
+int main()
+{
+    const size_t n = size_t(1) << 27;
+    
+    const size_t max_thread_count = 64;
+    
+    // Many more streams than threads so that the pool has blocks to steal.
+    const size_t stream_count = 64 * max_thread_count;
+    
+    std::vector<float> b ( n );
+    
+    std::cout << "threads | static [s] | stealing [s] | speedup (stealing) | busy max/mean (stealing) | steals" << std::endl;
+    
+    double t_1 = 0;
+    
+    for( size_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2 )
+    {
+        // Static split: one engine per thread, as in Example/main.cpp.
+        std::vector<Randomizor::Xoshiro256Plus::state_type> seeds ( thread_count );
+        {
+            Randomizor::Xoshiro256Plus seeder ( std::uint64_t(123456789) );
+            
+            for( size_t thread = 0; thread < thread_count; ++thread )
+            {
+                seeder.Jump();
+                seeds[thread] = seeder.State();
+            }
+        }
+        
+        const auto start_static = Clock::now();
+        
+        ParallelDo(
+            [&]( const size_t thread )
+            {
+                Randomizor::Xoshiro256Plus random_engine ( seeds[thread] );
+                
+                const size_t i_begin = JobPointer(n,thread_count,thread  );
+                const size_t i_end   = JobPointer(n,thread_count,thread+1);
+                
+                Randomizor::Normal_Kernel( random_engine, &b[i_begin], i_end - i_begin );
+            },
+            thread_count
+        );
+        
+        const double t_static = std::chrono::duration<double>(Clock::now() - start_static).count();
+        
+        // Work-stealing.
+        Randomizor::Randomizor_CPU gen ( stream_count, thread_count );
+        
+        gen.Seed( std::uint64_t(123456789) );
+        gen.LoadReservoir( b.data(), n );
+        
+        // Warm up: this makes the pool's threads run once.
+        gen.Fill_Normal();
+        gen.ResetLoadStatistics();
+        
+        const auto start_stealing = Clock::now();
+        
+        gen.Fill_Normal();
+        
+        const double t_stealing = std::chrono::duration<double>(Clock::now() - start_stealing).count();
+        
+        if( thread_count == 1 )
+        {
+            t_1 = t_stealing;
+        }
+        
+        double busy_max  = 0;
+        double busy_mean = 0;
+        size_t steals    = 0;
+        
+        for( const auto & s : gen.LoadStatistics() )
+        {
+            busy_max   = std::max( busy_max, s.busy_time );
+            busy_mean += s.busy_time / thread_count;
+            steals    += s.steal_count;
+        }
+        
+        std::cout
+            << thread_count << " | "
+            << t_static     << " | "
+            << t_stealing   << " | "
+            << t_1 / t_stealing << " | "
+            << busy_max / busy_mean << " | "
+            << steals << std::endl;
+    }
+    
+    return 0;
+}
@@ -1 +1,1304 @@
 #pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "Tools/Tools.hpp"
+
+#include "src/Helpers.hpp"
+#include "src/SplitMix64.hpp"
+#include "src/Xoshiro.hpp"
+#include "src/NUMA.hpp"
+#include "src/Arena.hpp"
+#include "src/ThreadPool.hpp"
+#include "src/Kernels_CPU.hpp"
+#include "src/Dispatch.hpp"
+#include "src/StreamingStore.hpp"
+#include "src/ThreadLocalEngine.hpp"
+#include "src/StreamPartition.hpp"
+#include "src/Checkpoint.hpp"
+#include "src/SampleFile.hpp"
+#include "src/Metrics.hpp"
+#include "src/Tuning.hpp"
+#include "src/VarianceReduction.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // A multithreaded sampler that fills a reservoir in main memory.
+    //
+    // The reservoir is divided into stream_count blocks of (almost) equal size. Block k is always
+    // filled by the engine with state states[k], no matter which thread processes it.
+    // Hence the result depends only on the seed and on stream_count, but neither on CPU_thread_count
+    // nor on how the work-stealing ThreadPool distributes the blocks. Choose stream_count a good deal
+    // larger than CPU_thread_count so that the pool has something to balance.
+    //
+    // Fill_Uniform( a, n ) and Fill_Normal( a, n ) write into caller-provided memory. Requests with
+    // at most InlineThreshold() samples go through the same blocks on the calling thread; they
+    // neither wake the pool nor allocate, and they give the same samples as the pool would, so
+    // the threshold affects only the speed. They visit only the few blocks that hold samples and
+    // lock each of them on its own, so concurrent small requests from different threads run in
+    // parallel. As with any concurrent requests, which of them gets which part of a stream then
+    // depends on their timing.
+    //
+    // Engine_T is any engine of Xoshiro.hpp; Randomizor_CPU uses Xoshiro256+. Each sampler writes
+    // 64 bits per word in Fill_Bits, so 32-bit engines contribute two outputs per word.
+    template<typename Engine_T>
+    class Randomizor_CPU_T
+    {
+    public:
+
+        using Engine      = Engine_T;
+        using UInt        = std::uint64_t;
+        using state_type  = typename Engine::state_type;
+        using result_type = float;
+
+        using ThreadStatistics = typename ThreadPool::ThreadStatistics;
+
+        // Blocks are multiples of this many floats, so that rejection samplers that produce pairs
+        // never have to discard a sample in the middle of the reservoir.
+        static constexpr size_t sample_chunk_size = 4;
+
+        const size_t stream_count;
+
+        const size_t CPU_thread_count = 1;
+
+        // With pin_threads == true, the threads are bound to CPUs spread evenly over the NUMA nodes.
+        // The arena reserves address space for the states and for a reservoir of at most
+        // max_reservoir_bytes; see Arena.hpp for huge_pages.
+        explicit Randomizor_CPU_T(
+            size_t           stream_count_       = 1024,
+            size_t           CPU_thread_count_   = 8,
+            bool             pin_threads         = false,
+            size_t           max_reservoir_bytes = size_t(1) << 34, // 16 GiB
+            Arena::HugePages huge_pages          = Arena::HugePages::Transparent
+        )
+        :   stream_count     ( stream_count_ < 1 ? 1 : stream_count_ )
+        ,   CPU_thread_count ( CPU_thread_count_ < 1 ? 1 : CPU_thread_count_ )
+        ,   pool             ( CPU_thread_count )
+        ,   arena            ( ReservoirOffset() + max_reservoir_bytes, huge_pages )
+        ,   block_locks      ( new BlockLock [stream_count] )
+        {
+            if( pin_threads )
+            {
+                pool.Pin( SpreadCPUs( CPU_thread_count ) );
+            }
+        }
+
+        ~Randomizor_CPU_T() = default;
+
+    protected:
+
+        ThreadPool pool;
+
+        // Holds the states at offset 0 and the reservoir at offset ReservoirOffset(). The reservoir
+        // grows in place; pages once faulted in stay (and stay on their NUMA node) across resizes.
+        Arena arena;
+
+        // Points either into arena or into a memory-mapped checkpoint.
+        state_type * states = nullptr;
+
+        MappedFile state_file;
+
+        // Number of bytes of the arena's reservoir region that have been first-touched already.
+        size_t touched_reservoir_bytes = 0;
+
+        float * reservoir_ptr = nullptr;
+
+        size_t reservoir_size = 0;
+
+        size_t inline_threshold = 32768;
+
+        // Fills of more than this many bytes use streaming stores (see StreamingStore.hpp).
+        size_t streaming_threshold = LastLevelCacheSize();
+
+        // The kernels for the ISA of the machine; ApplyProfile may pick another loop variant.
+        KernelTable<Engine> kernels = Kernels<Engine>();
+
+        // Fills that use the pool, and everything that replaces or reads all states, hold it
+        // exclusively. Small fills hold it shared and lock the blocks they use (see RandomizeArray).
+        std::shared_mutex fill_mutex;
+
+        struct alignas(64) BlockLock
+        {
+            std::atomic<bool> locked { false };
+        };
+
+        std::unique_ptr<BlockLock[]> block_locks;
+
+    protected:
+
+        void Seed()
+        {
+            std::random_device r;
+
+            state_type seed;
+            {
+                std::uint32_t* seed_ = reinterpret_cast<std::uint32_t*>(&seed);
+                for( size_t i = 0; i < sizeof(state_type) / sizeof(std::uint32_t); ++i )
+                {
+                    seed_[i] = r();
+                }
+            }
+
+            Seed( seed );
+        }
+
+    public:
+
+        // Seeds deterministically: states[k] is seed advanced by k+1 jumps of 2^Engine::jump_exponent
+        // steps (2^128 for Xoshiro256+).
+        void Seed( const state_type & seed )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Seed", 0, stream_count * sizeof(state_type) );
+
+            if( NewStates() == nullptr )
+            {
+                return;
+            }
+
+            // Each thread computes (and thus first touches) the states of the blocks it starts with.
+            pool.Do(
+                [&]( const size_t thread )
+                {
+                    const size_t k_begin = JobPointer(stream_count,CPU_thread_count,thread  );
+                    const size_t k_end   = JobPointer(stream_count,CPU_thread_count,thread+1);
+
+                    if( k_begin >= k_end )
+                    {
+                        return;
+                    }
+
+                    Engine random_engine ( seed );
+
+                    JumpAhead<Engine>::Get().Jump(
+                        random_engine,
+                        JumpAhead<Engine>::Shifted( static_cast<std::uint64_t>(k_begin + 1), Engine::jump_exponent )
+                    );
+
+                    states[k_begin] = random_engine.State();
+
+                    for( size_t k = k_begin + 1; k < k_end; ++k )
+                    {
+                        random_engine.Jump();
+                        states[k] = random_engine.State();
+                    }
+                }
+            );
+        }
+
+        void Seed( const UInt seed )
+        {
+            Seed( Engine( seed ).State() );
+        }
+
+        // Seeds for one process of a distributed computation: states[k] is the stream with
+        // address (rank, k, 0) of partition. The samples of a rank are thus the same no matter how
+        // many ranks there are, and different ranks never share a stream.
+        void Seed( const StreamPartition<Engine> & partition, const UInt rank )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Seed", 0, stream_count * sizeof(state_type) );
+
+            if( NewStates() == nullptr )
+            {
+                return;
+            }
+
+            pool.Do(
+                [&]( const size_t thread )
+                {
+                    const size_t k_begin = JobPointer(stream_count,CPU_thread_count,thread  );
+                    const size_t k_end   = JobPointer(stream_count,CPU_thread_count,thread+1);
+
+                    partition.ThreadStates( rank, k_begin, &states[k_begin], k_end - k_begin );
+                }
+            );
+        }
+
+        size_t ReservoirSize( const size_t n )
+        {
+            reservoir_size = sample_chunk_size * ((n + sample_chunk_size - 1) / sample_chunk_size);
+
+            return reservoir_size;
+        }
+
+        size_t ReservoirSize() const
+        {
+            return reservoir_size;
+        }
+
+        // Commits the reservoir in the arena (growing it geometrically if needed) and lets each
+        // thread touch the new pages of the blocks it starts with, so that they are placed on its
+        // NUMA node. Shrinking and growing again neither allocates nor faults in pages.
+        void RequireReservoir( const size_t n )
+        {
+            const size_t size  = ReservoirSize(n);
+            const size_t bytes = size * sizeof(float);
+
+            if( !arena.Require( ReservoirOffset() + bytes ) )
+            {
+                eprint(ClassName()+"::RequireReservoir: Could not allocate "+ToString(bytes)+" bytes; the reservoir may hold at most "+ToString(std::max( arena.Reserved(), ReservoirOffset() ) - ReservoirOffset())+" bytes (see max_reservoir_bytes).");
+                reservoir_ptr  = nullptr;
+                reservoir_size = 0;
+                return;
+            }
+
+            float * a = reinterpret_cast<float *>(arena.Data() + ReservoirOffset());
+
+            if( bytes > touched_reservoir_bytes )
+            {
+                unsigned char * touched_end = reinterpret_cast<unsigned char *>(a) + touched_reservoir_bytes;
+
+                pool.Do(
+                    [&]( const size_t thread )
+                    {
+                        const size_t k_begin = JobPointer(stream_count,CPU_thread_count,thread  );
+                        const size_t k_end   = JobPointer(stream_count,CPU_thread_count,thread+1);
+
+                        unsigned char * begin = reinterpret_cast<unsigned char *>(&a[BlockBegin(size,k_begin)]);
+                        unsigned char * end   = reinterpret_cast<unsigned char *>(&a[BlockBegin(size,k_end)]);
+
+                        begin = std::max( begin, touched_end );
+
+                        if( begin < end )
+                        {
+                            FirstTouch( begin, end );
+                        }
+                    }
+                );
+
+                touched_reservoir_bytes = bytes;
+            }
+
+            reservoir_ptr = a;
+        }
+
+        void LoadReservoir( float * external_reservoir, const size_t external_size )
+        {
+            size_t internal_size = ReservoirSize(external_size);
+
+            if( internal_size == external_size )
+            {
+                reservoir_ptr = external_reservoir;
+            }
+            else
+            {
+                eprint(ClassName()+"::LoadReservoir: ReservoirSize(external_size) != external_size. Please allocate memory for ReservoirSize(external_size) floats.");
+            }
+        }
+
+        float * Reservoir()
+        {
+            return reservoir_ptr;
+        }
+
+        void RequireSeed()
+        {
+            if( states == nullptr )
+            {
+                this->Seed();
+            }
+        }
+
+        // Writes the states of all streams to a checkpoint file (see Checkpoint.hpp).
+        bool Save( const std::string & path )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Save", 0, stream_count * sizeof(state_type) );
+
+            std::lock_guard<std::shared_mutex> lock ( fill_mutex );
+
+            RequireSeed();
+
+            const bool success = SaveCheckpoint( path, ClassName(), stream_count, sizeof(state_type), states );
+
+            return success;
+        }
+
+        // Restores the states from a checkpoint written by Save. The file is mapped copy-on-write and
+        // the sampler works on the mapped states in place; nothing is copied or written back.
+        // On failure, the previous states stay in place and false is returned.
+        bool Load( const std::string & path, const bool verify = true )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Load", 0, stream_count * sizeof(state_type) );
+
+            std::lock_guard<std::shared_mutex> lock ( fill_mutex );
+
+            MappedFile file;
+
+            unsigned char * payload = LoadCheckpoint( file, path, ClassName(), stream_count, sizeof(state_type), verify );
+
+            if( payload != nullptr )
+            {
+                state_file   = std::move(file);
+                states       = reinterpret_cast<state_type *>(payload);
+            }
+
+            return payload != nullptr;
+        }
+
+        // Writes count samples to path, as .npy file if path ends with ".npy" and as raw array
+        // otherwise (see SampleFile.hpp). The threads write directly into a shared memory map of
+        // the file, one window at a time, so the file may be larger than the main memory.
+        // The content depends only on seed, count, distribution and dtype.
+        bool FillFile(
+            const std::string & path,
+            const size_t        count,
+            const Distribution  distribution,
+            const DType         dtype = DType::Float32,
+            const UInt          seed  = 0
+        )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::FillFile", count, count * DTypeSize(dtype) );
+
+            const size_t sample_size = DTypeSize(dtype);
+            const size_t data_offset = IsNpyPath(path) ? sample_file_header_size : 0;
+            const size_t block_bytes = sample_file_block_size * sample_size;
+            const size_t block_count = (count + sample_file_block_size - 1) / sample_file_block_size;
+
+            SampleFile file;
+
+            bool success = file.Create( path, data_offset + count * sample_size );
+
+            if( success && (data_offset > 0) )
+            {
+                unsigned char * header = file.Map( 0, data_offset );
+
+                success = (header != nullptr);
+
+                if( success )
+                {
+                    const std::string npy_header = NpyHeader( dtype, count );
+
+                    std::memcpy( header, npy_header.data(), npy_header.size() );
+
+                    file.Unmap( header, data_offset );
+                }
+            }
+
+            const StreamPartition<Engine> partition ( seed );
+
+            for( size_t b_begin = 0; success && (b_begin < block_count); b_begin += sample_file_window_blocks )
+            {
+                const size_t b_end = std::min( b_begin + sample_file_window_blocks, block_count );
+
+                const size_t i_begin = b_begin * sample_file_block_size;
+                const size_t i_end   = std::min( b_end * sample_file_block_size, count );
+
+                const size_t window_bytes = (i_end - i_begin) * sample_size;
+
+                unsigned char * window = file.Map( data_offset + b_begin * block_bytes, window_bytes );
+
+                if( window == nullptr )
+                {
+                    success = false;
+                    break;
+                }
+
+                pool.ParallelFor(
+                    b_end - b_begin,
+                    [&]( const size_t job, const size_t thread )
+                    {
+                        (void)thread;
+
+                        const size_t b = b_begin + job;
+
+                        const size_t n = std::min( (b + 1) * sample_file_block_size, count ) - b * sample_file_block_size;
+
+                        Engine random_engine = partition.Stream( "Randomizor::FillFile", b );
+
+                        unsigned char * p = window + job * block_bytes;
+
+                        if( dtype == DType::Float64 )
+                        {
+                            double * a = reinterpret_cast<double *>(p);
+
+                            if( distribution == Distribution::Normal )
+                            {
+                                Normal_Kernel( random_engine, a, n );
+                            }
+                            else
+                            {
+                                Uniform_Kernel( random_engine, a, n );
+                            }
+                        }
+                        else
+                        {
+                            float * a = reinterpret_cast<float *>(p);
+
+                            if( distribution == Distribution::Normal )
+                            {
+                                kernels.normal( random_engine, a, n );
+                            }
+                            else
+                            {
+                                kernels.uniform( random_engine, a, n );
+                            }
+                        }
+                    }
+                );
+
+                file.Unmap( window, window_bytes );
+            }
+
+            success = file.Close() && success;
+
+            return success;
+        }
+
+        std::vector<ThreadStatistics> LoadStatistics() const
+        {
+            return pool.Statistics();
+        }
+
+        void ResetLoadStatistics()
+        {
+            pool.ResetStatistics();
+        }
+
+        size_t InlineThreshold() const
+        {
+            return inline_threshold;
+        }
+
+        void SetInlineThreshold( const size_t n )
+        {
+            inline_threshold = n;
+        }
+
+        size_t StreamingThreshold() const
+        {
+            return streaming_threshold;
+        }
+
+        // Fills of more than bytes bytes bypass the cache. Defaults to the size of the last-level
+        // cache; pass 0 to always stream and std::numeric_limits<size_t>::max() to never stream.
+        void SetStreamingThreshold( const size_t bytes )
+        {
+            streaming_threshold = bytes;
+        }
+
+        // Measures for which request sizes the calling thread alone is faster than the pool and sets
+        // InlineThreshold() accordingly. This advances the streams; call it once at startup, before
+        // seeding and issuing requests.
+        void TuneInlineThreshold( const size_t max_n = size_t(1) << 22, const size_t repetitions = 16 )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::TuneInlineThreshold", 0, 0 );
+
+            using Clock = std::chrono::steady_clock;
+
+            std::vector<float> a ( max_n );
+
+            size_t threshold = 0;
+
+            for( size_t n = 16; n <= max_n; n *= 2 )
+            {
+                std::vector<double> t_inline   ( repetitions );
+                std::vector<double> t_parallel ( repetitions );
+
+                for( size_t rep = 0; rep < repetitions; ++rep )
+                {
+                    inline_threshold = n;
+
+                    auto start = Clock::now();
+                    Fill_Normal( a.data(), n );
+                    t_inline[rep] = std::chrono::duration<double>(Clock::now() - start).count();
+
+                    inline_threshold = 0;
+
+                    start = Clock::now();
+                    Fill_Normal( a.data(), n );
+                    t_parallel[rep] = std::chrono::duration<double>(Clock::now() - start).count();
+                }
+
+                std::sort( t_inline.begin(),   t_inline.end()   );
+                std::sort( t_parallel.begin(), t_parallel.end() );
+
+                // Compare medians.
+                if( t_inline[repetitions/2] <= t_parallel[repetitions/2] )
+                {
+                    threshold = n;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            inline_threshold = threshold;
+        }
+
+        // Uses the kernels and thresholds of profile (see Tuning.hpp). None of them changes the
+        // samples: a fill gives the same output for every ISA, kernel variant and threshold.
+        // profile.CPU_thread_count is meant for the constructor. Call this before issuing requests.
+        void ApplyProfile( const TuningProfile & profile )
+        {
+            std::lock_guard<std::shared_mutex> lock ( fill_mutex );
+
+            kernels             = KernelTableFor<Engine>( profile.isa, profile.kernel_variant );
+            inline_threshold    = profile.inline_threshold;
+            streaming_threshold = profile.streaming_threshold;
+        }
+
+        // Measures the settings of TuningProfile on this machine and returns them. This takes a few
+        // seconds and up to 8 times the size of the last-level cache (at most 1 GiB) of memory.
+        // Thread counts up to max_thread_count are tried; 0 stands for all hardware threads.
+        static TuningProfile Autotune( const size_t max_thread_count = 0, const size_t repetitions = 7 )
+        {
+            using Clock = std::chrono::steady_clock;
+
+            auto median = [repetitions]( auto && f )
+            {
+                std::vector<double> t ( repetitions );
+
+                f();
+
+                for( size_t rep = 0; rep < repetitions; ++rep )
+                {
+                    const auto start = Clock::now();
+                    f();
+                    t[rep] = std::chrono::duration<double>(Clock::now() - start).count();
+                }
+
+                std::sort( t.begin(), t.end() );
+
+                return t[repetitions/2];
+            };
+
+            TuningProfile profile;
+
+            // ISA and loop variant, on one thread and within the L2 cache.
+            {
+                const size_t n = size_t(1) << 16;
+
+                std::vector<float>         a ( n );
+                std::vector<std::uint64_t> b ( n / 2 );
+
+                Engine random_engine ( UInt(0) );
+
+                double best = std::numeric_limits<double>::max();
+
+                for( ISA isa : { ISA::Generic, ISA::AVX2, ISA::AVX512, ISA::NEON } )
+                {
+                    if( !Supports( isa ) )
+                    {
+                        continue;
+                    }
+
+                    for( size_t v = 0; v < kernel_variant_count; ++v )
+                    {
+                        const KernelTable<Engine> table = KernelTableFor<Engine>( isa, v );
+
+                        const double t = median(
+                            [&]()
+                            {
+                                table.uniform( random_engine, a.data(), a.size() );
+                                table.bits   ( random_engine, b.data(), b.size() );
+                            }
+                        );
+
+                        if( t < best )
+                        {
+                            best                   = t;
+                            profile.isa            = isa;
+                            profile.kernel_variant = v;
+                        }
+                    }
+                }
+            }
+
+            const size_t hardware_threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+            const size_t max_threads = (max_thread_count == 0) ? hardware_threads : max_thread_count;
+
+            const size_t stream_count = 64 * max_threads;
+
+            // Thread count, on a fill far beyond the caches. Fewer threads win ties within 3%.
+            {
+                std::vector<float> a ( size_t(1) << 24 );
+
+                double best = std::numeric_limits<double>::max();
+
+                std::vector<size_t> candidates;
+
+                for( size_t c = 1; c < max_threads; c *= 2 )
+                {
+                    candidates.push_back( c );
+                }
+
+                candidates.push_back( max_threads );
+
+                for( const size_t c : candidates )
+                {
+                    Randomizor_CPU_T gen ( stream_count, c );
+
+                    gen.ApplyProfile( profile );
+                    gen.Seed( UInt(0) );
+
+                    const double t = median( [&](){ gen.Fill_Uniform( a.data(), a.size() ); } );
+
+                    if( t < 0.97 * best )
+                    {
+                        best                     = t;
+                        profile.CPU_thread_count = c;
+                    }
+                }
+            }
+
+            Randomizor_CPU_T gen ( stream_count, profile.CPU_thread_count );
+
+            gen.ApplyProfile( profile );
+            gen.Seed( UInt(0) );
+
+            // Store mode: fills of more than streaming_threshold bytes stream from the smallest size
+            // on from which streaming is faster for all larger sizes that we try.
+            {
+                const size_t llc = LastLevelCacheSize();
+
+                std::vector<size_t> sizes;
+
+                for( size_t bytes = llc / 4; (bytes <= 8 * llc) && (bytes <= (size_t(1) << 30)); bytes *= 2 )
+                {
+                    sizes.push_back( bytes );
+                }
+
+                std::vector<float> a ( sizes.empty() ? 0 : sizes.back() / sizeof(float) );
+
+                profile.streaming_threshold = std::numeric_limits<size_t>::max();
+
+                for( size_t i = sizes.size(); i --> 0; )
+                {
+                    const size_t n = sizes[i] / sizeof(float);
+
+                    gen.SetStreamingThreshold( std::numeric_limits<size_t>::max() );
+
+                    const double t_regular = median( [&](){ gen.Fill_Uniform( a.data(), n ); } );
+
+                    gen.SetStreamingThreshold( 0 );
+
+                    const double t_streaming = median( [&](){ gen.Fill_Uniform( a.data(), n ); } );
+
+                    if( t_streaming >= t_regular )
+                    {
+                        break;
+                    }
+
+                    profile.streaming_threshold = (i == 0) ? 0 : sizes[i-1];
+                }
+
+                gen.SetStreamingThreshold( profile.streaming_threshold );
+            }
+
+            gen.TuneInlineThreshold();
+
+            profile.inline_threshold = gen.InlineThreshold();
+
+            return profile;
+        }
+
+        // Loads the profile at path if it exists and fits this machine; otherwise runs Autotune and
+        // saves the result there.
+        static TuningProfile LoadOrAutotune( const std::string & path )
+        {
+            TuningProfile profile;
+
+            if( !profile.Load( path ) )
+            {
+                profile = Autotune();
+
+                profile.Save( path );
+            }
+
+            return profile;
+        }
+
+    protected:
+
+        size_t ReservoirOffset() const
+        {
+            return Arena::RoundUp( stream_count * sizeof(state_type), Arena::huge_page_size );
+        }
+
+        state_type * NewStates()
+        {
+            state_file.Close();
+
+            if( !arena.Require( stream_count * sizeof(state_type) ) )
+            {
+                eprint(ClassName()+"::NewStates: Could not allocate the states.");
+                states = nullptr;
+                return states;
+            }
+
+            states = reinterpret_cast<state_type *>(arena.Data());
+
+            return states;
+        }
+
+        // Index of the first element of block k when an array of length n is split into
+        // stream_count blocks. All blocks but the last one are multiples of sample_chunk_size.
+        size_t BlockBegin( const size_t n, const size_t k ) const
+        {
+            return (k >= stream_count)
+                 ? n
+                 : sample_chunk_size * JobPointer(n / sample_chunk_size,stream_count,k);
+        }
+
+        // Calls f( k, i_begin, i_end ) for every nonempty block [i_begin,i_end) of an array of
+        // length n, in the order of k. Block k holds the chunks [c k / S, c (k+1) / S) (rounded
+        // down) of the c = n / sample_chunk_size chunks, where S = stream_count, and the last block
+        // also holds the samples after them. So with fewer chunks than streams, chunk j is the
+        // whole of block ceil( (j+1) S / c ) - 1, and the other blocks need no visit.
+        template<typename F>
+        void ForEachBlock( const size_t n, F && f ) const
+        {
+            const size_t c = n / sample_chunk_size;
+
+            if( c >= stream_count )
+            {
+                size_t i_begin = 0;
+
+                for( size_t k = 0; k < stream_count; ++k )
+                {
+                    const size_t i_end = BlockBegin(n,k+1);
+
+                    f( k, i_begin, i_end );
+
+                    i_begin = i_end;
+                }
+            }
+            else if( c > 0 )
+            {
+                for( size_t j = 0; j < c; ++j )
+                {
+                    const size_t k = ((j + 1) * stream_count + c - 1) / c - 1;
+
+                    f( k, sample_chunk_size * j, (k + 1 == stream_count) ? n : sample_chunk_size * (j + 1) );
+                }
+            }
+            else if( n > 0 )
+            {
+                f( stream_count - 1, size_t(0), n );
+            }
+        }
+
+        void LockBlock( const size_t k )
+        {
+            std::atomic<bool> & locked = block_locks[k].locked;
+
+            while( locked.exchange( true, std::memory_order_acquire ) )
+            {
+                while( locked.load( std::memory_order_relaxed ) )
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void UnlockBlock( const size_t k )
+        {
+            block_locks[k].locked.store( false, std::memory_order_release );
+        }
+
+        // Calls kernel( random_engine, pointer, count ) on the nonempty ones of the stream_count blocks
+        // of a[0],...,a[n-1]; kernels that also take the offset of the block get it (see InvokeKernel).
+        // Requests of at most inline_threshold samples run through the same blocks on the calling
+        // thread, without waking the pool, so they give the same samples as the pool would. They
+        // share fill_mutex with each other and lock only the blocks they use.
+        template<typename T, typename Kernel_T>
+        void RandomizeArray( T * restrict const a, const size_t n, Kernel_T && kernel )
+        {
+            auto block = [&,a]( const size_t k, const size_t i_begin, const size_t i_end )
+            {
+                // Streaming does not change the samples, only how they reach memory.
+                const bool streaming = std::is_same_v<T,float> && (n * sizeof(T) > streaming_threshold);
+
+                Engine random_engine ( states[k] );
+
+                if constexpr ( std::is_same_v<T,float> )
+                {
+                    if( streaming )
+                    {
+                        Streaming_Kernel( kernel, random_engine, &a[i_begin], i_end - i_begin, i_begin );
+                    }
+                    else
+                    {
+                        InvokeKernel( kernel, random_engine, &a[i_begin], i_end - i_begin, i_begin );
+                    }
+                }
+                else
+                {
+                    InvokeKernel( kernel, random_engine, &a[i_begin], i_end - i_begin, i_begin );
+                }
+
+                states[k] = random_engine.State();
+            };
+
+            {
+                std::shared_lock<std::shared_mutex> lock ( fill_mutex );
+
+                if( (n <= inline_threshold) && (states != nullptr) )
+                {
+                    ForEachBlock( n,
+                        [&]( const size_t k, const size_t i_begin, const size_t i_end )
+                        {
+                            LockBlock( k );
+
+                            block( k, i_begin, i_end );
+
+                            UnlockBlock( k );
+                        }
+                    );
+
+                    return;
+                }
+            }
+
+            std::lock_guard<std::shared_mutex> lock ( fill_mutex );
+
+            RequireSeed();
+
+            if( n <= inline_threshold )
+            {
+                ForEachBlock( n, block );
+            }
+            else
+            {
+                pool.ParallelFor(
+                    stream_count,
+                    [&block,n,this]( const size_t k, const size_t thread )
+                    {
+                        (void)thread;
+
+                        const size_t i_begin = BlockBegin(n,k  );
+                        const size_t i_end   = BlockBegin(n,k+1);
+
+                        if( i_begin < i_end )
+                        {
+                            block( k, i_begin, i_end );
+                        }
+                    }
+                );
+            }
+        }
+
+        // Calls kernel( random_engine, pointer, count ) on every block of the reservoir.
+        template<typename Kernel_T>
+        void RandomizeReservoir( Kernel_T && kernel )
+        {
+            if( (reservoir_ptr == nullptr) || (reservoir_size <= 0) )
+            {
+                eprint(ClassName()+"::RandomizeReservoir: Empty reservoir. Create a reservoir with RequireReservoir or with LoadReservoir.");
+                return;
+            }
+
+            RandomizeArray( reservoir_ptr, reservoir_size, std::forward<Kernel_T>(kernel) );
+        }
+
+    public:
+
+        void Fill_Uniform()
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Uniform", reservoir_size, reservoir_size * sizeof(float) );
+            RandomizeReservoir(
+                [this]( Engine & random_engine, float * a, const size_t n )
+                {
+                    kernels.uniform( random_engine, a, n );
+                }
+            );
+        }
+
+        void Fill_Normal()
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Normal", reservoir_size, reservoir_size * sizeof(float) );
+            RandomizeReservoir(
+                [this]( Engine & random_engine, float * a, const size_t n )
+                {
+                    kernels.normal( random_engine, a, n );
+                }
+            );
+        }
+
+        void Fill_Uniform( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Uniform", n, n * sizeof(float) );
+
+            RandomizeArray(
+                a, n,
+                [this]( Engine & random_engine, float * b, const size_t m )
+                {
+                    kernels.uniform( random_engine, b, m );
+                }
+            );
+        }
+
+        void Fill_Normal( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Normal", n, n * sizeof(float) );
+
+            RandomizeArray(
+                a, n,
+                [this]( Engine & random_engine, float * b, const size_t m )
+                {
+                    kernels.normal( random_engine, b, m );
+                }
+            );
+        }
+
+        // Fills a[0],...,a[n-1] with samples of N(mu,sigma^2), i.e., mu + sigma * x for the samples x
+        // that Fill_Normal( a, n ) would produce, in the same pass.
+        void Fill_Normal( float * a, const size_t n, const float mu, const float sigma )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Normal", n, n * sizeof(float) );
+
+            RandomizeArray(
+                a, n,
+                [this,mu,sigma]( Engine & random_engine, float * b, const size_t m )
+                {
+                    kernels.affine_normal( random_engine, b, m, mu, sigma );
+                }
+            );
+        }
+
+        // Same with per-element parameters: a[i] is a sample of N(mu[i],sigma[i]^2).
+        void Fill_Normal( float * a, const size_t n, const float * mu, const float * sigma )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Normal", n, n * sizeof(float) );
+
+            RandomizeArray(
+                a, n,
+                [this,mu,sigma]( Engine & random_engine, float * b, const size_t m, const size_t offset )
+                {
+                    kernels.affine_normal_array( random_engine, b, m, mu + offset, sigma + offset );
+                }
+            );
+        }
+
+        // Fills a[0],...,a[n-1] with samples of N(mu,sigma^2) truncated to [lower,upper]; the bounds
+        // may be infinite. The method depends on the standardized bounds (see TruncatedNormal), and
+        // at least every second candidate is accepted, also for bounds far out in the tails.
+        void Fill_TruncatedNormal(
+            float * a, const size_t n,
+            const double mu, const double sigma, const double lower, const double upper
+        )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_TruncatedNormal", n, n * sizeof(float) );
+
+            if( !(sigma > 0) || !(lower < upper) || !std::isfinite( mu ) || !std::isfinite( sigma ) )
+            {
+                eprint(ClassName()+"::Fill_TruncatedNormal: Invalid parameters mu = "+ToString(mu)+", sigma = "+ToString(sigma)+", lower = "+ToString(lower)+", upper = "+ToString(upper)+".");
+                return;
+            }
+
+            const TruncatedNormal T ( mu, sigma, lower, upper );
+
+            RandomizeArray(
+                a, n,
+                [&T]( Engine & random_engine, float * b, const size_t m )
+                {
+                    TruncatedNormal_Kernel( random_engine, b, m, T );
+                }
+            );
+        }
+
+        // Fills a[0],...,a[n-1] with samples of the tabulated distribution D, by inversion of its
+        // CDF with one random word per sample.
+        void Fill_Tabulated( float * a, const size_t n, const TabulatedDistribution & D )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Tabulated", n, n * sizeof(float) );
+
+            if( D.Empty() )
+            {
+                eprint(ClassName()+"::Fill_Tabulated: Empty table. Create it with SetCDF or SetPDF.");
+                return;
+            }
+
+            RandomizeArray(
+                a, n,
+                [this,&D]( Engine & random_engine, float * b, const size_t m )
+                {
+                    kernels.tabulated( random_engine, b, m, D );
+                }
+            );
+        }
+
+        // Same as Fill_Uniform( a, n ) and Fill_Normal( a, n ), but with antithetic pairs or with
+        // one sample per stratum (see VarianceReduction.hpp). The strata are those of the whole
+        // fill, also when it is split among the streams, and the pairs never straddle two
+        // streams, since the blocks have even length.
+        void Fill_Uniform( float * a, const size_t n, const VarianceReduction mode )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Uniform", n, n * sizeof(float) );
+
+            FillWithVarianceReduction<false>( a, n, mode );
+        }
+
+        void Fill_Normal( float * a, const size_t n, const VarianceReduction mode )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Normal", n, n * sizeof(float) );
+
+            FillWithVarianceReduction<true>( a, n, mode );
+        }
+
+        // The same for the reservoir.
+        void Fill_Uniform( const VarianceReduction mode )
+        {
+            if( RequireNonemptyReservoir( "Fill_Uniform" ) )
+            {
+                Fill_Uniform( reservoir_ptr, reservoir_size, mode );
+            }
+        }
+
+        void Fill_Normal( const VarianceReduction mode )
+        {
+            if( RequireNonemptyReservoir( "Fill_Normal" ) )
+            {
+                Fill_Normal( reservoir_ptr, reservoir_size, mode );
+            }
+        }
+
+        // Fills a[0],...,a[point_count * dimension - 1] with a Latin hypercube design: point p is
+        // a[dimension * p],...,a[dimension * p + dimension - 1], and in every coordinate, each of
+        // the point_count strata [k/point_count, (k+1)/point_count) holds exactly one point.
+        // Coordinate j is made from stream j mod stream_count, with a permutation of its own, so
+        // the coordinates are shuffled in parallel, and the result depends only on the seed and on
+        // stream_count.
+        void Fill_LatinHypercube( float * a, const size_t point_count, const size_t dimension )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_LatinHypercube", point_count * dimension, point_count * dimension * sizeof(float) );
+
+            if( point_count > size_t(std::numeric_limits<std::uint32_t>::max()) + 1 )
+            {
+                eprint(ClassName()+"::Fill_LatinHypercube: At most 2^32 points are supported.");
+                return;
+            }
+
+            std::lock_guard<std::shared_mutex> lock ( fill_mutex );
+
+            RequireSeed();
+
+            std::vector<std::vector<std::uint32_t>> permutations ( CPU_thread_count );
+
+            pool.ParallelFor(
+                std::min( stream_count, dimension ),
+                [&,a]( const size_t k, const size_t thread )
+                {
+                    std::vector<std::uint32_t> & perm = permutations[thread];
+
+                    perm.resize( point_count );
+
+                    Engine random_engine ( states[k] );
+
+                    for( size_t j = k; j < dimension; j += stream_count )
+                    {
+                        LatinHypercubeCoordinate_Kernel( random_engine, a, point_count, dimension, j, perm.data() );
+                    }
+
+                    states[k] = random_engine.State();
+                }
+            );
+        }
+
+        // The same for the reservoir, with reservoir_size / dimension points.
+        void Fill_LatinHypercube( const size_t dimension )
+        {
+            if( RequireNonemptyReservoir( "Fill_LatinHypercube" ) && (dimension > 0) )
+            {
+                Fill_LatinHypercube( reservoir_ptr, reservoir_size / dimension, dimension );
+            }
+        }
+
+        // Same as Fill_Uniform( a, n ), but with a different conversion from bits to floats, e.g.,
+        // Fill_Uniform<Conversion_Open>( a, n ) for samples in (0,1).
+        template<typename Conversion>
+        void Fill_Uniform( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Uniform", n, n * sizeof(float) );
+
+            const Uniform_Kernel_T<Engine> kernel = UniformKernel<Conversion,Engine>();
+
+            RandomizeArray(
+                a, n,
+                [kernel]( Engine & random_engine, float * b, const size_t m )
+                {
+                    kernel( random_engine, b, m );
+                }
+            );
+        }
+
+        // Fills a[0],...,a[n-1] with raw engine output, 64 bits per word (see Bits64).
+        void Fill_Bits( std::uint64_t * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Bits", n, n * sizeof(std::uint64_t) );
+
+            RandomizeArray(
+                a, n,
+                [this]( Engine & random_engine, std::uint64_t * b, const size_t m )
+                {
+                    kernels.bits( random_engine, b, m );
+                }
+            );
+        }
+
+        // Fills a[0],...,a[n-1] with 64 * n Bernoulli samples, packed into bits: each bit is 1 with
+        // probability p, exactly, for every double p in [0,1], however small (see BernoulliDigits).
+        // This consumes 7.3 random words per 64 samples on average, fewer if p has only a few
+        // binary digits, and a single word for p = 1/2 (see BernoulliWord).
+        void Fill_Bernoulli( std::uint64_t * a, const size_t n, const double p )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Bernoulli", 64 * n, n * sizeof(std::uint64_t) );
+
+            if( !BernoulliProbability( p, "Fill_Bernoulli" ) )
+            {
+                return;
+            }
+
+            if( (p == 0.) || (p == 1.) )
+            {
+                std::fill_n( a, n, (p == 1.) ? ~std::uint64_t(0) : std::uint64_t(0) );
+                return;
+            }
+
+            std::uint64_t p_bits;
+            std::size_t   p_zeros;
+
+            BernoulliDigits( p, p_bits, p_zeros );
+
+            RandomizeArray(
+                a, n,
+                [this,p_bits,p_zeros]( Engine & random_engine, std::uint64_t * b, const size_t m )
+                {
+                    kernels.bernoulli( random_engine, b, m, p_bits, p_zeros );
+                }
+            );
+        }
+
+        // Fills a[0],...,a[n-1] with Bernoulli samples, one byte (0 or 1) per sample, e.g., for
+        // masks that are read bytewise. Uses the same bitwise sampler as the packed variant and
+        // spreads its bits to bytes.
+        void Fill_Bernoulli( std::uint8_t * a, const size_t n, const double p )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Bernoulli", n, n );
+
+            if( !BernoulliProbability( p, "Fill_Bernoulli" ) )
+            {
+                return;
+            }
+
+            if( (p == 0.) || (p == 1.) )
+            {
+                std::fill_n( a, n, static_cast<std::uint8_t>(p == 1.) );
+                return;
+            }
+
+            std::uint64_t p_bits;
+            std::size_t   p_zeros;
+
+            BernoulliDigits( p, p_bits, p_zeros );
+
+            RandomizeArray(
+                a, n,
+                [this,p_bits,p_zeros]( Engine & random_engine, std::uint8_t * b, const size_t m )
+                {
+                    kernels.bernoulli_bytes( random_engine, b, m, p_bits, p_zeros );
+                }
+            );
+        }
+
+    protected:
+
+        bool RequireNonemptyReservoir( const std::string & tag ) const
+        {
+            if( (reservoir_ptr == nullptr) || (reservoir_size <= 0) )
+            {
+                eprint(ClassName()+"::"+tag+": Empty reservoir. Create a reservoir with RequireReservoir or with LoadReservoir.");
+                return false;
+            }
+
+            return true;
+        }
+
+        template<bool normal>
+        void FillWithVarianceReduction( float * a, const size_t n, const VarianceReduction mode )
+        {
+            // Fills b[0],...,b[m-1], the samples offset,...,offset + m - 1 of the fill.
+            auto fill = [this,n,mode]( Engine & random_engine, float * b, const size_t m, const size_t offset )
+            {
+                switch( mode )
+                {
+                    case VarianceReduction::Antithetic:
+                    {
+                        if constexpr ( normal )
+                        {
+                            kernels.normal( random_engine, b, (m + 1) / 2 );
+                            AntitheticExpand( b, m, []( const float x ){ return -x; } );
+                        }
+                        else
+                        {
+                            kernels.uniform( random_engine, b, (m + 1) / 2 );
+                            AntitheticExpand( b, m, []( const float x ){ return 1.f - x; } );
+                        }
+                        break;
+                    }
+                    case VarianceReduction::Stratified:
+                    {
+                        if constexpr ( normal )
+                        {
+                            StratifiedNormal_Kernel( random_engine, b, m, offset, n );
+                        }
+                        else
+                        {
+                            StratifiedUniform_Kernel( random_engine, b, m, offset, n );
+                        }
+                        break;
+                    }
+                    default:
+                    {
+                        if constexpr ( normal )
+                        {
+                            kernels.normal( random_engine, b, m );
+                        }
+                        else
+                        {
+                            kernels.uniform( random_engine, b, m );
+                        }
+                        break;
+                    }
+                }
+            };
+
+            RandomizeArray( a, n, fill );
+        }
+
+        bool BernoulliProbability( const double p, const std::string & tag ) const
+        {
+            if( !((p >= 0.) && (p <= 1.)) )
+            {
+                eprint(ClassName()+"::"+tag+": Probability "+ToString(p)+" is not in [0,1].");
+                return false;
+            }
+
+            return true;
+        }
+
+    public:
+
+        std::string ClassName() const
+        {
+            if constexpr ( std::is_same_v<Engine,Xoshiro256Plus> )
+            {
+                return "Randomizor_CPU";
+            }
+            else
+            {
+                return "Randomizor_CPU<"+Engine::ClassName()+">";
+            }
+        }
+
+    };
+
+    using Randomizor_CPU = Randomizor_CPU_T<Xoshiro256Plus>;
+}
@@ -0,0 +1,631 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "Tools/Tools.hpp"
+
+#include "src/Helpers.hpp"
+#include "src/SplitMix64.hpp"
+#include "src/Xoshiro.hpp"
+#include "src/NUMA.hpp"
+#include "src/ThreadPool.hpp"
+#include "src/Kernels_CPU.hpp"
+#include "src/Dispatch.hpp"
+#include "src/StreamPartition.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // Values of the nonzero entries of a generated sparse matrix.
+    enum class EntryValues
+    {
+        None,    // pattern only; values stays empty
+        Ones,
+        Uniform, // uniformly distributed in [0,1)
+        Normal   // standard normally distributed
+    };
+
+    // A sparse matrix in compressed sparse row format: the column indices of row i are
+    // col_idx[row_ptr[i]],...,col_idx[row_ptr[i+1]-1], in increasing order, and values holds the
+    // entries in the same order (or nothing for EntryValues::None).
+    template<typename Int_T = std::int64_t, typename Real_T = float>
+    struct SparseMatrixCSR
+    {
+        using Int  = Int_T;
+        using Real = Real_T;
+
+        Int row_count = 0;
+        Int col_count = 0;
+
+        std::vector<Int>  row_ptr;
+        std::vector<Int>  col_idx;
+        std::vector<Real> values;
+
+        Int NonzeroCount() const
+        {
+            return row_ptr.empty() ? Int(0) : row_ptr.back();
+        }
+    };
+
+    // Generators of random sparse matrices and graphs: random sparse matrices with independent
+    // entries, Erdős–Rényi graphs G(n,p) and stochastic block models.
+    //
+    // None of them visits all candidate pairs. Within a row, the gaps between consecutive nonzero
+    // columns are geometrically distributed, so the generator draws one gap per nonzero (plus one
+    // per row and segment) and jumps over the zeros; the cost is proportional to the output.
+    //
+    // The rows are split into blocks of row_block_size rows. Block b draws its pattern from the
+    // stream (rank, b) of a StreamPartition of the seed and its values from the substream 1 of
+    // that stream, where rank counts the matrices generated so far. The blocks are handed out by
+    // the ThreadPool twice: the first pass counts the nonzeros of every row, the prefix sum of the
+    // counts gives row_ptr, and the second pass replays the same stream to write the column
+    // indices and values in place. So the output depends only on the seed and on the order of the
+    // calls, but not on CPU_thread_count.
+    //
+    // The graphs are undirected and simple: the generator samples the strict upper triangle and
+    // then mirrors it, so the adjacency matrix is symmetric (including its values) with an empty
+    // diagonal.
+    template<typename Engine_T = Xoshiro256Plus, typename Int_T = std::int64_t>
+    class Randomizor_Graph_T
+    {
+    public:
+
+        using Engine     = Engine_T;
+        using Int        = Int_T;
+        using Real       = float;
+        using UInt       = std::uint64_t;
+        using state_type = typename Engine::state_type;
+        using Matrix_T   = SparseMatrixCSR<Int,Real>;
+
+        static_assert( std::is_signed_v<Int>, "Int_T must be a signed integer type." );
+
+        static constexpr size_t row_block_size = 1024;
+
+        const size_t CPU_thread_count = 1;
+
+        explicit Randomizor_Graph_T( const UInt seed, const size_t CPU_thread_count_ = 8 )
+        :   CPU_thread_count ( CPU_thread_count_ < 1 ? 1 : CPU_thread_count_ )
+        ,   partition        ( seed )
+        ,   pool             ( CPU_thread_count )
+        {}
+
+        ~Randomizor_Graph_T() = default;
+
+    protected:
+
+        StreamPartition<Engine> partition;
+
+        ThreadPool pool;
+
+        // Number of matrices generated so far; the rank of the streams of the next one.
+        UInt rank = 0;
+
+        std::mutex generate_mutex;
+
+    public:
+
+        // Index of the next matrix; SetIndex( k ) makes the next call produce the k-th matrix of
+        // the seed again.
+        UInt Index() const
+        {
+            return rank;
+        }
+
+        void SetIndex( const UInt k )
+        {
+            std::lock_guard<std::mutex> lock ( generate_mutex );
+
+            rank = k;
+        }
+
+        // A row_count x col_count matrix whose entries are nonzero independently with
+        // probability p.
+        Matrix_T SparseMatrix(
+            const Int row_count, const Int col_count, const double p,
+            const EntryValues entry_values = EntryValues::Normal
+        )
+        {
+            if( !CheckSize( row_count, "SparseMatrix" ) || !CheckSize( col_count, "SparseMatrix" ) || !CheckProbability( p, "SparseMatrix" ) )
+            {
+                return Matrix_T();
+            }
+
+            const double log_q = std::log1p( -p );
+
+            return Generate(
+                row_count, col_count, entry_values,
+                [=]( const Int i, auto && segment )
+                {
+                    (void)i;
+                    segment( Int(0), col_count, p, log_q );
+                }
+            );
+        }
+
+        // The adjacency matrix of an Erdős–Rényi graph G(n,p): every pair of distinct vertices is
+        // joined by an edge with probability p.
+        Matrix_T ErdosRenyi( const Int n, const double p, const EntryValues entry_values = EntryValues::None )
+        {
+            if( !CheckSize( n, "ErdosRenyi" ) || !CheckProbability( p, "ErdosRenyi" ) )
+            {
+                return Matrix_T();
+            }
+
+            const double log_q = std::log1p( -p );
+
+            return Symmetrize(
+                Generate(
+                    n, n, entry_values,
+                    [=]( const Int i, auto && segment )
+                    {
+                        segment( i + 1, n, p, log_q );
+                    }
+                )
+            );
+        }
+
+        // The adjacency matrix of a stochastic block model: the vertices are split into
+        // consecutive blocks of the sizes block_sizes[0],...,block_sizes[k-1], and two distinct
+        // vertices in the blocks a and b are joined with probability P[k * a + b]. P is a k x k
+        // matrix in row-major order; only its upper triangle is used.
+        Matrix_T StochasticBlockModel(
+            const std::vector<Int> & block_sizes, const std::vector<double> & P,
+            const EntryValues entry_values = EntryValues::None
+        )
+        {
+            const size_t k = block_sizes.size();
+
+            if( P.size() != k * k )
+            {
+                eprint(ClassName()+"::StochasticBlockModel: P has "+ToString(P.size())+" entries, but there are "+ToString(k)+" blocks.");
+                return Matrix_T();
+            }
+
+            std::vector<Int> block_ptr ( k + 1, Int(0) );
+
+            for( size_t a = 0; a < k; ++a )
+            {
+                if( !CheckSize( block_sizes[a], "StochasticBlockModel" ) )
+                {
+                    return Matrix_T();
+                }
+
+                if( block_sizes[a] > std::numeric_limits<Int>::max() - block_ptr[a] )
+                {
+                    eprint(ClassName()+"::StochasticBlockModel: Too many vertices for the index type.");
+                    return Matrix_T();
+                }
+
+                block_ptr[a+1] = block_ptr[a] + block_sizes[a];
+            }
+
+            std::vector<double> log_Q ( k * k );
+
+            for( size_t a = 0; a < k; ++a )
+            {
+                for( size_t b = a; b < k; ++b )
+                {
+                    if( !CheckProbability( P[k * a + b], "StochasticBlockModel" ) )
+                    {
+                        return Matrix_T();
+                    }
+
+                    log_Q[k * a + b] = std::log1p( -P[k * a + b] );
+                }
+            }
+
+            const Int n = block_ptr[k];
+
+            return Symmetrize(
+                Generate(
+                    n, n, entry_values,
+                    [&]( const Int i, auto && segment )
+                    {
+                        // Block of vertex i.
+                        const size_t a = static_cast<size_t>(
+                            std::upper_bound( block_ptr.begin(), block_ptr.end(), i ) - block_ptr.begin() - 1
+                        );
+
+                        for( size_t b = a; b < k; ++b )
+                        {
+                            segment( std::max( i + 1, block_ptr[b] ), block_ptr[b+1], P[k * a + b], log_Q[k * a + b] );
+                        }
+                    }
+                )
+            );
+        }
+
+    protected:
+
+        bool CheckSize( const Int n, const std::string & tag ) const
+        {
+            if( n < 0 )
+            {
+                eprint(ClassName()+"::"+tag+": Negative size "+ToString(n)+".");
+                return false;
+            }
+
+            return true;
+        }
+
+        bool CheckProbability( const double p, const std::string & tag ) const
+        {
+            if( !((p >= 0.) && (p <= 1.)) )
+            {
+                eprint(ClassName()+"::"+tag+": Probability "+ToString(p)+" is not in [0,1].");
+                return false;
+            }
+
+            return true;
+        }
+
+        // Calls visit( j ) for every column j in [begin,end) that is chosen with probability p,
+        // in increasing order. log_q = log(1-p). The gap to the next chosen column is
+        // floor( log(U) / log(1-p) ) with U uniform in (0,1].
+        template<typename Visit_T>
+        static void SampleSegment(
+            Engine & random_engine, const Int begin, const Int end, const double p, const double log_q,
+            Visit_T && visit
+        )
+        {
+            if( (begin >= end) || (p <= 0.) )
+            {
+                return;
+            }
+
+            if( p >= 1. )
+            {
+                for( Int j = begin; j < end; ++j )
+                {
+                    visit( j );
+                }
+
+                return;
+            }
+
+            Int j = begin;
+
+            while( true )
+            {
+                const double U   = 1. - DoubleFromBits( Bits64( random_engine ) );
+                const double gap = std::floor( std::log( U ) / log_q );
+
+                // Compare in double precision, so that huge gaps cannot overflow Int.
+                if( gap >= static_cast<double>(end - j) )
+                {
+                    return;
+                }
+
+                j += static_cast<Int>(gap);
+
+                visit( j );
+
+                ++j;
+            }
+        }
+
+        // Generates the rows of a row_count x col_count matrix; segments( i, segment ) calls
+        // segment( begin, end, p, log(1-p) ) for the column ranges of row i, in increasing order.
+        template<typename Segments_T>
+        Matrix_T Generate( const Int row_count, const Int col_count, const EntryValues entry_values, Segments_T && segments )
+        {
+            std::lock_guard<std::mutex> lock ( generate_mutex );
+
+            Matrix_T A;
+
+            A.row_count = row_count;
+            A.col_count = col_count;
+            A.row_ptr.assign( static_cast<size_t>(row_count) + 1, Int(0) );
+
+            const size_t block_count = (static_cast<size_t>(row_count) + row_block_size - 1) / row_block_size;
+
+            const std::vector<state_type> states = BlockStates( block_count );
+
+            ++rank;
+
+            auto row_range = [row_count]( const size_t b )
+            {
+                const Int i_begin = static_cast<Int>(row_block_size * b);
+                const Int i_end   = std::min( row_count, static_cast<Int>(row_block_size * (b + 1)) );
+
+                return std::pair<Int,Int>( i_begin, i_end );
+            };
+
+            // First pass: row_ptr[i+1] = number of nonzeros of row i.
+            pool.ParallelFor(
+                block_count,
+                [&]( const size_t b, const size_t thread )
+                {
+                    (void)thread;
+
+                    Engine random_engine ( states[b] );
+
+                    const auto [i_begin, i_end] = row_range( b );
+
+                    for( Int i = i_begin; i < i_end; ++i )
+                    {
+                        Int count = 0;
+
+                        segments( i, [&]( const Int begin, const Int end, const double p, const double log_q )
+                        {
+                            SampleSegment( random_engine, begin, end, p, log_q, [&count]( const Int j ){ (void)j; ++count; } );
+                        });
+
+                        A.row_ptr[static_cast<size_t>(i) + 1] = count;
+                    }
+                }
+            );
+
+            // The counts are at most col_count each, but their sum may overflow Int.
+            for( size_t i = 0; i < static_cast<size_t>(row_count); ++i )
+            {
+                if( A.row_ptr[i+1] > std::numeric_limits<Int>::max() - A.row_ptr[i] )
+                {
+                    eprint(ClassName()+"::Generate: The number of nonzeros exceeds the index type.");
+                    return Matrix_T();
+                }
+
+                A.row_ptr[i+1] += A.row_ptr[i];
+            }
+
+            const size_t nnz = static_cast<size_t>(A.NonzeroCount());
+
+            A.col_idx.resize( nnz );
+
+            if( entry_values != EntryValues::None )
+            {
+                A.values.resize( nnz );
+            }
+
+            // Second pass: replay the streams and write the column indices, then the values of the
+            // whole block in one kernel call.
+            pool.ParallelFor(
+                block_count,
+                [&]( const size_t b, const size_t thread )
+                {
+                    (void)thread;
+
+                    Engine random_engine ( states[b] );
+
+                    const auto [i_begin, i_end] = row_range( b );
+
+                    Int * restrict col_idx = A.col_idx.data();
+
+                    Int pos = A.row_ptr[static_cast<size_t>(i_begin)];
+
+                    for( Int i = i_begin; i < i_end; ++i )
+                    {
+                        segments( i, [&]( const Int begin, const Int end, const double p, const double log_q )
+                        {
+                            SampleSegment( random_engine, begin, end, p, log_q, [&]( const Int j ){ col_idx[pos++] = j; } );
+                        });
+                    }
+
+                    const size_t v_begin = static_cast<size_t>(A.row_ptr[static_cast<size_t>(i_begin)]);
+                    const size_t v_end   = static_cast<size_t>(A.row_ptr[static_cast<size_t>(i_end)]);
+
+                    FillValues( states[b], entry_values, A.values.data() + v_begin, v_end - v_begin );
+                }
+            );
+
+            return A;
+        }
+
+        // The states of the streams (rank, 0),...,(rank, block_count - 1). The jumps from one to
+        // the next are serial, so they are done in groups of group_size blocks on the pool.
+        std::vector<state_type> BlockStates( const size_t block_count )
+        {
+            constexpr size_t group_size = 64;
+
+            std::vector<state_type> states ( block_count );
+
+            pool.ParallelFor(
+                (block_count + group_size - 1) / group_size,
+                [&]( const size_t g, const size_t thread )
+                {
+                    (void)thread;
+
+                    const size_t first = group_size * g;
+
+                    partition.ThreadStates( rank, first, &states[first], std::min( group_size, block_count - first ) );
+                }
+            );
+
+            return states;
+        }
+
+        // Fills the n values of a row block from substream 1 of its stream.
+        static void FillValues( const state_type & state, const EntryValues entry_values, Real * a, const size_t n )
+        {
+            switch( entry_values )
+            {
+                case EntryValues::None:
+                {
+                    return;
+                }
+                case EntryValues::Ones:
+                {
+                    std::fill_n( a, n, Real(1) );
+                    return;
+                }
+                default:
+                {
+                    break;
+                }
+            }
+
+            Engine random_engine ( state );
+
+            JumpAhead<Engine>::Apply( random_engine, JumpAhead<Engine>::Get().PowerOfTwo( StreamPartition<Engine>::level_bits ) );
+
+            if( entry_values == EntryValues::Uniform )
+            {
+                Kernels<Engine>().uniform( random_engine, a, n );
+            }
+            else
+            {
+                Kernels<Engine>().normal( random_engine, a, n );
+            }
+        }
+
+        // Turns the strict upper triangle U into U + U^T. Row i of the result is the column i of U
+        // (the entries left of the diagonal) followed by row i of U. The first pass counts the
+        // entries of the columns with atomic increments; the second one writes them through
+        // atomic cursors in arbitrary order and sorts every row afterwards, so the result does not
+        // depend on the scheduling.
+        Matrix_T Symmetrize( Matrix_T && U )
+        {
+            const Int n = U.row_count;
+
+            if( U.row_ptr.empty() )
+            {
+                return std::move(U);
+            }
+
+            const size_t block_count = (static_cast<size_t>(n) + row_block_size - 1) / row_block_size;
+
+            const bool has_values = !U.values.empty();
+
+            std::vector<Int> lower_count ( static_cast<size_t>(n), Int(0) );
+
+            pool.ParallelFor(
+                block_count,
+                [&]( const size_t b, const size_t thread )
+                {
+                    (void)thread;
+
+                    const size_t i_begin = row_block_size * b;
+                    const size_t i_end   = std::min( static_cast<size_t>(n), row_block_size * (b + 1) );
+
+                    for( size_t k = static_cast<size_t>(U.row_ptr[i_begin]); k < static_cast<size_t>(U.row_ptr[i_end]); ++k )
+                    {
+                        std::atomic_ref<Int>( lower_count[static_cast<size_t>(U.col_idx[k])] ).fetch_add( 1, std::memory_order_relaxed );
+                    }
+                }
+            );
+
+            Matrix_T A;
+
+            A.row_count = n;
+            A.col_count = n;
+            A.row_ptr.assign( static_cast<size_t>(n) + 1, Int(0) );
+
+            for( size_t i = 0; i < static_cast<size_t>(n); ++i )
+            {
+                const Int upper_count = U.row_ptr[i+1] - U.row_ptr[i];
+
+                if( upper_count + lower_count[i] > std::numeric_limits<Int>::max() - A.row_ptr[i] )
+                {
+                    eprint(ClassName()+"::Symmetrize: The number of nonzeros exceeds the index type.");
+                    return Matrix_T();
+                }
+
+                A.row_ptr[i+1] = A.row_ptr[i] + lower_count[i] + upper_count;
+            }
+
+            const size_t nnz = static_cast<size_t>(A.NonzeroCount());
+
+            A.col_idx.resize( nnz );
+
+            if( has_values )
+            {
+                A.values.resize( nnz );
+            }
+
+            // lower_count now serves as the cursor into the lower part of every row.
+            std::fill( lower_count.begin(), lower_count.end(), Int(0) );
+
+            pool.ParallelFor(
+                block_count,
+                [&]( const size_t b, const size_t thread )
+                {
+                    (void)thread;
+
+                    const size_t i_begin = row_block_size * b;
+                    const size_t i_end   = std::min( static_cast<size_t>(n), row_block_size * (b + 1) );
+
+                    for( size_t i = i_begin; i < i_end; ++i )
+                    {
+                        const size_t u_begin = static_cast<size_t>(U.row_ptr[i  ]);
+                        const size_t u_end   = static_cast<size_t>(U.row_ptr[i+1]);
+                        const size_t upper   = static_cast<size_t>(A.row_ptr[i+1]) - (u_end - u_begin);
+
+                        for( size_t k = u_begin; k < u_end; ++k )
+                        {
+                            const size_t j = static_cast<size_t>(U.col_idx[k]);
+
+                            const size_t pos = static_cast<size_t>(A.row_ptr[j])
+                                + static_cast<size_t>(std::atomic_ref<Int>( lower_count[j] ).fetch_add( 1, std::memory_order_relaxed ));
+
+                            A.col_idx[upper + k - u_begin] = U.col_idx[k];
+                            A.col_idx[pos]                 = static_cast<Int>(i);
+
+                            if( has_values )
+                            {
+                                A.values[upper + k - u_begin] = U.values[k];
+                                A.values[pos]                 = U.values[k];
+                            }
+                        }
+                    }
+                }
+            );
+
+            // Sort the lower part of every row.
+            pool.ParallelFor(
+                block_count,
+                [&]( const size_t b, const size_t thread )
+                {
+                    (void)thread;
+
+                    const size_t i_begin = row_block_size * b;
+                    const size_t i_end   = std::min( static_cast<size_t>(n), row_block_size * (b + 1) );
+
+                    std::vector<std::pair<Int,Real>> buffer;
+
+                    for( size_t i = i_begin; i < i_end; ++i )
+                    {
+                        const size_t begin = static_cast<size_t>(A.row_ptr[i]);
+                        const size_t end   = begin + static_cast<size_t>(lower_count[i]);
+
+                        if( !has_values )
+                        {
+                            std::sort( A.col_idx.begin() + begin, A.col_idx.begin() + end );
+                            continue;
+                        }
+
+                        buffer.clear();
+
+                        for( size_t k = begin; k < end; ++k )
+                        {
+                            buffer.emplace_back( A.col_idx[k], A.values[k] );
+                        }
+
+                        std::sort( buffer.begin(), buffer.end(), []( const auto & x, const auto & y ){ return x.first < y.first; } );
+
+                        for( size_t k = begin; k < end; ++k )
+                        {
+                            A.col_idx[k] = buffer[k - begin].first;
+                            A.values [k] = buffer[k - begin].second;
+                        }
+                    }
+                }
+            );
+
+            return A;
+        }
+
+    public:
+
+        std::string ClassName() const
+        {
+            return "Randomizor_Graph";
+        }
+    };
+
+    using Randomizor_Graph = Randomizor_Graph_T<Xoshiro256Plus,std::int64_t>;
+}
@@ -0,0 +1,453 @@
+#pragma once
+
+#include "Tools/Tools.hpp"
+
+#include "src/Helpers.hpp"
+#include "src/SplitMix64.hpp"
+#include "src/Xoshiro.hpp"
+#include "src/PCG.hpp"
+#include "src/Lanes.hpp"
+#include "src/ThreadPool.hpp"
+#include "src/Checkpoint.hpp"
+#include "src/Metrics.hpp"
+#include "src/Kernels_Metal.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // Runs the Metal kernels of Randomizor_Metal_Xoshiro or Randomizor_Metal_PCG on the CPU, with
+    // the same states buffer and the same output layout: of the threads_per_grid GPU threads
+    // (threads_per_device rounded down to whole threadgroups), thread i writes the float4 chunks
+    // i, i + threads_per_grid, i + 2 * threads_per_grid, ... of the reservoir. Given the same
+    // states, the uniform reservoirs are bit-identical to the GPU ones, and so are the states
+    // afterwards. The normal reservoirs agree up to the rounding of log, sqrt and sincos, which
+    // differs between the Metal library and the C++ one.
+    //
+    // The usual way in is Load on a checkpoint that Randomizor_Metal_*::Save wrote; Save writes
+    // checkpoints that the Metal samplers can Load, so a sequence can move back and forth.
+    // Seed( seed ) reproduces the states that the Metal Seed derives from seed with the same
+    // CPU_thread_count.
+    //
+    // The GPU threads are processed in tiles of lane_count consecutive threads, as SIMD lanes
+    // (see Lanes.hpp); per grid step, a tile writes lane_count consecutive chunks (4 KiB). The
+    // tiles are handed out by the ThreadPool, so the result does not depend on CPU_thread_count.
+    //
+    // Requests of at most InlineThreshold() samples run on the calling thread, as in
+    // Randomizor_Metal, with the same default threshold; every other fill runs the kernel on all
+    // thread states, as on the GPU. Both go through the states, so all results are reproducible.
+    template<typename Kernel_T>
+    class Randomizor_Metal_Emulator
+    {
+    public:
+
+        using Kernel     = Kernel_T;
+        using Lanes      = typename Kernel::Lanes;
+        using UInt       = std::uint64_t;
+        using state_type = typename Xoshiro256Plus::state_type;
+
+        static constexpr size_t sample_chunk_size = 4;
+
+        // 64-bit words per GPU thread in the states buffer (Randomizor_Metal::StateSize() / 8).
+        static constexpr size_t state_words = 4;
+
+        static constexpr size_t lane_count = 256;
+
+        const size_t threads_per_device;
+
+        const size_t threads_per_threadgroup;
+
+        const size_t CPU_thread_count = 1;
+
+        explicit Randomizor_Metal_Emulator(
+            const size_t threads_per_device_      = 24576*4,
+            const size_t threads_per_threadgroup_ = 1024,
+            const size_t CPU_thread_count_        = 8
+        )
+        :   threads_per_device      ( threads_per_device_ )
+        ,   threads_per_threadgroup ( threads_per_threadgroup_ < 1 ? 1 : threads_per_threadgroup_ )
+        ,   CPU_thread_count        ( CPU_thread_count_ < 1 ? 1 : CPU_thread_count_ )
+        ,   states                  ( state_words * threads_per_device )
+        ,   pool                    ( CPU_thread_count )
+        {}
+
+        ~Randomizor_Metal_Emulator() = default;
+
+    protected:
+
+        std::vector<UInt> states;
+
+        bool seeded = false;
+
+        ThreadPool pool;
+
+        std::vector<float> reservoir;
+
+        float * reservoir_ptr = nullptr;
+
+        size_t reservoir_size = 0;
+
+        std::mutex fill_mutex;
+
+        size_t inline_threshold = 8192;
+
+    public:
+
+        // Number of GPU threads that the Metal samplers actually dispatch.
+        size_t ThreadsPerGrid() const
+        {
+            return (threads_per_device / threads_per_threadgroup) * threads_per_threadgroup;
+        }
+
+        void Seed()
+        {
+            std::random_device r;
+
+            state_type seed;
+            {
+                std::uint32_t* seed_ = reinterpret_cast<std::uint32_t*>(&seed);
+                for( size_t i = 0; i < sizeof(state_type) / sizeof(std::uint32_t); ++i )
+                {
+                    seed_[i] = r();
+                }
+            }
+
+            Seed( seed );
+        }
+
+        // The states of the Metal Seed, after it drew seed from std::random_device.
+        void Seed( const state_type & seed )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Seed", 0, states.size() * sizeof(UInt) );
+
+            std::lock_guard<std::mutex> lock ( fill_mutex );
+
+            Xoshiro256Plus seeder ( seed );
+
+            std::vector<state_type> seeder_states ( CPU_thread_count );
+
+            for( size_t i = 0; i < CPU_thread_count; ++i )
+            {
+                seeder.LongJump();
+                seeder_states[i] = seeder.State();
+            }
+
+            pool.Do(
+                [&]( const size_t thread )
+                {
+                    Xoshiro256Plus random_engine ( seeder_states[thread] );
+
+                    const size_t i_begin = JobPointer(threads_per_device,CPU_thread_count,thread  );
+                    const size_t i_end   = JobPointer(threads_per_device,CPU_thread_count,thread+1);
+
+                    for( size_t i = i_begin; i < i_end; ++i )
+                    {
+                        random_engine.Jump();
+
+                        const state_type s = random_engine.State();
+
+                        for( size_t k = 0; k < state_words; ++k )
+                        {
+                            states[state_words * i + k] = s[k];
+                        }
+                    }
+                }
+            );
+
+            seeded = true;
+        }
+
+        void RequireSeed()
+        {
+            if( !seeded )
+            {
+                Seed();
+            }
+        }
+
+        // The states buffer, with the contents of Randomizor_Metal's states->contents().
+        UInt * States()
+        {
+            return states.data();
+        }
+
+        size_t StatesSize() const
+        {
+            return states.size();
+        }
+
+        // Copies threads_per_device * StateSize() bytes of states, e.g., from a Metal states buffer.
+        void SetStates( const void * data )
+        {
+            std::lock_guard<std::mutex> lock ( fill_mutex );
+
+            std::memcpy( states.data(), data, states.size() * sizeof(UInt) );
+
+            seeded = true;
+        }
+
+        size_t InlineThreshold() const
+        {
+            return inline_threshold;
+        }
+
+        void SetInlineThreshold( const size_t n )
+        {
+            inline_threshold = n;
+        }
+
+        // Same rounding as Randomizor_Metal::ReservoirSize.
+        size_t RoundedReservoirSize( const size_t n ) const
+        {
+            const size_t samples_per_thread = sample_chunk_size * (n + threads_per_device - 1) / (sample_chunk_size * threads_per_device);
+
+            return samples_per_thread * threads_per_device;
+        }
+
+        size_t ReservoirSize( const size_t n )
+        {
+            reservoir_size = RoundedReservoirSize(n);
+
+            return reservoir_size;
+        }
+
+        size_t ReservoirSize() const
+        {
+            return reservoir_size;
+        }
+
+        void RequireReservoir( const size_t n )
+        {
+            const size_t m = ReservoirSize(n);
+
+            if( reservoir.size() < m )
+            {
+                reservoir.resize( std::max( m, reservoir.size() + reservoir.size() / 2 ) );
+            }
+
+            reservoir_ptr = reservoir.data();
+        }
+
+        void LoadReservoir( float * external_reservoir, const size_t external_size )
+        {
+            if( ReservoirSize(external_size) == external_size )
+            {
+                reservoir_ptr = external_reservoir;
+            }
+            else
+            {
+                eprint(ClassName()+"::LoadReservoir: ReservoirSize(external_size) != external_size. Please allocate memory for ReservoirSize(external_size) floats.");
+            }
+        }
+
+        float * Reservoir()
+        {
+            return reservoir_ptr;
+        }
+
+        // Writes a checkpoint in the format of Randomizor_Metal::Save.
+        bool Save( const std::string & path )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Save", 0, states.size() * sizeof(UInt) );
+
+            RequireSeed();
+
+            std::lock_guard<std::mutex> lock ( fill_mutex );
+
+            return SaveCheckpoint(
+                path, Kernel::MetalClassName(),
+                threads_per_device, state_words * sizeof(UInt),
+                states.data()
+            );
+        }
+
+        // Reads a checkpoint that Randomizor_Metal::Save (or Save) wrote for the same kernel and
+        // threads_per_device. On failure, the previous states stay in place and false is returned.
+        bool Load( const std::string & path, const bool verify = true )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Load", 0, states.size() * sizeof(UInt) );
+
+            MappedFile file;
+
+            const unsigned char * payload = LoadCheckpoint(
+                file, path, Kernel::MetalClassName(), threads_per_device, state_words * sizeof(UInt), verify
+            );
+
+            if( payload == nullptr )
+            {
+                return false;
+            }
+
+            SetStates( payload );
+
+            return true;
+        }
+
+    protected:
+
+        // Runs the kernel on a[0],...,a[n-1], i.e., on n / 4 chunks; a trailing partial chunk is
+        // left alone, as on the GPU.
+        template<bool normal>
+        void RandomizeArray( float * restrict const a, const size_t n )
+        {
+            RequireSeed();
+
+            std::lock_guard<std::mutex> lock ( fill_mutex );
+
+            const size_t C = n / sample_chunk_size;
+            const size_t T = ThreadsPerGrid();
+
+            // The kernels write their states back only inside the grid loop.
+            if( (C == 0) || (T == 0) )
+            {
+                return;
+            }
+
+            // Number of chunks of GPU thread i.
+            auto chunk_count = [C,T]( const size_t i )
+            {
+                return (i < C) ? (C - i + T - 1) / T : size_t(0);
+            };
+
+            const size_t tile_count = (T + lane_count - 1) / lane_count;
+
+            pool.ParallelFor(
+                tile_count,
+                [&,a]( const size_t tile, const size_t thread )
+                {
+                    (void)thread;
+
+                    const size_t i_begin = lane_count * tile;
+                    const size_t m       = std::min( lane_count, T - i_begin );
+
+                    std::array<typename Kernel::state_type,lane_count> s;
+
+                    for( size_t l = 0; l < m; ++l )
+                    {
+                        s[l] = Kernel::LoadState( states.data(), i_begin + l );
+                    }
+
+                    Lanes lanes ( s.data(), m );
+
+                    std::array<std::uint32_t,4 * lane_count> bits;
+
+                    // All lanes of the tile take part in the first rounds; in the last one,
+                    // only a prefix may.
+                    const size_t full_rounds = chunk_count( i_begin + m - 1 );
+
+                    for( size_t j = 0; j < full_rounds; ++j )
+                    {
+                        float * restrict b = &a[sample_chunk_size * (j * T + i_begin)];
+
+                        if constexpr ( normal )
+                        {
+                            Normal_Chunks( lanes, b, 1, bits.data() );
+                        }
+                        else
+                        {
+                            Uniform_Chunks( lanes, b, 1, bits.data() );
+                        }
+                    }
+
+                    for( size_t l = 0; (l < m) && (chunk_count( i_begin + l ) > full_rounds); ++l )
+                    {
+                        float * restrict u = &a[sample_chunk_size * (full_rounds * T + i_begin + l)];
+
+                        typename Kernel::state_type x = lanes.State( l );
+
+                        Kernel::Chunk( x, u );
+
+                        if constexpr ( normal )
+                        {
+                            BoxMuller_Chunk( u );
+                        }
+
+                        lanes.SetState( l, x );
+                    }
+
+                    for( size_t l = 0; l < m; ++l )
+                    {
+                        Kernel::StoreState( states.data(), i_begin + l, lanes.State( l ) );
+                    }
+                }
+            );
+        }
+
+        template<bool normal>
+        void RandomizeReservoir()
+        {
+            if( (reservoir_ptr == nullptr) || (reservoir_size <= 0) )
+            {
+                eprint(ClassName()+"::RandomizeReservoir: Empty reservoir. Create a reservoir with RequireReservoir or with LoadReservoir.");
+                return;
+            }
+
+            RandomizeArray<normal>( reservoir_ptr, reservoir_size );
+        }
+
+        // Like Randomizor_Metal::Fill_*( a, n ): up to the inline threshold, RandomizeChunks_CPU
+        // computes the first n floats of a reservoir fill. Above, the kernel runs on
+        // ReservoirSize(n) floats and the first n are copied to a. If there is nothing to cut off,
+        // we write to a directly.
+        template<bool normal>
+        void RandomizeRequest( float * a, const size_t n )
+        {
+            if( n <= inline_threshold )
+            {
+                RequireSeed();
+
+                std::lock_guard<std::mutex> lock ( fill_mutex );
+
+                RandomizeChunks_CPU<Kernel,normal>( states.data(), ThreadsPerGrid(), a, n );
+            }
+            else if( (RoundedReservoirSize(n) == n) && (n % sample_chunk_size == 0) )
+            {
+                RandomizeArray<normal>( a, n );
+            }
+            else
+            {
+                RequireReservoir(n);
+                RandomizeReservoir<normal>();
+                std::memcpy( a, Reservoir(), n * sizeof(float) );
+            }
+        }
+
+    public:
+
+        void Fill_Uniform()
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Fill_Uniform", reservoir_size, reservoir_size * sizeof(float) );
+
+            RandomizeReservoir<false>();
+        }
+
+        void Fill_Normal()
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Fill_Normal", reservoir_size, reservoir_size * sizeof(float) );
+
+            RandomizeReservoir<true>();
+        }
+
+        void Fill_Uniform( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Fill_Uniform", n, n * sizeof(float) );
+
+            RandomizeRequest<false>( a, n );
+        }
+
+        void Fill_Normal( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_Emulator::Fill_Normal", n, n * sizeof(float) );
+
+            RandomizeRequest<true>( a, n );
+        }
+
+        std::string ClassName() const
+        {
+            return "Randomizor_Metal_Emulator<"+Kernel::MetalClassName()+">";
+        }
+    };
+
+    using Randomizor_Metal_Xoshiro_Emulator = Randomizor_Metal_Emulator<Xoshiro256Plus_Metal_Kernel>;
+    using Randomizor_Metal_PCG_Emulator     = Randomizor_Metal_Emulator<PCG_Metal_Kernel>;
+}
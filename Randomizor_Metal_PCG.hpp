@@ -3,7 +3,7 @@
 #include "src/Randomizor_Metal.hpp"
 
 #include "src/SplitMix64.hpp"
-#include "src/Xoshiro256Plus.hpp"
+#include "src/Xoshiro.hpp"
 
 namespace Randomizor
 {
@@ -47,10 +47,10 @@ namespace Randomizor
         
         virtual void Seed() override
         {
-            ptic(ClassName()+"::Seed");
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_PCG::Seed", 0, threads_per_device * StateSize() );
             
             states = NS::TransferPtr(
-                 device->newBuffer( threads_per_device * 4 * sizeof(uint64_t), Managed )
+                 device->newBuffer( threads_per_device * StateSize(), Managed )
             );
             
             uint64_t * restrict states_ptr = reinterpret_cast<uint64_t *>(states->contents());
@@ -102,8 +102,6 @@ namespace Randomizor
             );
             
             states->didModifyRange({0,states->length()});
-            
-            ptoc(ClassName()+"::Seed");
         }
         
         void Compile() override
@@ -127,18 +125,31 @@ namespace Randomizor
         
     public:
         
+        using Randomizor_Metal::Fill_Uniform;
+        using Randomizor_Metal::Fill_Normal;
+        
         virtual void Fill_Uniform() override
         {
-            ptic(ClassName()+"::Fill_Uniform");
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_PCG::Fill_Uniform", reservoir_size, reservoir_size * sizeof(float) );
+            
             RandomizeReservoir("PCG_UniformDistribution");
-            ptoc(ClassName()+"::Fill_Uniform");
         }
         
         virtual void Fill_Normal() override
         {
-            ptic(ClassName()+"::Fill_Normal");
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal_PCG::Fill_Normal", reservoir_size, reservoir_size * sizeof(float) );
+            
             RandomizeReservoir("PCG_NormalDistribution");
-            ptoc(ClassName()+"::Fill_Normal");
+        }
+        
+        virtual void Fill_Uniform_CPU( float * a, const size_t n ) override
+        {
+            RandomizeArray_CPU<PCG_Metal_Kernel,false>( a, n );
+        }
+        
+        virtual void Fill_Normal_CPU( float * a, const size_t n ) override
+        {
+            RandomizeArray_CPU<PCG_Metal_Kernel,true>( a, n );
         }
         
     public:
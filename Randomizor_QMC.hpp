@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Tools/Tools.hpp"
+
+#include "src/Helpers.hpp"
+#include "src/SplitMix64.hpp"
+#include "src/NUMA.hpp"
+#include "src/ThreadPool.hpp"
+#include "src/Sobol.hpp"
+#include "src/Halton.hpp"
+#include "src/Metrics.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // A multithreaded sampler of quasi-random points, with the fill API of Randomizor_CPU.
+    //
+    // Sequence_T is Sobol or Halton. The sampler keeps the index of the next point: every fill
+    // continues the sequence where the previous one stopped, and SetIndex skips to any point.
+    // A fill of n floats consumes ceil(n / Dimension()) points, written point by point, so the
+    // last one may be cut off; keep n a multiple of Dimension() to use every point in full.
+    //
+    // The points are split into blocks of block_size points that the ThreadPool hands out; every
+    // block starts with a skip to its first index. So the result depends only on the sequence,
+    // its scrambling and the index, but not on CPU_thread_count.
+    template<typename Sequence_T>
+    class Randomizor_QMC
+    {
+    public:
+
+        using Sequence    = Sequence_T;
+        using UInt        = std::uint64_t;
+        using result_type = float;
+
+        static constexpr size_t block_size = 4096;
+
+        const size_t CPU_thread_count = 1;
+
+        explicit Randomizor_QMC(
+            const size_t     dimension,
+            const Scrambling scrambling       = Scrambling::None,
+            const UInt       seed             = 0,
+            const size_t     CPU_thread_count_ = 8
+        )
+        :   CPU_thread_count ( CPU_thread_count_ < 1 ? 1 : CPU_thread_count_ )
+        ,   sequence         ( dimension, scrambling, seed )
+        ,   pool             ( CPU_thread_count )
+        {}
+
+        ~Randomizor_QMC() = default;
+
+    protected:
+
+        Sequence sequence;
+
+        ThreadPool pool;
+
+        UInt index = 0;
+
+        std::vector<float> reservoir;
+
+        float * reservoir_ptr = nullptr;
+
+        size_t reservoir_size = 0;
+
+        std::mutex fill_mutex;
+
+    public:
+
+        size_t Dimension() const
+        {
+            return sequence.Dimension();
+        }
+
+        // Index of the next point.
+        UInt Index() const
+        {
+            return index;
+        }
+
+        void SetIndex( const UInt index_ )
+        {
+            std::lock_guard<std::mutex> lock ( fill_mutex );
+
+            index = index_;
+        }
+
+        void RequireReservoir( const size_t n )
+        {
+            reservoir.resize( n );
+
+            reservoir_ptr  = reservoir.data();
+            reservoir_size = n;
+        }
+
+        void LoadReservoir( float * external_reservoir, const size_t external_size )
+        {
+            reservoir_ptr  = external_reservoir;
+            reservoir_size = external_size;
+        }
+
+        float * Reservoir()
+        {
+            return reservoir_ptr;
+        }
+
+        size_t ReservoirSize() const
+        {
+            return reservoir_size;
+        }
+
+    protected:
+
+        // Calls fill( first_index, point_count, pointer ) on blocks of the next ceil(n / Dimension())
+        // points, writing to a[0],...,a[n-1].
+        template<typename Fill_T>
+        void RandomizeArray( float * restrict const a, const size_t n, Fill_T && fill )
+        {
+            std::lock_guard<std::mutex> lock ( fill_mutex );
+
+            const size_t d = Dimension();
+
+            const size_t full_count  = n / d;
+            const size_t point_count = (n + d - 1) / d;
+
+            if( index + point_count > Sequence::max_point_count )
+            {
+                eprint(ClassName()+"::RandomizeArray: The sequence has only "+ToString(Sequence::max_point_count)+" points.");
+                return;
+            }
+
+            const UInt   first       = index;
+            const size_t block_count = (full_count + block_size - 1) / block_size;
+
+            pool.ParallelFor(
+                block_count,
+                [&,a]( const size_t k, const size_t thread )
+                {
+                    (void)thread;
+
+                    const size_t p_begin = k * block_size;
+                    const size_t p_end   = std::min( p_begin + block_size, full_count );
+
+                    fill( first + p_begin, p_end - p_begin, &a[d * p_begin] );
+                }
+            );
+
+            if( point_count > full_count )
+            {
+                std::vector<float> last ( d );
+
+                fill( first + full_count, 1, last.data() );
+
+                std::copy( last.begin(), last.begin() + static_cast<std::ptrdiff_t>(n - d * full_count), &a[d * full_count] );
+            }
+
+            index += point_count;
+        }
+
+        template<typename Fill_T>
+        void RandomizeReservoir( Fill_T && fill )
+        {
+            if( (reservoir_ptr == nullptr) || (reservoir_size <= 0) )
+            {
+                eprint(ClassName()+"::RandomizeReservoir: Empty reservoir. Create a reservoir with RequireReservoir or with LoadReservoir.");
+                return;
+            }
+
+            RandomizeArray( reservoir_ptr, reservoir_size, std::forward<Fill_T>(fill) );
+        }
+
+    public:
+
+        void Fill_Uniform()
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_QMC::Fill_Uniform", reservoir_size, reservoir_size * sizeof(float) );
+
+            RandomizeReservoir(
+                [this]( const UInt first, const size_t count, float * b )
+                {
+                    sequence.Fill_Uniform( first, count, b );
+                }
+            );
+        }
+
+        void Fill_Normal()
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_QMC::Fill_Normal", reservoir_size, reservoir_size * sizeof(float) );
+
+            RandomizeReservoir(
+                [this]( const UInt first, const size_t count, float * b )
+                {
+                    sequence.Fill_Normal( first, count, b );
+                }
+            );
+        }
+
+        void Fill_Uniform( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_QMC::Fill_Uniform", n, n * sizeof(float) );
+
+            RandomizeArray(
+                a, n,
+                [this]( const UInt first, const size_t count, float * b )
+                {
+                    sequence.Fill_Uniform( first, count, b );
+                }
+            );
+        }
+
+        void Fill_Normal( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_QMC::Fill_Normal", n, n * sizeof(float) );
+
+            RandomizeArray(
+                a, n,
+                [this]( const UInt first, const size_t count, float * b )
+                {
+                    sequence.Fill_Normal( first, count, b );
+                }
+            );
+        }
+
+        std::string ClassName() const
+        {
+            return "Randomizor_QMC<"+Sequence::ClassName()+">";
+        }
+    };
+}
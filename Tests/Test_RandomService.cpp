@@ -0,0 +1,123 @@
+// Checks that destroying a RandomService serves the requests that are still pending: blocked
+// Fill_Normal calls return with their samples, and the futures of asynchronous requests become
+// ready, without waiting for max_delay.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Test_RandomService.cpp -o Test_RandomService
+//
+// Prints one line per check and returns 1 if any of them fails.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Randomizor_CPU.hpp"
+#include "../src/RandomService.hpp"
+
+using Randomizor::Randomizor_CPU;
+
+using Service = Randomizor::RandomService<Randomizor_CPU>;
+
+using Clock = std::chrono::steady_clock;
+
+static bool all_passed = true;
+
+static void Check( const bool passed, const std::string & name )
+{
+    std::cout << (passed ? "passed " : "FAILED ") << name << std::endl;
+
+    all_passed = all_passed && passed;
+}
+
+// Whether the sentinel NaNs have all been overwritten.
+static bool Filled( const std::vector<float> & a )
+{
+    for( const float x : a )
+    {
+        if( std::isnan( x ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    const size_t n            = 1000;
+    const size_t thread_count = 8;
+    const size_t async_count  = 16;
+
+    Randomizor_CPU gen ( 64, 4 );
+
+    gen.Seed( std::uint64_t(0) );
+
+    // Neither the batch size nor the delay is ever reached, so only the destructor serves.
+    auto service = std::make_unique<Service>( gen, size_t(1) << 30, std::chrono::seconds(10) );
+
+    std::vector<std::vector<float>> a ( thread_count,  std::vector<float>( n, NAN ) );
+    std::vector<std::vector<float>> b ( async_count,   std::vector<float>( n, NAN ) );
+
+    std::vector<std::future<void>> futures;
+
+    for( size_t i = 0; i < async_count; ++i )
+    {
+        futures.push_back( (i % 2 == 0)
+            ? service->Fill_Normal_Async ( b[i].data(), n )
+            : service->Fill_Uniform_Async( b[i].data(), n )
+        );
+    }
+
+    std::vector<std::thread> threads;
+
+    Service * s = service.get();
+
+    for( size_t i = 0; i < thread_count; ++i )
+    {
+        threads.emplace_back( [&a,s,i](){ s->Fill_Normal( a[i].data(), n ); } );
+    }
+
+    // Let the threads block in Fill_Normal.
+    std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+
+    Check( service->RequestCount() == 0, "no request served before the destructor" );
+
+    const auto start = Clock::now();
+
+    service.reset();
+
+    const double t = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for( auto & thread : threads )
+    {
+        thread.join();
+    }
+
+    bool all_filled = true;
+
+    for( size_t i = 0; i < thread_count; ++i )
+    {
+        all_filled = all_filled && Filled( a[i] );
+    }
+
+    Check( all_filled, "blocked Fill_Normal calls are served" );
+
+    bool all_ready = true;
+
+    for( size_t i = 0; i < async_count; ++i )
+    {
+        all_ready = all_ready
+            && (futures[i].wait_for( std::chrono::seconds(0) ) == std::future_status::ready)
+            && Filled( b[i] );
+    }
+
+    Check( all_ready, "asynchronous requests are served" );
+
+    Check( t < 5., "the destructor does not wait for max_delay" );
+
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// Checks that fills of Randomizor_CPU depend only on the seed (or the loaded states) and on
+// stream_count: the same request after the same Seed gives the same samples, whether it runs
+// inline on the calling thread or on the pool, and whichever thread issues it.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -pthread Test_Reproducibility.cpp -o Test_Reproducibility
+//
+// Prints one line per check and returns 1 if any of them fails.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../Randomizor_CPU.hpp"
+
+using Randomizor::Randomizor_CPU;
+
+static bool all_passed = true;
+
+static void Check( const bool passed, const std::string & name )
+{
+    std::cout << (passed ? "passed " : "FAILED ") << name << std::endl;
+
+    all_passed = all_passed && passed;
+}
+
+// Seeds gen with seed, sets its inline threshold and returns fill( gen ) on n floats.
+template<typename Fill_T>
+static std::vector<float> Sample( Randomizor_CPU & gen, const std::uint64_t seed, const size_t threshold, const size_t n, Fill_T && fill )
+{
+    std::vector<float> a ( n );
+
+    gen.SetInlineThreshold( threshold );
+    gen.Seed( seed );
+
+    fill( gen, a.data(), n );
+
+    return a;
+}
+
+template<typename Fill_T>
+static void CheckFill( const std::string & name, Fill_T && fill )
+{
+    Randomizor_CPU gen ( 64, 4 );
+
+    for( const size_t n : { size_t(1), size_t(7), size_t(1000), size_t(100000) } )
+    {
+        const std::string tag = name + ", n = " + std::to_string(n);
+
+        const std::vector<float> a = Sample( gen, 17, 32768, n, fill );
+        const std::vector<float> b = Sample( gen, 17, 32768, n, fill );
+        const std::vector<float> c = Sample( gen, 17, 0,     n, fill );
+        const std::vector<float> d = Sample( gen, 18, 32768, n, fill );
+
+        Check( a == b, tag + ": same seed, same samples" );
+        Check( a == c, tag + ": inline and pool agree" );
+        Check( (n < 4) || (a != d), tag + ": another seed, other samples" );
+
+        // From another thread.
+        std::vector<float> e;
+
+        std::thread( [&](){ e = Sample( gen, 17, 32768, n, fill ); } ).join();
+
+        Check( a == e, tag + ": independent of the calling thread" );
+    }
+}
+
+int main()
+{
+    CheckFill( "Fill_Uniform",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_Uniform( a, n ); }
+    );
+
+    CheckFill( "Fill_Normal",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_Normal( a, n ); }
+    );
+
+    CheckFill( "Fill_Normal( mu, sigma )",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_Normal( a, n, 1.f, 2.f ); }
+    );
+
+    CheckFill( "Fill_TruncatedNormal",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_TruncatedNormal( a, n, 0., 1., 0.5, 3. ); }
+    );
+
+    CheckFill( "Fill_Normal( Antithetic )",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_Normal( a, n, Randomizor::VarianceReduction::Antithetic ); }
+    );
+
+    CheckFill( "Fill_Uniform( Stratified )",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_Uniform( a, n, Randomizor::VarianceReduction::Stratified ); }
+    );
+
+    CheckFill( "Fill_Normal( Stratified )",
+        []( Randomizor_CPU & gen, float * a, const size_t n ){ gen.Fill_Normal( a, n, Randomizor::VarianceReduction::Stratified ); }
+    );
+
+    // Save and Load restore the streams, also for small fills.
+    {
+        Randomizor_CPU gen ( 64, 4 );
+
+        std::vector<float> a ( 1000 );
+        std::vector<float> b ( 1000 );
+
+        gen.Seed( std::uint64_t(5) );
+        gen.Fill_Normal( a.data(), a.size() );
+
+        const bool saved = gen.Save( "Test_Reproducibility.checkpoint" );
+
+        gen.Fill_Normal( a.data(), a.size() );
+
+        const bool loaded = gen.Load( "Test_Reproducibility.checkpoint" );
+
+        gen.Fill_Normal( b.data(), b.size() );
+
+        Check( saved && loaded && (a == b), "Fill_Normal, n = 1000: continues after Load" );
+
+        std::remove( "Test_Reproducibility.checkpoint" );
+    }
+
+    return all_passed ? 0 : 1;
+}
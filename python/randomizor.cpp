@@ -0,0 +1,1287 @@
+// randomizor: a Python module with the samplers of Randomizor_CPU.hpp and Randomizor_QMC.hpp.
+//
+// The fills write into caller-provided arrays through the buffer protocol, so NumPy arrays are
+// filled in place, without a copy, and the GIL is released while the samplers run:
+//
+//     import numpy as np, randomizor
+//
+//     gen = randomizor.Generator( stream_count = 1024, thread_count = 8, seed = 0 )
+//     a = np.empty( 1 << 24, dtype = np.float32 )
+//     gen.fill_normal( a )                                 # in place; also returns a
+//     gen.fill_normal( a, mu = 2., sigma = 0.5 )
+//     gen.fill_uniform( a, mode = "antithetic" )           # or "stratified"
+//     gen.fill_truncated_normal( a, lower = 0. )
+//     gen.fill_latin_hypercube( np.empty( (1000, 8), dtype = np.float32 ) )
+//     gen.fill_bits( np.empty( 1 << 20, dtype = np.uint64 ) )
+//     gen.fill_bernoulli( np.empty( 1 << 20, dtype = np.uint8 ), 0.1 )   # uint64: 64 per word
+//
+//     gen.require_reservoir( 1 << 24 )
+//     r = np.asarray( gen.reservoir )                      # a view, not a copy
+//     gen.fill_uniform()                                   # without an array: fills the reservoir
+//
+// The samples are float32, the raw bits uint64, and the Bernoulli samples uint64 (packed) or
+// uint8 (one per byte). Arrays must be C-contiguous and of exactly that dtype; nothing is
+// converted. The reservoir is exported as a one-dimensional float32 buffer; while a view of it
+// is alive, require_reservoir raises BufferError, as bytearray does when it is resized.
+// Sobol and Halton are the quasi-random samplers, with the same fill_uniform and fill_normal.
+//
+// The samples depend only on the seed and on stream_count, for small arrays as for large ones.
+//
+// Compile on Linux, e.g., with
+//     g++ -std=c++20 -O3 -march=native -DNDEBUG -pthread -shared -fPIC $(python3-config --includes) randomizor.cpp -o randomizor$(python3-config --extension-suffix)
+
+#define PY_SSIZE_T_CLEAN
+
+#include <Python.h>
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <optional>
+#include <random>
+
+#include "../Randomizor_CPU.hpp"
+#include "../Randomizor_QMC.hpp"
+
+namespace
+{
+    using namespace Randomizor;
+
+    using Generator = Randomizor_CPU;
+
+    // Whether a buffer format is one of the single-character codes, in native byte order.
+    bool FormatMatches( const char * format, const char * codes )
+    {
+        if( format == nullptr )
+        {
+            format = "B";
+        }
+
+        if( (*format == '@') || (*format == '=') || ((*format == '<') && (std::endian::native == std::endian::little)) )
+        {
+            ++format;
+        }
+
+        return (format[0] != '\0') && (format[1] == '\0') && (std::strchr( codes, format[0] ) != nullptr);
+    }
+
+    // A C-contiguous buffer of a Python object (e.g., a NumPy array), released by the destructor.
+    // If the object does not provide one, the Python exception is set and the buffer is empty.
+    class Buffer
+    {
+    public:
+
+        Py_buffer view {};
+
+        bool held = false;
+
+        Buffer( PyObject * object, const bool writable )
+        {
+            const int flags = PyBUF_FORMAT | PyBUF_C_CONTIGUOUS | (writable ? PyBUF_WRITABLE : 0);
+
+            held = (PyObject_GetBuffer( object, &view, flags ) == 0);
+        }
+
+        ~Buffer()
+        {
+            if( held )
+            {
+                PyBuffer_Release( &view );
+            }
+        }
+
+        Buffer( const Buffer & ) = delete;
+
+        Buffer & operator=( const Buffer & ) = delete;
+
+        bool Is( const char * codes, const Py_ssize_t itemsize ) const
+        {
+            return held && (view.itemsize == itemsize) && FormatMatches( view.format, codes );
+        }
+
+        // Like Is, but sets a TypeError if the item type does not match.
+        bool Require( const char * codes, const Py_ssize_t itemsize, const char * name, const char * dtype ) const
+        {
+            if( !held )
+            {
+                return false;
+            }
+
+            if( !Is( codes, itemsize ) )
+            {
+                PyErr_Format( PyExc_TypeError, "%s must be a C-contiguous array of %s, not of format '%s'.",
+                    name, dtype, view.format == nullptr ? "B" : view.format
+                );
+                return false;
+            }
+
+            return true;
+        }
+
+        template<typename T>
+        T * Data() const
+        {
+            return static_cast<T *>(view.buf);
+        }
+
+        size_t Size() const
+        {
+            return static_cast<size_t>(view.len / view.itemsize);
+        }
+    };
+
+    // Runs f() without the GIL. A C++ exception is turned into a Python exception, and false is
+    // returned.
+    template<typename F>
+    bool WithoutGIL( F && f )
+    {
+        bool out_of_memory = false;
+        bool failed        = false;
+
+        Py_BEGIN_ALLOW_THREADS
+        try
+        {
+            f();
+        }
+        catch( const std::bad_alloc & )
+        {
+            out_of_memory = true;
+        }
+        catch( ... )
+        {
+            failed = true;
+        }
+        Py_END_ALLOW_THREADS
+
+        if( out_of_memory )
+        {
+            PyErr_NoMemory();
+        }
+        else if( failed )
+        {
+            PyErr_SetString( PyExc_RuntimeError, "The sampler failed." );
+        }
+
+        return !(out_of_memory || failed);
+    }
+
+    bool IsNone( PyObject * object )
+    {
+        return (object == nullptr) || (object == Py_None);
+    }
+
+    PyObject * NewReference( PyObject * object )
+    {
+        Py_INCREF( object );
+        return object;
+    }
+
+    bool ParseVarianceReduction( const char * name, VarianceReduction & mode )
+    {
+        if( std::strcmp( name, "none" ) == 0 )
+        {
+            mode = VarianceReduction::None;
+        }
+        else if( std::strcmp( name, "antithetic" ) == 0 )
+        {
+            mode = VarianceReduction::Antithetic;
+        }
+        else if( std::strcmp( name, "stratified" ) == 0 )
+        {
+            mode = VarianceReduction::Stratified;
+        }
+        else
+        {
+            PyErr_Format( PyExc_ValueError, "Unknown mode '%s'; use 'none', 'antithetic' or 'stratified'.", name );
+            return false;
+        }
+
+        return true;
+    }
+
+    bool ParseScrambling( const char * name, Scrambling & scrambling )
+    {
+        if( std::strcmp( name, "none" ) == 0 )
+        {
+            scrambling = Scrambling::None;
+        }
+        else if( std::strcmp( name, "digital_shift" ) == 0 )
+        {
+            scrambling = Scrambling::DigitalShift;
+        }
+        else if( std::strcmp( name, "owen" ) == 0 )
+        {
+            scrambling = Scrambling::Owen;
+        }
+        else
+        {
+            PyErr_Format( PyExc_ValueError, "Unknown scrambling '%s'; use 'none', 'digital_shift' or 'owen'.", name );
+            return false;
+        }
+
+        return true;
+    }
+
+
+    // Reservoirs as buffers ////////////////////////////////////////////////////////////////////
+
+    // The objects of both kinds of samplers start with these fields. exports counts the live
+    // views of the reservoir and the running fills of it; the reservoir must not move meanwhile.
+    template<typename Sampler_T>
+    struct SamplerObject
+    {
+        PyObject_HEAD
+
+        Sampler_T * sampler;
+
+        Py_ssize_t exports;
+
+        Py_ssize_t shape;
+
+        Py_ssize_t stride;
+    };
+
+    template<typename Object>
+    int Reservoir_GetBuffer( PyObject * self_, Py_buffer * view, int flags )
+    {
+        Object * self = reinterpret_cast<Object *>(self_);
+
+        float * a = self->sampler->Reservoir();
+
+        const size_t n = self->sampler->ReservoirSize();
+
+        if( (a == nullptr) || (n == 0) )
+        {
+            view->obj = nullptr;
+            PyErr_SetString( PyExc_BufferError, "Empty reservoir. Create it with require_reservoir." );
+            return -1;
+        }
+
+        self->shape  = static_cast<Py_ssize_t>(n);
+        self->stride = sizeof(float);
+
+        view->obj        = NewReference( self_ );
+        view->buf        = a;
+        view->len        = self->shape * self->stride;
+        view->readonly   = 0;
+        view->itemsize   = sizeof(float);
+        view->format     = (flags & PyBUF_FORMAT) ? const_cast<char *>("f") : nullptr;
+        view->ndim       = 1;
+        view->shape      = (flags & PyBUF_ND) ? &self->shape : nullptr;
+        view->strides    = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? &self->stride : nullptr;
+        view->suboffsets = nullptr;
+        view->internal   = nullptr;
+
+        ++self->exports;
+
+        return 0;
+    }
+
+    template<typename Object>
+    void Reservoir_ReleaseBuffer( PyObject * self_, Py_buffer * )
+    {
+        --reinterpret_cast<Object *>(self_)->exports;
+    }
+
+    template<typename Object>
+    PyObject * Reservoir_Get( PyObject * self, void * )
+    {
+        return PyMemoryView_FromObject( self );
+    }
+
+    template<typename Object>
+    PyObject * ReservoirSize_Get( PyObject * self, void * )
+    {
+        return PyLong_FromSize_t( reinterpret_cast<Object *>(self)->sampler->ReservoirSize() );
+    }
+
+    template<typename Object>
+    PyObject * RequireReservoir( PyObject * self_, PyObject * args )
+    {
+        Object * self = reinterpret_cast<Object *>(self_);
+
+        Py_ssize_t n = 0;
+
+        if( !PyArg_ParseTuple( args, "n", &n ) )
+        {
+            return nullptr;
+        }
+
+        if( n < 0 )
+        {
+            PyErr_SetString( PyExc_ValueError, "The reservoir size must not be negative." );
+            return nullptr;
+        }
+
+        if( self->exports > 0 )
+        {
+            PyErr_SetString( PyExc_BufferError, "Cannot resize the reservoir while views of it exist." );
+            return nullptr;
+        }
+
+        try
+        {
+            self->sampler->RequireReservoir( static_cast<size_t>(n) );
+        }
+        catch( const std::bad_alloc & )
+        {
+            return PyErr_NoMemory();
+        }
+
+        if( (n > 0) && (self->sampler->Reservoir() == nullptr) )
+        {
+            return PyErr_NoMemory();
+        }
+
+        Py_RETURN_NONE;
+    }
+
+    struct AnySize
+    {
+        bool operator()( const size_t ) const
+        {
+            return true;
+        }
+    };
+
+    // Calls fill( a, n, reservoir ) without the GIL on the float32 array out or, if out is None,
+    // on the reservoir, after check( n ) has accepted the size. Returns out, or None for the
+    // reservoir.
+    template<typename Object, typename Fill_T, typename Check_T = AnySize>
+    PyObject * FillFloats( Object * self, PyObject * out, Fill_T && fill, Check_T && check = Check_T() )
+    {
+        if( IsNone( out ) )
+        {
+            float * a = self->sampler->Reservoir();
+
+            const size_t n = self->sampler->ReservoirSize();
+
+            if( (a == nullptr) || (n == 0) )
+            {
+                PyErr_SetString( PyExc_ValueError, "Empty reservoir. Create it with require_reservoir or pass an array." );
+                return nullptr;
+            }
+
+            if( !check( n ) )
+            {
+                return nullptr;
+            }
+
+            ++self->exports;
+
+            const bool success = WithoutGIL( [&](){ fill( a, n, true ); } );
+
+            --self->exports;
+
+            if( !success )
+            {
+                return nullptr;
+            }
+
+            Py_RETURN_NONE;
+        }
+
+        Buffer buffer ( out, true );
+
+        if( !buffer.Require( "f", sizeof(float), "out", "float32" ) || !check( buffer.Size() ) )
+        {
+            return nullptr;
+        }
+
+        if( !WithoutGIL( [&](){ fill( buffer.Data<float>(), buffer.Size(), false ); } ) )
+        {
+            return nullptr;
+        }
+
+        return NewReference( out );
+    }
+
+
+    // Generator ////////////////////////////////////////////////////////////////////////////////
+
+    using GeneratorObject = SamplerObject<Generator>;
+
+    PyObject * Generator_New( PyTypeObject * type, PyObject * args, PyObject * kwargs )
+    {
+        static const char * keywords [] = { "stream_count", "thread_count", "seed", "pin_threads", nullptr };
+
+        Py_ssize_t stream_count = 1024;
+        Py_ssize_t thread_count = 8;
+        PyObject * seed         = nullptr;
+        int        pin_threads  = 0;
+
+        if( !PyArg_ParseTupleAndKeywords( args, kwargs, "|nnOp", const_cast<char **>(keywords),
+                &stream_count, &thread_count, &seed, &pin_threads
+            )
+        )
+        {
+            return nullptr;
+        }
+
+        if( (stream_count < 1) || (thread_count < 1) )
+        {
+            PyErr_SetString( PyExc_ValueError, "stream_count and thread_count must be positive." );
+            return nullptr;
+        }
+
+        Generator::UInt seed_value = 0;
+
+        if( !IsNone( seed ) )
+        {
+            seed_value = PyLong_AsUnsignedLongLongMask( seed );
+
+            if( PyErr_Occurred() )
+            {
+                return nullptr;
+            }
+        }
+
+        GeneratorObject * self = reinterpret_cast<GeneratorObject *>(type->tp_alloc( type, 0 ));
+
+        if( self == nullptr )
+        {
+            return nullptr;
+        }
+
+        self->sampler = nullptr;
+        self->exports = 0;
+
+        try
+        {
+            self->sampler = new Generator(
+                static_cast<size_t>(stream_count), static_cast<size_t>(thread_count), pin_threads != 0
+            );
+        }
+        catch( const std::bad_alloc & )
+        {
+            Py_DECREF( self );
+            return PyErr_NoMemory();
+        }
+
+        // Without a seed, the first fill seeds from std::random_device.
+        if( !IsNone( seed ) )
+        {
+            self->sampler->Seed( seed_value );
+        }
+
+        return reinterpret_cast<PyObject *>(self);
+    }
+
+    void Generator_Dealloc( PyObject * self_ )
+    {
+        GeneratorObject * self = reinterpret_cast<GeneratorObject *>(self_);
+
+        PyTypeObject * type = Py_TYPE( self_ );
+
+        delete self->sampler;
+
+        type->tp_free( self_ );
+
+        Py_DECREF( type );
+    }
+
+    GeneratorObject * AsGenerator( PyObject * self )
+    {
+        return reinterpret_cast<GeneratorObject *>(self);
+    }
+
+    PyObject * Generator_Seed( PyObject * self, PyObject * args )
+    {
+        PyObject * seed = nullptr;
+
+        if( !PyArg_ParseTuple( args, "|O", &seed ) )
+        {
+            return nullptr;
+        }
+
+        Generator::UInt seed_value;
+
+        if( IsNone( seed ) )
+        {
+            std::random_device r;
+
+            seed_value = (Generator::UInt(r()) << 32) | Generator::UInt(r());
+        }
+        else
+        {
+            seed_value = PyLong_AsUnsignedLongLongMask( seed );
+
+            if( PyErr_Occurred() )
+            {
+                return nullptr;
+            }
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        if( !WithoutGIL( [&](){ gen->Seed( seed_value ); } ) )
+        {
+            return nullptr;
+        }
+
+        Py_RETURN_NONE;
+    }
+
+    PyObject * Generator_Save( PyObject * self, PyObject * args )
+    {
+        const char * path = nullptr;
+
+        if( !PyArg_ParseTuple( args, "s", &path ) )
+        {
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        bool success = false;
+
+        if( !WithoutGIL( [&](){ success = gen->Save( path ); } ) )
+        {
+            return nullptr;
+        }
+
+        if( !success )
+        {
+            PyErr_Format( PyExc_OSError, "Could not write the checkpoint '%s'.", path );
+            return nullptr;
+        }
+
+        Py_RETURN_NONE;
+    }
+
+    PyObject * Generator_Load( PyObject * self, PyObject * args, PyObject * kwargs )
+    {
+        static const char * keywords [] = { "path", "verify", nullptr };
+
+        const char * path   = nullptr;
+        int          verify = 1;
+
+        if( !PyArg_ParseTupleAndKeywords( args, kwargs, "s|p", const_cast<char **>(keywords), &path, &verify ) )
+        {
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        bool success = false;
+
+        if( !WithoutGIL( [&](){ success = gen->Load( path, verify != 0 ); } ) )
+        {
+            return nullptr;
+        }
+
+        if( !success )
+        {
+            PyErr_Format( PyExc_OSError, "Could not load the checkpoint '%s'.", path );
+            return nullptr;
+        }
+
+        Py_RETURN_NONE;
+    }
+
+    PyObject * Generator_FillUniform( PyObject * self, PyObject * args, PyObject * kwargs )
+    {
+        static const char * keywords [] = { "out", "mode", nullptr };
+
+        PyObject   * out       = nullptr;
+        const char * mode_name = "none";
+
+        if( !PyArg_ParseTupleAndKeywords( args, kwargs, "|Os", const_cast<char **>(keywords), &out, &mode_name ) )
+        {
+            return nullptr;
+        }
+
+        VarianceReduction mode;
+
+        if( !ParseVarianceReduction( mode_name, mode ) )
+        {
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        return FillFloats( AsGenerator( self ), out,
+            [gen,mode]( float * a, const size_t n, const bool reservoir )
+            {
+                if( mode == VarianceReduction::None )
+                {
+                    if( reservoir ) { gen->Fill_Uniform(); } else { gen->Fill_Uniform( a, n ); }
+                }
+                else
+                {
+                    if( reservoir ) { gen->Fill_Uniform( mode ); } else { gen->Fill_Uniform( a, n, mode ); }
+                }
+            }
+        );
+    }
+
+    // A parameter of fill_normal: a number, or a float32 array with one entry per sample.
+    class Parameter
+    {
+    public:
+
+        double value;
+
+        std::optional<Buffer> array;
+
+        Parameter( const double default_value )
+        :   value ( default_value )
+        {}
+
+        bool Parse( PyObject * object, const char * name )
+        {
+            if( IsNone( object ) )
+            {
+                return true;
+            }
+
+            if( PyObject_CheckBuffer( object ) )
+            {
+                array.emplace( object, false );
+
+                if( !array->held )
+                {
+                    return false;
+                }
+
+                if( array->view.ndim > 0 )
+                {
+                    return array->Require( "f", sizeof(float), name, "float32" );
+                }
+
+                // A NumPy scalar.
+                array.reset();
+            }
+
+            value = PyFloat_AsDouble( object );
+
+            return !PyErr_Occurred();
+        }
+    };
+
+    PyObject * Generator_FillNormal( PyObject * self, PyObject * args, PyObject * kwargs )
+    {
+        static const char * keywords [] = { "out", "mu", "sigma", "mode", nullptr };
+
+        PyObject   * out       = nullptr;
+        PyObject   * mu_object = nullptr;
+        PyObject   * sigma_object = nullptr;
+        const char * mode_name = "none";
+
+        if( !PyArg_ParseTupleAndKeywords( args, kwargs, "|OOOs", const_cast<char **>(keywords),
+                &out, &mu_object, &sigma_object, &mode_name
+            )
+        )
+        {
+            return nullptr;
+        }
+
+        VarianceReduction mode;
+
+        if( !ParseVarianceReduction( mode_name, mode ) )
+        {
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        if( IsNone( mu_object ) && IsNone( sigma_object ) )
+        {
+            return FillFloats( AsGenerator( self ), out,
+                [gen,mode]( float * a, const size_t n, const bool reservoir )
+                {
+                    if( mode == VarianceReduction::None )
+                    {
+                        if( reservoir ) { gen->Fill_Normal(); } else { gen->Fill_Normal( a, n ); }
+                    }
+                    else
+                    {
+                        if( reservoir ) { gen->Fill_Normal( mode ); } else { gen->Fill_Normal( a, n, mode ); }
+                    }
+                }
+            );
+        }
+
+        if( mode != VarianceReduction::None )
+        {
+            PyErr_SetString( PyExc_ValueError, "mode is only supported for the standard normal distribution." );
+            return nullptr;
+        }
+
+        Parameter mu    ( 0. );
+        Parameter sigma ( 1. );
+
+        if( !mu.Parse( mu_object, "mu" ) || !sigma.Parse( sigma_object, "sigma" ) )
+        {
+            return nullptr;
+        }
+
+        if( mu.array.has_value() != sigma.array.has_value() )
+        {
+            PyErr_SetString( PyExc_TypeError, "mu and sigma must be both numbers or both arrays." );
+            return nullptr;
+        }
+
+        if( !mu.array.has_value() )
+        {
+            const float mu_    = static_cast<float>(mu.value);
+            const float sigma_ = static_cast<float>(sigma.value);
+
+            return FillFloats( AsGenerator( self ), out,
+                [gen,mu_,sigma_]( float * a, const size_t n, const bool )
+                {
+                    gen->Fill_Normal( a, n, mu_, sigma_ );
+                }
+            );
+        }
+
+        const float * mu_    = mu.array->Data<const float>();
+        const float * sigma_ = sigma.array->Data<const float>();
+
+        const size_t mu_size    = mu.array->Size();
+        const size_t sigma_size = sigma.array->Size();
+
+        return FillFloats( AsGenerator( self ), out,
+            [gen,mu_,sigma_]( float * a, const size_t n, const bool )
+            {
+                gen->Fill_Normal( a, n, mu_, sigma_ );
+            },
+            [mu_size,sigma_size]( const size_t n )
+            {
+                if( (mu_size != n) || (sigma_size != n) )
+                {
+                    PyErr_Format( PyExc_ValueError, "mu and sigma must have %zu entries, one per sample.", n );
+                    return false;
+                }
+
+                return true;
+            }
+        );
+    }
+
+    PyObject * Generator_FillTruncatedNormal( PyObject * self, PyObject * args, PyObject * kwargs )
+    {
+        static const char * keywords [] = { "out", "mu", "sigma", "lower", "upper", nullptr };
+
+        PyObject * out   = nullptr;
+        double     mu    = 0.;
+        double     sigma = 1.;
+        double     lower = -std::numeric_limits<double>::infinity();
+        double     upper =  std::numeric_limits<double>::infinity();
+
+        if( !PyArg_ParseTupleAndKeywords( args, kwargs, "|Odddd", const_cast<char **>(keywords),
+                &out, &mu, &sigma, &lower, &upper
+            )
+        )
+        {
+            return nullptr;
+        }
+
+        if( !(sigma > 0) || !(lower < upper) || !std::isfinite( mu ) || !std::isfinite( sigma ) )
+        {
+            PyErr_SetString( PyExc_ValueError, "Invalid parameters: need finite mu, sigma > 0 and lower < upper." );
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        return FillFloats( AsGenerator( self ), out,
+            [=]( float * a, const size_t n, const bool )
+            {
+                gen->Fill_TruncatedNormal( a, n, mu, sigma, lower, upper );
+            }
+        );
+    }
+
+    // The points are the rows: out has shape (point_count, dimension), or it is flat and
+    // dimension is given. For the reservoir, dimension is required.
+    PyObject * Generator_FillLatinHypercube( PyObject * self, PyObject * args, PyObject * kwargs )
+    {
+        static const char * keywords [] = { "out", "dimension", nullptr };
+
+        PyObject * out       = nullptr;
+        Py_ssize_t dimension = 0;
+
+        if( !PyArg_ParseTupleAndKeywords( args, kwargs, "|On", const_cast<char **>(keywords), &out, &dimension ) )
+        {
+            return nullptr;
+        }
+
+        if( dimension < 0 )
+        {
+            PyErr_SetString( PyExc_ValueError, "dimension must not be negative." );
+            return nullptr;
+        }
+
+        size_t d = static_cast<size_t>(dimension);
+
+        if( !IsNone( out ) )
+        {
+            // Only for the shape; FillFloats acquires the buffer again.
+            Buffer buffer ( out, true );
+
+            if( !buffer.Require( "f", sizeof(float), "out", "float32" ) )
+            {
+                return nullptr;
+            }
+
+            if( buffer.view.ndim == 2 )
+            {
+                const size_t columns = static_cast<size_t>(buffer.view.shape[1]);
+
+                if( (d != 0) && (d != columns) )
+                {
+                    PyErr_SetString( PyExc_ValueError, "dimension does not match the number of columns of out." );
+                    return nullptr;
+                }
+
+                d = columns;
+            }
+            else if( buffer.view.ndim != 1 )
+            {
+                PyErr_SetString( PyExc_ValueError, "out must have one or two dimensions." );
+                return nullptr;
+            }
+        }
+
+        if( d == 0 )
+        {
+            PyErr_SetString( PyExc_ValueError, "dimension must be positive." );
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        const bool flat_array = !IsNone( out );
+
+        return FillFloats( AsGenerator( self ), out,
+            [gen,d]( float * a, const size_t n, const bool reservoir )
+            {
+                if( reservoir ) { gen->Fill_LatinHypercube( d ); } else { gen->Fill_LatinHypercube( a, n / d, d ); }
+            },
+            [d,flat_array]( const size_t n )
+            {
+                if( flat_array && (n % d != 0) )
+                {
+                    PyErr_SetString( PyExc_ValueError, "The size of out is not a multiple of dimension." );
+                    return false;
+                }
+
+                if( n / d > size_t(std::numeric_limits<std::uint32_t>::max()) + 1 )
+                {
+                    PyErr_SetString( PyExc_ValueError, "At most 2^32 points are supported." );
+                    return false;
+                }
+
+                return true;
+            }
+        );
+    }
+
+    PyObject * Generator_FillBits( PyObject * self, PyObject * args )
+    {
+        PyObject * out = nullptr;
+
+        if( !PyArg_ParseTuple( args, "O", &out ) )
+        {
+            return nullptr;
+        }
+
+        Buffer buffer ( out, true );
+
+        if( !buffer.Require( "QL", sizeof(std::uint64_t), "out", "uint64" ) )
+        {
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        if( !WithoutGIL( [&](){ gen->Fill_Bits( buffer.Data<std::uint64_t>(), buffer.Size() ); } ) )
+        {
+            return nullptr;
+        }
+
+        return NewReference( out );
+    }
+
+    // uint64 arrays get 64 samples per word, uint8 arrays one sample (0 or 1) per byte.
+    PyObject * Generator_FillBernoulli( PyObject * self, PyObject * args )
+    {
+        PyObject * out = nullptr;
+        double     p   = 0.5;
+
+        if( !PyArg_ParseTuple( args, "Od", &out, &p ) )
+        {
+            return nullptr;
+        }
+
+        if( !((p >= 0.) && (p <= 1.)) )
+        {
+            PyErr_SetString( PyExc_ValueError, "The probability p must be in [0,1]." );
+            return nullptr;
+        }
+
+        Buffer buffer ( out, true );
+
+        if( !buffer.held )
+        {
+            return nullptr;
+        }
+
+        Generator * gen = AsGenerator( self )->sampler;
+
+        bool success;
+
+        if( buffer.Is( "QL", sizeof(std::uint64_t) ) )
+        {
+            success = WithoutGIL( [&](){ gen->Fill_Bernoulli( buffer.Data<std::uint64_t>(), buffer.Size(), p ); } );
+        }
+        else if( buffer.Require( "B?", sizeof(std::uint8_t), "out", "uint64 or uint8" ) )
+        {
+            success = WithoutGIL( [&](){ gen->Fill_Bernoulli( buffer.Data<std::uint8_t>(), buffer.Size(), p ); } );
+        }
+        else
+        {
+            return nullptr;
+        }
+
+        if( !success )
+        {
+            return nullptr;
+        }
+
+        return NewReference( out );
+    }
+
+    PyObject * Generator_StreamCount( PyObject * self, void * )
+    {
+        return PyLong_FromSize_t( AsGenerator( self )->sampler->stream_count );
+    }
+
+    PyObject * Generator_ThreadCount( PyObject * self, void * )
+    {
+        return PyLong_FromSize_t( AsGenerator( self )->sampler->CPU_thread_count );
+    }
+
+    PyMethodDef generator_methods [] = {
+        { "seed", Generator_Seed, METH_VARARGS,
+            "seed(seed=None)\n\nSeeds the streams deterministically from an integer, or from std::random_device if seed is None." },
+        { "save", Generator_Save, METH_VARARGS,
+            "save(path)\n\nWrites the states of all streams to a checkpoint file." },
+        { "load", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Generator_Load)), METH_VARARGS | METH_KEYWORDS,
+            "load(path, verify=True)\n\nRestores the states from a checkpoint written by save." },
+        { "require_reservoir", RequireReservoir<GeneratorObject>, METH_VARARGS,
+            "require_reservoir(n)\n\nMakes room for n float32 samples (rounded up to a multiple of 4) in the reservoir." },
+        { "fill_uniform", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Generator_FillUniform)), METH_VARARGS | METH_KEYWORDS,
+            "fill_uniform(out=None, mode='none')\n\nUniform samples in [0,1); mode is 'none', 'antithetic' or 'stratified'." },
+        { "fill_normal", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Generator_FillNormal)), METH_VARARGS | METH_KEYWORDS,
+            "fill_normal(out=None, mu=None, sigma=None, mode='none')\n\nNormal samples; mu and sigma are numbers or float32 arrays with one entry per sample." },
+        { "fill_truncated_normal", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Generator_FillTruncatedNormal)), METH_VARARGS | METH_KEYWORDS,
+            "fill_truncated_normal(out=None, mu=0, sigma=1, lower=-inf, upper=inf)\n\nSamples of N(mu,sigma^2) truncated to [lower,upper]." },
+        { "fill_latin_hypercube", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Generator_FillLatinHypercube)), METH_VARARGS | METH_KEYWORDS,
+            "fill_latin_hypercube(out=None, dimension=0)\n\nA Latin hypercube design with one point per row of out." },
+        { "fill_bits", Generator_FillBits, METH_VARARGS,
+            "fill_bits(out)\n\nRaw engine output into a uint64 array." },
+        { "fill_bernoulli", Generator_FillBernoulli, METH_VARARGS,
+            "fill_bernoulli(out, p)\n\nBernoulli(p) samples: 64 per word of a uint64 array, or one per byte of a uint8 array." },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyGetSetDef generator_getset [] = {
+        { "reservoir", Reservoir_Get<GeneratorObject>, nullptr,
+            "A writable float32 memoryview of the reservoir, without a copy.", nullptr },
+        { "reservoir_size", ReservoirSize_Get<GeneratorObject>, nullptr, "Number of samples in the reservoir.", nullptr },
+        { "stream_count", Generator_StreamCount, nullptr, "Number of streams.", nullptr },
+        { "thread_count", Generator_ThreadCount, nullptr, "Number of threads.", nullptr },
+        { nullptr, nullptr, nullptr, nullptr, nullptr }
+    };
+
+    PyType_Slot generator_slots [] = {
+        { Py_tp_doc, const_cast<char *>(
+            "Generator(stream_count=1024, thread_count=8, seed=None, pin_threads=False)\n\n"
+            "The multithreaded sampler Randomizor_CPU. The samples depend only on the seed and on stream_count."
+        ) },
+        { Py_tp_new,            reinterpret_cast<void *>(Generator_New) },
+        { Py_tp_dealloc,        reinterpret_cast<void *>(Generator_Dealloc) },
+        { Py_tp_methods,        generator_methods },
+        { Py_tp_getset,         generator_getset },
+        { Py_bf_getbuffer,      reinterpret_cast<void *>(Reservoir_GetBuffer<GeneratorObject>) },
+        { Py_bf_releasebuffer,  reinterpret_cast<void *>(Reservoir_ReleaseBuffer<GeneratorObject>) },
+        { 0, nullptr }
+    };
+
+    PyType_Spec generator_spec = {
+        "randomizor.Generator", sizeof(GeneratorObject), 0, Py_TPFLAGS_DEFAULT, generator_slots
+    };
+
+
+    // Sobol and Halton /////////////////////////////////////////////////////////////////////////
+
+    template<typename Sequence>
+    struct QMC
+    {
+        using Sampler = Randomizor_QMC<Sequence>;
+
+        using Object = SamplerObject<Sampler>;
+
+        static Sampler * AsSampler( PyObject * self )
+        {
+            return reinterpret_cast<Object *>(self)->sampler;
+        }
+
+        static PyObject * New( PyTypeObject * type, PyObject * args, PyObject * kwargs )
+        {
+            static const char * keywords [] = { "dimension", "scrambling", "seed", "thread_count", nullptr };
+
+            Py_ssize_t   dimension       = 0;
+            const char * scrambling_name = "none";
+            PyObject   * seed            = nullptr;
+            Py_ssize_t   thread_count    = 8;
+
+            if( !PyArg_ParseTupleAndKeywords( args, kwargs, "n|sOn", const_cast<char **>(keywords),
+                    &dimension, &scrambling_name, &seed, &thread_count
+                )
+            )
+            {
+                return nullptr;
+            }
+
+            Scrambling scrambling;
+
+            if( !ParseScrambling( scrambling_name, scrambling ) )
+            {
+                return nullptr;
+            }
+
+            // Sobol and Halton both support up to 1024 dimensions.
+            if( (dimension < 1) || (dimension > Py_ssize_t(Halton::max_dimension)) )
+            {
+                PyErr_Format( PyExc_ValueError, "dimension must be in [1,%zu].", Halton::max_dimension );
+                return nullptr;
+            }
+
+            if( thread_count < 1 )
+            {
+                PyErr_SetString( PyExc_ValueError, "thread_count must be positive." );
+                return nullptr;
+            }
+
+            std::uint64_t seed_value = 0;
+
+            if( !IsNone( seed ) )
+            {
+                seed_value = PyLong_AsUnsignedLongLongMask( seed );
+
+                if( PyErr_Occurred() )
+                {
+                    return nullptr;
+                }
+            }
+
+            Object * self = reinterpret_cast<Object *>(type->tp_alloc( type, 0 ));
+
+            if( self == nullptr )
+            {
+                return nullptr;
+            }
+
+            self->sampler = nullptr;
+            self->exports = 0;
+
+            try
+            {
+                self->sampler = new Sampler(
+                    static_cast<size_t>(dimension), scrambling, seed_value, static_cast<size_t>(thread_count)
+                );
+            }
+            catch( const std::bad_alloc & )
+            {
+                Py_DECREF( self );
+                return PyErr_NoMemory();
+            }
+
+            return reinterpret_cast<PyObject *>(self);
+        }
+
+        static void Dealloc( PyObject * self )
+        {
+            PyTypeObject * type = Py_TYPE( self );
+
+            delete AsSampler( self );
+
+            type->tp_free( self );
+
+            Py_DECREF( type );
+        }
+
+        static PyObject * FillUniform( PyObject * self, PyObject * args )
+        {
+            PyObject * out = nullptr;
+
+            if( !PyArg_ParseTuple( args, "|O", &out ) )
+            {
+                return nullptr;
+            }
+
+            Sampler * gen = AsSampler( self );
+
+            return FillFloats( reinterpret_cast<Object *>(self), out,
+                [gen]( float * a, const size_t n, const bool reservoir )
+                {
+                    if( reservoir ) { gen->Fill_Uniform(); } else { gen->Fill_Uniform( a, n ); }
+                }
+            );
+        }
+
+        static PyObject * FillNormal( PyObject * self, PyObject * args )
+        {
+            PyObject * out = nullptr;
+
+            if( !PyArg_ParseTuple( args, "|O", &out ) )
+            {
+                return nullptr;
+            }
+
+            Sampler * gen = AsSampler( self );
+
+            return FillFloats( reinterpret_cast<Object *>(self), out,
+                [gen]( float * a, const size_t n, const bool reservoir )
+                {
+                    if( reservoir ) { gen->Fill_Normal(); } else { gen->Fill_Normal( a, n ); }
+                }
+            );
+        }
+
+        static PyObject * Dimension( PyObject * self, void * )
+        {
+            return PyLong_FromSize_t( AsSampler( self )->Dimension() );
+        }
+
+        static PyObject * GetIndex( PyObject * self, void * )
+        {
+            return PyLong_FromUnsignedLongLong( AsSampler( self )->Index() );
+        }
+
+        static int SetIndex( PyObject * self, PyObject * value, void * )
+        {
+            if( value == nullptr )
+            {
+                PyErr_SetString( PyExc_AttributeError, "Cannot delete index." );
+                return -1;
+            }
+
+            const unsigned long long index = PyLong_AsUnsignedLongLong( value );
+
+            if( PyErr_Occurred() )
+            {
+                return -1;
+            }
+
+            AsSampler( self )->SetIndex( index );
+
+            return 0;
+        }
+
+        static inline PyMethodDef methods [] = {
+            { "require_reservoir", RequireReservoir<Object>, METH_VARARGS,
+                "require_reservoir(n)\n\nMakes room for n float32 samples in the reservoir." },
+            { "fill_uniform", FillUniform, METH_VARARGS,
+                "fill_uniform(out=None)\n\nThe next points, point by point, in [0,1)^dimension." },
+            { "fill_normal", FillNormal, METH_VARARGS,
+                "fill_normal(out=None)\n\nThe next points, mapped to standard normal samples." },
+            { nullptr, nullptr, 0, nullptr }
+        };
+
+        static inline PyGetSetDef getset [] = {
+            { "reservoir", Reservoir_Get<Object>, nullptr,
+                "A writable float32 memoryview of the reservoir, without a copy.", nullptr },
+            { "reservoir_size", ReservoirSize_Get<Object>, nullptr, "Number of samples in the reservoir.", nullptr },
+            { "dimension", Dimension, nullptr, "Dimension of the points.", nullptr },
+            { "index", GetIndex, SetIndex, "Index of the next point.", nullptr },
+            { nullptr, nullptr, nullptr, nullptr, nullptr }
+        };
+
+        static PyType_Spec Spec( const char * name, const char * doc )
+        {
+            static PyType_Slot slots [] = {
+                { Py_tp_doc,            const_cast<char *>(doc) },
+                { Py_tp_new,            reinterpret_cast<void *>(New) },
+                { Py_tp_dealloc,        reinterpret_cast<void *>(Dealloc) },
+                { Py_tp_methods,        methods },
+                { Py_tp_getset,         getset },
+                { Py_bf_getbuffer,      reinterpret_cast<void *>(Reservoir_GetBuffer<Object>) },
+                { Py_bf_releasebuffer,  reinterpret_cast<void *>(Reservoir_ReleaseBuffer<Object>) },
+                { 0, nullptr }
+            };
+
+            return PyType_Spec { name, sizeof(Object), 0, Py_TPFLAGS_DEFAULT, slots };
+        }
+    };
+
+
+    // Module ///////////////////////////////////////////////////////////////////////////////////
+
+    bool AddType( PyObject * module, const char * name, PyType_Spec * spec )
+    {
+        PyObject * type = PyType_FromSpec( spec );
+
+        if( type == nullptr )
+        {
+            return false;
+        }
+
+        if( PyModule_AddObject( module, name, type ) != 0 )
+        {
+            Py_DECREF( type );
+            return false;
+        }
+
+        return true;
+    }
+
+    PyModuleDef module_def = {
+        PyModuleDef_HEAD_INIT,
+        "randomizor",
+        "Multithreaded random and quasi-random samplers that fill NumPy arrays in place.",
+        -1,
+        nullptr, nullptr, nullptr, nullptr, nullptr
+    };
+}
+
+PyMODINIT_FUNC PyInit_randomizor()
+{
+    PyObject * module = PyModule_Create( &module_def );
+
+    if( module == nullptr )
+    {
+        return nullptr;
+    }
+
+    static PyType_Spec sobol_spec = QMC<Sobol>::Spec(
+        "randomizor.Sobol",
+        "Sobol(dimension, scrambling='none', seed=0, thread_count=8)\n\n"
+        "Points of the Sobol sequence; scrambling is 'none', 'digital_shift' or 'owen'."
+    );
+
+    static PyType_Spec halton_spec = QMC<Halton>::Spec(
+        "randomizor.Halton",
+        "Halton(dimension, scrambling='none', seed=0, thread_count=8)\n\n"
+        "Points of the Halton sequence; scrambling is 'none', 'digital_shift' or 'owen'."
+    );
+
+    if(
+        !AddType( module, "Generator", &generator_spec )
+        ||
+        !AddType( module, "Sobol", &sobol_spec )
+        ||
+        !AddType( module, "Halton", &halton_spec )
+    )
+    {
+        Py_DECREF( module );
+        return nullptr;
+    }
+
+    return module;
+}
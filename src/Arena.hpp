@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // A contiguous region of memory that is reserved once and committed on demand.
+    //
+    // The constructor reserves address space only (no memory, no page faults). Require( size )
+    // commits more of it in geometric steps, so that the base address never changes, nothing is
+    // ever copied, and pages that have been faulted in once stay in place when a workload shrinks
+    // and grows again. Size the reservation after the workload: it costs no memory, but it does
+    // cost address space, of which a process has 128 TiB on x86-64 and ARM64 Linux.
+    //
+    // The arena does not sub-allocate. Its user lays the region out at fixed offsets instead:
+    // Randomizor_CPU keeps its states at offset 0 and the reservoir behind them, so resizing the
+    // reservoir hands out a sub-range of the same pages without a new allocation.
+    //
+    // With HugePages::Transparent (the default), the arena asks for transparent huge pages by
+    // madvise on Linux. With HugePages::Explicit, it first tries explicit huge pages (MAP_HUGETLB).
+    // These are committed at once for the whole reservation, so this succeeds only if the system's
+    // huge page pool can hold all of it; otherwise the arena falls back to transparent huge pages.
+    // The base address is aligned to huge_page_size in all cases.
+    class Arena
+    {
+    public:
+
+        static constexpr std::size_t huge_page_size = std::size_t(1) << 21;
+
+        enum class HugePages
+        {
+            None,
+            Transparent,
+            Explicit
+        };
+
+        explicit Arena(
+            const std::size_t reserved_size_,
+            const HugePages   huge_pages     = HugePages::Transparent
+        )
+        {
+            Reserve( RoundUp( reserved_size_, huge_page_size ), huge_pages );
+        }
+
+        Arena( const Arena & ) = delete;
+        Arena & operator=( const Arena & ) = delete;
+
+        ~Arena()
+        {
+            if( mapping != nullptr )
+            {
+                ::munmap( mapping, mapping_size );
+            }
+        }
+
+        unsigned char * Data() const
+        {
+            return base;
+        }
+
+        std::size_t Reserved() const
+        {
+            return reserved_size;
+        }
+
+        std::size_t Committed() const
+        {
+            return committed_size;
+        }
+
+        // True if the arena is backed by explicit huge pages (MAP_HUGETLB).
+        bool ExplicitHugePages() const
+        {
+            return explicit_huge_pages;
+        }
+
+        // Makes sure that the first size bytes are committed. Grows by at least a factor of 1.5.
+        bool Require( const std::size_t size )
+        {
+            if( size <= committed_size )
+            {
+                return true;
+            }
+
+            if( size > reserved_size )
+            {
+                eprint("Arena::Require: Requested "+ToString(size)+" bytes, but only "+ToString(reserved_size)+" bytes are reserved.");
+                return false;
+            }
+
+            std::size_t new_size = std::max( size, committed_size + committed_size / 2 );
+
+            new_size = std::min( RoundUp( new_size, huge_page_size ), reserved_size );
+
+            if( !explicit_huge_pages )
+            {
+                if( ::mprotect( base + committed_size, new_size - committed_size, PROT_READ | PROT_WRITE ) != 0 )
+                {
+                    eprint("Arena::Require: Failed to commit "+ToString(new_size)+" bytes.");
+                    return false;
+                }
+            }
+
+            committed_size = new_size;
+
+            return true;
+        }
+
+        static constexpr std::size_t RoundUp( const std::size_t n, const std::size_t m )
+        {
+            return ((n + m - 1) / m) * m;
+        }
+
+        // Size of the physical memory in bytes, or 64 GiB if the system does not tell.
+        static std::size_t PhysicalMemorySize()
+        {
+            const long page_count = ::sysconf( _SC_PHYS_PAGES );
+            const long page_size  = ::sysconf( _SC_PAGESIZE   );
+
+            if( (page_count <= 0) || (page_size <= 0) )
+            {
+                return std::size_t(1) << 36;
+            }
+
+            return static_cast<std::size_t>(page_count) * static_cast<std::size_t>(page_size);
+        }
+
+    private:
+
+        void Reserve( const std::size_t size, const HugePages huge_pages )
+        {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+            if( huge_pages == HugePages::Explicit )
+            {
+                // Explicit huge pages are committed at mmap time.
+                void * p = ::mmap(
+                    nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0
+                );
+
+                if( p != MAP_FAILED )
+                {
+                    mapping             = p;
+                    mapping_size        = size;
+                    base                = static_cast<unsigned char *>(p);
+                    reserved_size       = size;
+                    committed_size      = size;
+                    explicit_huge_pages = true;
+                    return;
+                }
+            }
+#endif
+            // Reserve address space only; over-allocate to align the base to a huge page.
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_NORESERVE)
+            flags |= MAP_NORESERVE;
+#endif
+            mapping_size = size + huge_page_size;
+
+            void * p = ::mmap( nullptr, mapping_size, PROT_NONE, flags, -1, 0 );
+
+            if( p == MAP_FAILED )
+            {
+                eprint("Arena: Failed to reserve "+ToString(size)+" bytes of address space.");
+                mapping_size = 0;
+                return;
+            }
+
+            mapping = p;
+
+            base = reinterpret_cast<unsigned char *>(
+                RoundUp( reinterpret_cast<std::uintptr_t>(p), huge_page_size )
+            );
+
+            reserved_size = size;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if( huge_pages != HugePages::None )
+            {
+                ::madvise( base, reserved_size, MADV_HUGEPAGE );
+            }
+#else
+            (void)huge_pages;
+#endif
+        }
+
+    private:
+
+        void * mapping = nullptr;
+
+        std::size_t mapping_size = 0;
+
+        unsigned char * base = nullptr;
+
+        std::size_t reserved_size = 0;
+
+        std::size_t committed_size = 0;
+
+        bool explicit_huge_pages = false;
+    };
+}
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace Randomizor
+{
+    using namespace Tools;
+    
+    // Binary checkpoints of generator states.
+    //
+    // A checkpoint file consists of a header of checkpoint_header_size bytes followed by the raw
+    // state array of the generator. The header size is a multiple of the largest page size in
+    // use (16 KiB on Apple Silicon), so the state array in a memory-mapped checkpoint is page-aligned
+    // and can be used in place: by the CPU sampler directly and by Metal as a no-copy buffer.
+    // Both header and states are protected by a checksum. Files are written in native byte order;
+    // the header records it, so a mismatch is detected on load.
+
+    static constexpr std::size_t checkpoint_header_size = 16384;
+
+    static constexpr std::uint32_t checkpoint_version = 1;
+
+    struct CheckpointHeader
+    {
+        char          magic [8]       = { 'R','N','D','M','Z','C','P','T' };
+        std::uint32_t version         = checkpoint_version;
+        std::uint32_t byte_order      = 0x01020304;
+        char          class_name [64] = {};
+        std::uint64_t stream_count    = 0;
+        std::uint64_t state_size      = 0; // bytes per stream
+        std::uint64_t payload_size    = 0; // stream_count * state_size
+        std::uint64_t payload_checksum = 0;
+        std::uint64_t header_checksum  = 0; // checksum of all fields above
+    };
+
+    // 64-bit checksum with four independent lanes, so that it runs at memory speed.
+    inline std::uint64_t Checksum( const void * data, const std::size_t size )
+    {
+        const unsigned char * p = static_cast<const unsigned char *>(data);
+
+        std::uint64_t lane [4] = {
+            0x9e3779b97f4a7c15ull, 0xbf58476d1ce4e5b9ull, 0x94d049bb133111ebull, 0x2545f4914f6cdd1dull
+        };
+
+        const std::size_t block_count = size / 32;
+
+        for( std::size_t i = 0; i < block_count; ++i )
+        {
+            for( int l = 0; l < 4; ++l )
+            {
+                std::uint64_t w;
+                std::memcpy( &w, p + 32 * i + 8 * l, 8 );
+
+                lane[l] = (lane[l] ^ w) * 0xff51afd7ed558ccdull;
+                lane[l] ^= lane[l] >> 32;
+            }
+        }
+
+        std::uint64_t h = static_cast<std::uint64_t>(size);
+
+        for( std::size_t i = 32 * block_count; i < size; ++i )
+        {
+            h = (h ^ p[i]) * 0x100000001b3ull;
+        }
+
+        for( int l = 0; l < 4; ++l )
+        {
+            h = SplitMix64{ h ^ lane[l] }();
+        }
+
+        return h;
+    }
+
+    // A read-only file mapped into memory with copy-on-write semantics: modifications of the
+    // mapped pages stay private to the process and never reach the file.
+    class MappedFile
+    {
+    public:
+
+        MappedFile() = default;
+
+        MappedFile( const MappedFile & ) = delete;
+        MappedFile & operator=( const MappedFile & ) = delete;
+
+        MappedFile( MappedFile && other ) noexcept
+        :   ptr  ( other.ptr  )
+        ,   size ( other.size )
+        {
+            other.ptr  = nullptr;
+            other.size = 0;
+        }
+
+        MappedFile & operator=( MappedFile && other ) noexcept
+        {
+            if( this != &other )
+            {
+                Close();
+                ptr  = other.ptr;
+                size = other.size;
+                other.ptr  = nullptr;
+                other.size = 0;
+            }
+            return *this;
+        }
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        bool Open( const std::string & path )
+        {
+            Close();
+
+            const int fd = ::open( path.c_str(), O_RDONLY );
+
+            if( fd < 0 )
+            {
+                eprint("MappedFile::Open: Could not open file "+path+".");
+                return false;
+            }
+
+            struct stat st;
+
+            if( ::fstat( fd, &st ) != 0 )
+            {
+                ::close( fd );
+                eprint("MappedFile::Open: Could not stat file "+path+".");
+                return false;
+            }
+
+            size = static_cast<std::size_t>(st.st_size);
+
+            void * p = (size > 0)
+                     ? ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 )
+                     : MAP_FAILED;
+
+            ::close( fd );
+
+            if( p == MAP_FAILED )
+            {
+                size = 0;
+                eprint("MappedFile::Open: Could not map file "+path+".");
+                return false;
+            }
+
+            ptr = static_cast<unsigned char *>(p);
+
+            return true;
+        }
+
+        void Close()
+        {
+            if( ptr != nullptr )
+            {
+                ::munmap( ptr, size );
+                ptr  = nullptr;
+                size = 0;
+            }
+        }
+
+        unsigned char * Data() const
+        {
+            return ptr;
+        }
+
+        std::size_t Size() const
+        {
+            return size;
+        }
+
+    private:
+
+        unsigned char * ptr = nullptr;
+
+        std::size_t size = 0;
+    };
+
+    // Writes header and states with a single writev call (repeated only if the kernel writes less
+    // or a signal interrupts it) to path + ".tmp", flushes it to disk and renames it to path. So a
+    // crash or a full disk during the save leaves the previous checkpoint at path intact, and
+    // samplers that work on a mapping of it keep their states.
+    inline bool SaveCheckpoint(
+        const std::string & path,
+        const std::string & class_name,
+        const std::size_t   stream_count,
+        const std::size_t   state_size,
+        const void *        states
+    )
+    {
+        const std::string tag = "SaveCheckpoint(" + path + ")";
+
+        const std::string tmp_path = path + ".tmp";
+
+        std::vector<unsigned char> header_page ( checkpoint_header_size, 0 );
+
+        CheckpointHeader header;
+
+        std::strncpy( header.class_name, class_name.c_str(), sizeof(header.class_name) - 1 );
+
+        header.stream_count     = stream_count;
+        header.state_size       = state_size;
+        header.payload_size     = stream_count * state_size;
+        header.payload_checksum = Checksum( states, header.payload_size );
+        header.header_checksum  = Checksum( &header, offsetof(CheckpointHeader,header_checksum) );
+
+        std::memcpy( header_page.data(), &header, sizeof(CheckpointHeader) );
+
+        const int fd = ::open( tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+        if( fd < 0 )
+        {
+            eprint(tag+": Could not open "+tmp_path+" for writing.");
+            return false;
+        }
+
+        auto fail = [&]( const std::string & message )
+        {
+            ::close( fd );
+            ::unlink( tmp_path.c_str() );
+            eprint(tag+": "+message);
+            return false;
+        };
+
+        struct iovec iov [2];
+
+        iov[0].iov_base = header_page.data();
+        iov[0].iov_len  = header_page.size();
+        iov[1].iov_base = const_cast<void *>(states);
+        iov[1].iov_len  = header.payload_size;
+
+        std::size_t remaining = iov[0].iov_len + iov[1].iov_len;
+
+        int iov_begin = 0;
+
+        while( remaining > 0 )
+        {
+            const ssize_t written = ::writev( fd, &iov[iov_begin], 2 - iov_begin );
+
+            if( written < 0 )
+            {
+                if( errno == EINTR )
+                {
+                    continue;
+                }
+
+                return fail( "Write failed: " + std::string(std::strerror(errno)) + "." );
+            }
+
+            remaining -= static_cast<std::size_t>(written);
+
+            std::size_t w = static_cast<std::size_t>(written);
+
+            while( (iov_begin < 2) && (w >= iov[iov_begin].iov_len) )
+            {
+                w -= iov[iov_begin].iov_len;
+                ++iov_begin;
+            }
+
+            if( iov_begin < 2 )
+            {
+                iov[iov_begin].iov_base = static_cast<unsigned char *>(iov[iov_begin].iov_base) + w;
+                iov[iov_begin].iov_len -= w;
+            }
+        }
+
+        if( ::fsync( fd ) != 0 )
+        {
+            return fail( "fsync failed: " + std::string(std::strerror(errno)) + "." );
+        }
+
+        if( ::close( fd ) != 0 )
+        {
+            ::unlink( tmp_path.c_str() );
+            eprint(tag+": close failed: "+std::string(std::strerror(errno))+".");
+            return false;
+        }
+
+        if( std::rename( tmp_path.c_str(), path.c_str() ) != 0 )
+        {
+            ::unlink( tmp_path.c_str() );
+            eprint(tag+": Could not rename "+tmp_path+" to "+path+": "+std::string(std::strerror(errno))+".");
+            return false;
+        }
+
+        // Make the rename itself durable.
+        const std::size_t slash = path.find_last_of( '/' );
+
+        const std::string directory = (slash == std::string::npos) ? std::string(".") : path.substr( 0, slash + 1 );
+
+        const int dir_fd = ::open( directory.c_str(), O_RDONLY | O_DIRECTORY );
+
+        if( dir_fd >= 0 )
+        {
+            ::fsync( dir_fd );
+            ::close( dir_fd );
+        }
+
+        return true;
+    }
+
+    // Maps the checkpoint at path into file, validates it, and returns a pointer to the states
+    // inside the mapping (or nullptr on failure). The pointer is page-aligned and stays valid as
+    // long as file stays open. Pass verify = false to skip the payload checksum.
+    inline unsigned char * LoadCheckpoint(
+        MappedFile &        file,
+        const std::string & path,
+        const std::string & class_name,
+        const std::size_t   stream_count,
+        const std::size_t   state_size,
+        const bool          verify = true
+    )
+    {
+        const std::string tag = "LoadCheckpoint(" + path + ")";
+
+        if( !file.Open( path ) )
+        {
+            return nullptr;
+        }
+
+        if( file.Size() < checkpoint_header_size )
+        {
+            eprint(tag+": File is too small to be a checkpoint.");
+            file.Close();
+            return nullptr;
+        }
+
+        CheckpointHeader header;
+
+        std::memcpy( &header, file.Data(), sizeof(CheckpointHeader) );
+
+        const CheckpointHeader expected;
+
+        if( std::memcmp( header.magic, expected.magic, sizeof(header.magic) ) != 0 )
+        {
+            eprint(tag+": Not a Randomizor checkpoint.");
+        }
+        else if( header.version != checkpoint_version )
+        {
+            eprint(tag+": Unsupported checkpoint version "+ToString(header.version)+".");
+        }
+        else if( header.byte_order != expected.byte_order )
+        {
+            eprint(tag+": Checkpoint was written with a different byte order.");
+        }
+        else if( header.header_checksum != Checksum( &header, offsetof(CheckpointHeader,header_checksum) ) )
+        {
+            eprint(tag+": Header checksum mismatch.");
+        }
+        else if( class_name != std::string( header.class_name, strnlen( header.class_name, sizeof(header.class_name) ) ) )
+        {
+            eprint(tag+": Checkpoint belongs to "+std::string(header.class_name)+", not to "+class_name+".");
+        }
+        else if(
+            (header.stream_count != stream_count) || (header.state_size != state_size)
+            ||
+            (header.payload_size != stream_count * state_size)
+        )
+        {
+            eprint(tag+": Checkpoint holds "+ToString(header.stream_count)+" streams of "+ToString(header.state_size)+" bytes in a payload of "+ToString(header.payload_size)+" bytes; expected "+ToString(stream_count)+" streams of "+ToString(state_size)+" bytes.");
+        }
+        else if( file.Size() < checkpoint_header_size + header.payload_size )
+        {
+            eprint(tag+": File is truncated.");
+        }
+        else if( verify && (header.payload_checksum != Checksum( file.Data() + checkpoint_header_size, header.payload_size )) )
+        {
+            eprint(tag+": Payload checksum mismatch.");
+        }
+        else
+        {
+            return file.Data() + checkpoint_header_size;
+        }
+
+        file.Close();
+
+        return nullptr;
+    }
+}
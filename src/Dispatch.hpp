@@ -0,0 +1,359 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#if defined(__linux__) && defined(__aarch64__)
+    #include <sys/auxv.h>
+#endif
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // Runtime selection of the bulk kernels for the instruction set of the machine.
+    //
+    // The kernels of Kernels_CPU.hpp are force_inline templates. Each variant below instantiates
+    // them inside a function that carries a target attribute, so the same source is compiled once
+    // per ISA level, and one binary runs at full vector width on every machine. Kernels() picks
+    // the best variant on first use (CPUID via __builtin_cpu_supports on x86, getauxval on ARM).
+    // Setting the environment variable RANDOMIZOR_ISA to generic, avx2, avx512 or neon forces a
+    // level, e.g., for testing; levels that the machine does not support are refused.
+    //
+    // The variants are templates in the engine, and Kernels<Engine>() holds one table per engine.
+    //
+    // All variants produce bit-identical output: the conversions are exact, and the variants
+    // differ only in vector width, not in the order or kind of floating-point operations
+    // (the normal kernel has no multiply-add that could be contracted to an FMA, and the affine
+    // normal and tabulated kernels call std::fma explicitly).
+
+    enum class ISA
+    {
+        Generic,
+        AVX2,
+        AVX512,
+        NEON
+    };
+
+    inline std::string ISAName( const ISA isa )
+    {
+        switch( isa )
+        {
+            case ISA::AVX2:   return "avx2";
+            case ISA::AVX512: return "avx512";
+            case ISA::NEON:   return "neon";
+            default:          return "generic";
+        }
+    }
+
+    inline bool Supports( const ISA isa )
+    {
+        switch( isa )
+        {
+            case ISA::Generic:
+            {
+                return true;
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            case ISA::AVX2:
+            {
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            }
+            case ISA::AVX512:
+            {
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+                    && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+            }
+#endif
+#if defined(__aarch64__)
+            case ISA::NEON:
+            {
+    #if defined(__linux__) && defined(HWCAP_ASIMD)
+                return (::getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+    #else
+                // Advanced SIMD is mandatory on AArch64.
+                return true;
+    #endif
+            }
+#endif
+            default:
+            {
+                return false;
+            }
+        }
+    }
+
+    // The best level that the machine supports.
+    inline ISA DetectISA()
+    {
+        for( ISA isa : { ISA::AVX512, ISA::AVX2, ISA::NEON } )
+        {
+            if( Supports( isa ) )
+            {
+                return isa;
+            }
+        }
+
+        return ISA::Generic;
+    }
+
+    template<typename Engine = Xoshiro256Plus>
+    using Uniform_Kernel_T         = void (*)( Engine &, float *,         std::size_t );
+    template<typename Engine = Xoshiro256Plus>
+    using Normal_Kernel_T          = void (*)( Engine &, float *,         std::size_t );
+    template<typename Engine = Xoshiro256Plus>
+    using Bits_Kernel_T            = void (*)( Engine &, std::uint64_t *, std::size_t );
+    using UniformFromBits_Kernel_T = void (*)( const std::uint64_t *, float *,    std::size_t );
+    template<typename Engine = Xoshiro256Plus>
+    using AffineNormal_Kernel_T      = void (*)( Engine &, float *, std::size_t, float, float );
+    template<typename Engine = Xoshiro256Plus>
+    using AffineNormalArray_Kernel_T = void (*)( Engine &, float *, std::size_t, const float *, const float * );
+    template<typename Engine = Xoshiro256Plus>
+    using Tabulated_Kernel_T         = void (*)( Engine &, float *, std::size_t, const TabulatedDistribution & );
+    template<typename Engine = Xoshiro256Plus>
+    using Bernoulli_Kernel_T       = void (*)( Engine &, std::uint64_t *, std::size_t, std::uint64_t, std::size_t );
+    template<typename Engine = Xoshiro256Plus>
+    using BernoulliBytes_Kernel_T  = void (*)( Engine &, std::uint8_t *,  std::size_t, std::uint64_t, std::size_t );
+
+    // The loop variants of the uniform and bits kernels (see Kernels_CPU.hpp). All of them produce
+    // the same output; which one is fastest depends on the machine (see Tuning.hpp).
+    struct KernelVariant
+    {
+        std::size_t buffer_size; // words of the bits buffer of Uniform_Kernel; 0 = no buffer
+        std::size_t unroll;      // unroll factor of Bits_Kernel
+    };
+
+    inline constexpr KernelVariant kernel_variants [] = {
+        {    0, 1 },
+        {   64, 1 },
+        {   64, 4 },
+        {  256, 1 },
+        {  256, 4 },
+        { 1024, 1 },
+        { 1024, 4 }
+    };
+
+    inline constexpr std::size_t kernel_variant_count = std::size( kernel_variants );
+
+    // The variant that Kernels() uses.
+    inline constexpr std::size_t default_kernel_variant = 3;
+
+    inline std::string KernelVariantName( const std::size_t variant )
+    {
+        const KernelVariant & v = kernel_variants[variant];
+
+        return (v.buffer_size == 0)
+             ? std::string("fused")
+             : "buffered_"+std::to_string(v.buffer_size)+"_unroll_"+std::to_string(v.unroll);
+    }
+
+    template<typename Engine = Xoshiro256Plus>
+    struct KernelTable
+    {
+        ISA                                isa;
+        std::size_t                        variant;
+        Uniform_Kernel_T<Engine>           uniform;
+        Normal_Kernel_T<Engine>            normal;
+        Bits_Kernel_T<Engine>              bits;
+        UniformFromBits_Kernel_T           uniform_from_bits;
+        AffineNormal_Kernel_T<Engine>      affine_normal;
+        AffineNormalArray_Kernel_T<Engine> affine_normal_array;
+        Tabulated_Kernel_T<Engine>         tabulated;
+        Bernoulli_Kernel_T<Engine>         bernoulli;
+        BernoulliBytes_Kernel_T<Engine>    bernoulli_bytes;
+    };
+
+#define RANDOMIZOR_KERNEL_VARIANT( name, attribute )                                                \
+    namespace name                                                                                  \
+    {                                                                                               \
+        template<                                                                                   \
+            typename Conversion = Conversion_Standard, typename Engine = Xoshiro256Plus,            \
+            std::size_t buffer_size = 256, std::size_t unroll = 1                                   \
+        >                                                                                           \
+        attribute inline void Uniform( Engine & e, float * restrict a, const std::size_t n )        \
+        {                                                                                           \
+            Uniform_Kernel<Conversion,buffer_size,unroll>( e, a, n );                               \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus>                                                  \
+        attribute inline void Normal( Engine & e, float * restrict a, const std::size_t n )         \
+        {                                                                                           \
+            Normal_Kernel( e, a, n );                                                               \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus, std::size_t unroll = 1>                          \
+        attribute inline void Bits( Engine & e, std::uint64_t * restrict a, const std::size_t n )   \
+        {                                                                                           \
+            Bits_Kernel<unroll>( e, a, n );                                                         \
+        }                                                                                           \
+        template<typename Conversion = Conversion_Standard>                                         \
+        attribute inline void UniformFromBits( const std::uint64_t * restrict b, float * restrict a, const std::size_t n ) \
+        {                                                                                           \
+            UniformFromBits_Kernel<Conversion>( b, a, n );                                          \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus>                                                  \
+        attribute inline void AffineNormal( Engine & e, float * restrict a, const std::size_t n, const float mu, const float sigma ) \
+        {                                                                                           \
+            AffineNormal_Kernel( e, a, n, mu, sigma );                                              \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus>                                                  \
+        attribute inline void AffineNormalArray( Engine & e, float * restrict a, const std::size_t n, const float * restrict mu, const float * restrict sigma ) \
+        {                                                                                           \
+            AffineNormalArray_Kernel( e, a, n, mu, sigma );                                         \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus>                                                  \
+        attribute inline void Tabulated( Engine & e, float * restrict a, const std::size_t n, const TabulatedDistribution & D ) \
+        {                                                                                           \
+            Tabulated_Kernel( e, a, n, D );                                                         \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus>                                                  \
+        attribute inline void Bernoulli( Engine & e, std::uint64_t * restrict a, const std::size_t n, const std::uint64_t p, const std::size_t p_zeros ) \
+        {                                                                                           \
+            Bernoulli_Kernel( e, a, n, p, p_zeros );                                                \
+        }                                                                                           \
+        template<typename Engine = Xoshiro256Plus>                                                  \
+        attribute inline void BernoulliBytes( Engine & e, std::uint8_t * restrict a, const std::size_t n, const std::uint64_t p, const std::size_t p_zeros ) \
+        {                                                                                           \
+            BernoulliBytes_Kernel( e, a, n, p, p_zeros );                                           \
+        }                                                                                           \
+    }
+
+    RANDOMIZOR_KERNEL_VARIANT( Kernels_Generic, )
+
+#if defined(__x86_64__) || defined(__i386__)
+    RANDOMIZOR_KERNEL_VARIANT( Kernels_AVX2,   __attribute__((target("avx2,fma"))) )
+    RANDOMIZOR_KERNEL_VARIANT( Kernels_AVX512, __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"))) )
+#endif
+
+#undef RANDOMIZOR_KERNEL_VARIANT
+
+    template<typename Engine, std::size_t variant>
+    inline KernelTable<Engine> KernelTableForVariant( const ISA isa )
+    {
+        using C = Conversion_Standard;
+
+        constexpr std::size_t b = kernel_variants[variant].buffer_size;
+        constexpr std::size_t u = kernel_variants[variant].unroll;
+
+        switch( isa )
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            case ISA::AVX2:
+            {
+                return {
+                    isa, variant,
+                    Kernels_AVX2::Uniform<C,Engine,b,u>, Kernels_AVX2::Normal<Engine>, Kernels_AVX2::Bits<Engine,u>, Kernels_AVX2::UniformFromBits<C>,
+                    Kernels_AVX2::AffineNormal<Engine>, Kernels_AVX2::AffineNormalArray<Engine>, Kernels_AVX2::Tabulated<Engine>,
+                    Kernels_AVX2::Bernoulli<Engine>, Kernels_AVX2::BernoulliBytes<Engine>
+                };
+            }
+            case ISA::AVX512:
+            {
+                return {
+                    isa, variant,
+                    Kernels_AVX512::Uniform<C,Engine,b,u>, Kernels_AVX512::Normal<Engine>, Kernels_AVX512::Bits<Engine,u>, Kernels_AVX512::UniformFromBits<C>,
+                    Kernels_AVX512::AffineNormal<Engine>, Kernels_AVX512::AffineNormalArray<Engine>, Kernels_AVX512::Tabulated<Engine>,
+                    Kernels_AVX512::Bernoulli<Engine>, Kernels_AVX512::BernoulliBytes<Engine>
+                };
+            }
+#endif
+            default:
+            {
+                // On AArch64, the baseline already is NEON.
+                return {
+                    isa, variant,
+                    Kernels_Generic::Uniform<C,Engine,b,u>, Kernels_Generic::Normal<Engine>, Kernels_Generic::Bits<Engine,u>, Kernels_Generic::UniformFromBits<C>,
+                    Kernels_Generic::AffineNormal<Engine>, Kernels_Generic::AffineNormalArray<Engine>, Kernels_Generic::Tabulated<Engine>,
+                    Kernels_Generic::Bernoulli<Engine>, Kernels_Generic::BernoulliBytes<Engine>
+                };
+            }
+        }
+    }
+
+    template<typename Engine, std::size_t... variant>
+    inline KernelTable<Engine> KernelTableFor( const ISA isa, const std::size_t v, std::index_sequence<variant...> )
+    {
+        using Factory_T = KernelTable<Engine> (*)( ISA );
+
+        static constexpr Factory_T factories [] = { KernelTableForVariant<Engine,variant>... };
+
+        return factories[v]( isa );
+    }
+
+    // The kernels of the given ISA and loop variant (an index into kernel_variants).
+    template<typename Engine = Xoshiro256Plus>
+    inline KernelTable<Engine> KernelTableFor( const ISA isa, const std::size_t variant = default_kernel_variant )
+    {
+        if( variant >= kernel_variant_count )
+        {
+            wprint("KernelTableFor: Unknown kernel variant "+ToString(variant)+". Using the default one.");
+
+            return KernelTableFor<Engine>( isa, default_kernel_variant, std::make_index_sequence<kernel_variant_count>() );
+        }
+
+        return KernelTableFor<Engine>( isa, variant, std::make_index_sequence<kernel_variant_count>() );
+    }
+
+    // Returns DetectISA(), unless RANDOMIZOR_ISA names a supported level.
+    inline ISA SelectISA()
+    {
+        const ISA detected = DetectISA();
+
+        const char * env = std::getenv( "RANDOMIZOR_ISA" );
+
+        if( env == nullptr )
+        {
+            return detected;
+        }
+
+        const std::string name ( env );
+
+        for( ISA isa : { ISA::Generic, ISA::AVX2, ISA::AVX512, ISA::NEON } )
+        {
+            if( name == ISAName( isa ) )
+            {
+                if( Supports( isa ) )
+                {
+                    return isa;
+                }
+
+                wprint("SelectISA: RANDOMIZOR_ISA = "+name+" is not supported by this machine. Using "+ISAName(detected)+" instead.");
+
+                return detected;
+            }
+        }
+
+        wprint("SelectISA: Unknown RANDOMIZOR_ISA = "+name+". Using "+ISAName(detected)+" instead.");
+
+        return detected;
+    }
+
+    // The kernel table of the engine for this process, resolved once per engine.
+    template<typename Engine = Xoshiro256Plus>
+    inline const KernelTable<Engine> & Kernels()
+    {
+        static const KernelTable<Engine> table = KernelTableFor<Engine>( SelectISA() );
+
+        return table;
+    }
+
+    // The uniform kernel with another conversion policy (see Helpers.hpp), for the ISA of Kernels().
+    template<typename Conversion, typename Engine = Xoshiro256Plus>
+    inline Uniform_Kernel_T<Engine> UniformKernel()
+    {
+        static const Uniform_Kernel_T<Engine> kernel = []() -> Uniform_Kernel_T<Engine>
+        {
+            switch( Kernels<Engine>().isa )
+            {
+#if defined(__x86_64__) || defined(__i386__)
+                case ISA::AVX2:   return Kernels_AVX2::Uniform<Conversion,Engine>;
+                case ISA::AVX512: return Kernels_AVX512::Uniform<Conversion,Engine>;
+#endif
+                default:          return Kernels_Generic::Uniform<Conversion,Engine>;
+            }
+        }();
+
+        return kernel;
+    }
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Scrambling.hpp"
+#include "InverseNormalCDF.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // The Halton sequence: coordinate j of point i is the radical inverse of i in the j-th prime
+    // base b, i.e., the base-b digits of i mirrored at the radix point. Each point is computed
+    // directly from its index (O(log i) per coordinate), so ranges of points can be filled in
+    // parallel, in blocks, with results that do not depend on the split. Indices go up to 2^32.
+    //
+    // Every coordinate uses the K digits that indices below 2^32 can have in base b, also the
+    // leading zeros of i. With scrambling, digit position k of dimension j is sent through a
+    // random permutation pi_jk (a random shift d -> d + s_jk mod b for Scrambling::DigitalShift),
+    // which breaks up the strong correlations between the higher dimensions of the plain sequence.
+    //
+    // Point i is written to a[dimension * i + j], j = 0,...,dimension-1.
+    class Halton
+    {
+    public:
+
+        using UInt = std::uint64_t;
+
+        static constexpr std::size_t max_dimension = 1024;
+
+        static constexpr std::uint64_t max_point_count = std::uint64_t(1) << 32;
+
+        explicit Halton(
+            const std::size_t   dimension_,
+            const Scrambling    scrambling_ = Scrambling::None,
+            const std::uint64_t seed        = 0
+        )
+        :   dimension  ( std::min( std::max( dimension_, std::size_t(1) ), max_dimension ) )
+        ,   scrambling ( scrambling_ )
+        ,   bases      ( dimension )
+        ,   digits     ( dimension )
+        ,   scales     ( dimension )
+        ,   offsets    ( dimension + 1, 0 )
+        {
+            if( dimension_ > max_dimension )
+            {
+                eprint(ClassName()+": Requested dimension "+ToString(dimension_)+" exceeds the maximum "+ToString(max_dimension)+".");
+            }
+
+            ComputeBases();
+
+            if( scrambling != Scrambling::None )
+            {
+                ComputePermutations( seed );
+            }
+        }
+
+        std::size_t Dimension() const
+        {
+            return dimension;
+        }
+
+        // Writes the point_count points with indices begin, begin + 1, ... to a, as floats in [0,1).
+        void Fill_Uniform( const std::uint64_t begin, const std::size_t point_count, float * restrict a ) const
+        {
+            Fill( begin, point_count, a,
+                []( const UInt x, const double scale )
+                {
+                    // Rounding to float must not produce 1.
+                    return std::min( static_cast<float>( static_cast<double>(x) * scale ), 0x1.fffffep-1f );
+                }
+            );
+        }
+
+        // Same as Fill_Uniform, but mapped to standard normal floats by the inverse CDF. The
+        // coordinate is shifted to the midpoint of its cell first, so it never is 0.
+        void Fill_Normal( const std::uint64_t begin, const std::size_t point_count, float * restrict a ) const
+        {
+            Fill( begin, point_count, a,
+                []( const UInt x, const double scale )
+                {
+                    return static_cast<float>( InverseNormalCDF( (static_cast<double>(x) + 0.5) * scale ) );
+                }
+            );
+        }
+
+        static std::string ClassName()
+        {
+            return "Halton";
+        }
+
+    private:
+
+        void ComputeBases()
+        {
+            std::size_t j = 0;
+
+            for( UInt b = 2; j < dimension; ++b )
+            {
+                bool is_prime = true;
+
+                for( std::size_t i = 0; (i < j) && (bases[i] * bases[i] <= b); ++i )
+                {
+                    if( b % bases[i] == 0 )
+                    {
+                        is_prime = false;
+                        break;
+                    }
+                }
+
+                if( is_prime )
+                {
+                    bases[j] = b;
+
+                    // Smallest K with b^K >= 2^32.
+                    UInt power = 1;
+                    std::size_t K = 0;
+
+                    while( power < max_point_count )
+                    {
+                        power *= b;
+                        ++K;
+                    }
+
+                    digits[j]    = K;
+                    scales[j]    = 1. / static_cast<double>(power);
+                    offsets[j+1] = offsets[j] + K * b;
+
+                    ++j;
+                }
+            }
+        }
+
+        // permutations[offsets[j] + k * b + d] = pi_jk(d).
+        void ComputePermutations( const std::uint64_t seed )
+        {
+            permutations.resize( offsets[dimension] );
+
+            SplitMix64 engine ( seed );
+
+            for( std::size_t j = 0; j < dimension; ++j )
+            {
+                const UInt b = bases[j];
+
+                for( std::size_t k = 0; k < digits[j]; ++k )
+                {
+                    std::uint16_t * pi = &permutations[offsets[j] + k * b];
+
+                    if( scrambling == Scrambling::DigitalShift )
+                    {
+                        const UInt s = engine() % b;
+
+                        for( UInt d = 0; d < b; ++d )
+                        {
+                            pi[d] = static_cast<std::uint16_t>( (d + s) % b );
+                        }
+                    }
+                    else
+                    {
+                        // Fisher-Yates shuffle
+                        for( UInt d = 0; d < b; ++d )
+                        {
+                            pi[d] = static_cast<std::uint16_t>( d );
+                        }
+
+                        for( UInt d = b - 1; d > 0; --d )
+                        {
+                            std::swap( pi[d], pi[engine() % (d + 1)] );
+                        }
+                    }
+                }
+            }
+        }
+
+        // Returns the digits of i in base bases[j], permuted and mirrored, as an integer
+        // below bases[j]^digits[j].
+        UInt RadicalInverse( UInt i, const std::size_t j ) const
+        {
+            const UInt        b = bases[j];
+            const std::size_t K = digits[j];
+
+            UInt x = 0;
+
+            if( scrambling == Scrambling::None )
+            {
+                for( std::size_t k = 0; k < K; ++k )
+                {
+                    x = x * b + i % b;
+                    i /= b;
+                }
+            }
+            else
+            {
+                const std::uint16_t * pi = &permutations[offsets[j]];
+
+                for( std::size_t k = 0; k < K; ++k )
+                {
+                    x = x * b + pi[k * b + i % b];
+                    i /= b;
+                }
+            }
+
+            return x;
+        }
+
+        template<typename F>
+        void Fill( const std::uint64_t begin, const std::size_t point_count, float * restrict a, F && f ) const
+        {
+            if( begin + point_count > max_point_count )
+            {
+                eprint(ClassName()+"::Fill: Points beyond index 2^32 are not available.");
+                return;
+            }
+
+            const std::size_t d = dimension;
+
+            for( std::size_t p = 0; p < point_count; ++p )
+            {
+                for( std::size_t j = 0; j < d; ++j )
+                {
+                    a[d * p + j] = f( RadicalInverse( begin + p, j ), scales[j] );
+                }
+            }
+        }
+
+    private:
+
+        const std::size_t dimension;
+
+        const Scrambling scrambling;
+
+        std::vector<UInt> bases;
+
+        std::vector<std::size_t> digits;
+
+        std::vector<double> scales;
+
+        std::vector<std::size_t> offsets;
+
+        std::vector<std::uint16_t> permutations;
+    };
+}
@@ -1,15 +1,37 @@
 #pragma once
 
+#include <bit>
+#include <cstdint>
+
 namespace Randomizor
 {
+    // 64 random bits from random_engine: one output of a 64-bit engine, or two outputs of a
+    // 32-bit engine (the first one in the lower half).
+    template<typename Engine>
+    force_inline std::uint64_t Bits64( Engine & random_engine )
+    {
+        if constexpr ( sizeof(typename Engine::result_type) >= sizeof(std::uint64_t) )
+        {
+            return static_cast<std::uint64_t>( random_engine() );
+        }
+        else
+        {
+            const std::uint64_t lo = random_engine();
+            const std::uint64_t hi = random_engine();
+            
+            return lo | (hi << 32);
+        }
+    }
+    
     force_inline constexpr float FloatFrom32Bits( const std::uint32_t i ) noexcept
     {
         return (i >> 8) * 0x1.0p-24f;
     }
     
+    // Uses the upper 24 bits, which are the strongest ones of xoshiro256+.
     force_inline constexpr float FloatFromBits( const std::uint64_t i ) noexcept
     {
-        return (i >> 8) * 0x1.0p-24f;
+        return (i >> 40) * 0x1.0p-24f;
     }
     
     force_inline void FloatPairFromBits( const std::uint64_t i, float & a, float & b ) noexcept
@@ -22,4 +44,72 @@ namespace Randomizor
     {
         return (i >> 11) * 0x1.0p-53;
     }
+    
+    // Conversion policies from random bits to floats in the unit interval, for use as template
+    // parameter of Uniform_Kernel and UniformFromBits_Kernel. A policy either makes two floats from
+    // the two 32-bit halves of a 64-bit word (floats_per_word == 2, FromBits32) or one float from
+    // a whole word (floats_per_word == 1, FromBits64). All of them are branch-free, so that the
+    // conversion loops vectorize.
+    
+    // [0,1) with spacing 2^-24; the conversion of the Metal kernels.
+    struct Conversion_Standard
+    {
+        static constexpr std::size_t floats_per_word = 2;
+        
+        force_inline static constexpr float FromBits32( const std::uint32_t i ) noexcept
+        {
+            return (i >> 8) * 0x1.0p-24f;
+        }
+    };
+    
+    // [0,1) with spacing 2^-23, without integer-to-float conversion: the 23 bits become the
+    // mantissa of a float in [1,2), from which 1 is subtracted (exactly).
+    struct Conversion_ExponentOR
+    {
+        static constexpr std::size_t floats_per_word = 2;
+        
+        force_inline static constexpr float FromBits32( const std::uint32_t i ) noexcept
+        {
+            return std::bit_cast<float>( (i >> 9) | 0x3f800000u ) - 1.0f;
+        }
+    };
+    
+    // (0,1] with spacing 2^-24. Safe for -log(u).
+    struct Conversion_OpenClosed
+    {
+        static constexpr std::size_t floats_per_word = 2;
+        
+        force_inline static constexpr float FromBits32( const std::uint32_t i ) noexcept
+        {
+            return ((i >> 8) + 1u) * 0x1.0p-24f;
+        }
+    };
+    
+    // (0,1): the midpoints (2k+1) 2^-24 of the grid with spacing 2^-23, by the exponent trick.
+    // The subtraction is exact (Sterbenz), so the result is symmetric under u -> 1 - u.
+    struct Conversion_Open
+    {
+        static constexpr std::size_t floats_per_word = 2;
+        
+        force_inline static constexpr float FromBits32( const std::uint32_t i ) noexcept
+        {
+            return std::bit_cast<float>( (i >> 9) | 0x3f800000u ) - (1.0f - 0x1.0p-24f);
+        }
+    };
+    
+    // [2^-42,1), hitting every float in [2^-41,1) with probability proportional to its spacing.
+    // The exponent is geometrically distributed: it is read off from the number of leading
+    // zeros of the lower 41 bits. The upper (strongest) 23 bits are the mantissa. Never returns 0.
+    struct Conversion_Dense
+    {
+        static constexpr std::size_t floats_per_word = 1;
+        
+        force_inline static constexpr float FromBits64( const std::uint64_t i ) noexcept
+        {
+            // The extra bit caps the count at 41.
+            const std::uint32_t lz = static_cast<std::uint32_t>( std::countl_zero( (i << 23) | (std::uint64_t(1) << 22) ) );
+            
+            return std::bit_cast<float>( ((126u - lz) << 23) | static_cast<std::uint32_t>(i >> 41) );
+        }
+    };
 }
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Randomizor
+{
+    // Arbitrary jump-ahead for linear engines such as xoshiro.
+    //
+    // The state transition T of a linear engine is a linear map over GF(2). Advancing by N steps
+    // is the same as evaluating the polynomial x^N mod P(x) at T, where P is the characteristic
+    // polynomial of T. Jump() and LongJump() do exactly this for N = 2^128 and N = 2^192 with
+    // hard-coded polynomials. Here we compute P once by Berlekamp-Massey from a bit sequence of the
+    // engine, tabulate x^(2^k) mod P for all k by repeated squaring, and then obtain x^N mod P for
+    // any 256-bit N with one product per set bit of N. So the cost is O(log N), followed by one
+    // application of the polynomial (as many steps of the engine as the state has bits).
+    template<typename Engine_T>
+    class JumpAhead
+    {
+    public:
+
+        using Engine     = Engine_T;
+        using state_type = typename Engine::state_type;
+        using UInt       = typename state_type::value_type;
+
+        // Degree of the characteristic polynomial = number of state bits.
+        static constexpr std::size_t degree    = 8 * sizeof(state_type);
+        static constexpr std::size_t word_bits = 64;
+        static constexpr std::size_t word_count = degree / word_bits + 1;
+
+        // Coefficient of x^i is bit (i % 64) of word i / 64.
+        using Polynomial = std::array<std::uint64_t,word_count>;
+
+        // A jump distance given as 64-bit digits, least significant first.
+        using Distance = std::array<std::uint64_t,4>;
+
+        static const JumpAhead & Get()
+        {
+            static const JumpAhead jump_ahead;
+
+            return jump_ahead;
+        }
+
+        // Returns x^(2^k) mod P.
+        const Polynomial & PowerOfTwo( const std::size_t k ) const
+        {
+            return powers[k];
+        }
+
+        const Polynomial & CharacteristicPolynomial() const
+        {
+            return P;
+        }
+
+        // Returns x^N mod P.
+        Polynomial JumpPolynomial( const Distance & N ) const
+        {
+            Polynomial result = {};
+            result[0] = 1;
+
+            for( std::size_t a = 0; a < N.size(); ++a )
+            {
+                for( std::size_t b = 0; b < 64; ++b )
+                {
+                    if( (N[a] >> b) & std::uint64_t(1) )
+                    {
+                        result = MulMod( result, powers[64 * a + b] );
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        // Returns the distance x * 2^shift (modulo 2^256).
+        static Distance Shifted( const std::uint64_t x, const std::size_t shift )
+        {
+            Distance N = {};
+
+            const std::size_t w = shift / 64;
+            const std::size_t r = shift % 64;
+
+            if( w < N.size() )
+            {
+                N[w] = x << r;
+            }
+
+            if( (r != 0) && (w + 1 < N.size()) )
+            {
+                N[w+1] = x >> (64 - r);
+            }
+
+            return N;
+        }
+
+        // Returns the distance a + b (modulo 2^256).
+        static Distance Add( const Distance & a, const Distance & b )
+        {
+            Distance N = {};
+
+            std::uint64_t carry = 0;
+
+            for( std::size_t i = 0; i < N.size(); ++i )
+            {
+                const std::uint64_t sum = a[i] + carry;
+
+                carry = (sum < carry);
+
+                N[i] = sum + b[i];
+
+                carry += (N[i] < sum);
+            }
+
+            return N;
+        }
+
+        // Advances random_engine by the polynomial J, i.e., replaces its state s by J(T) s.
+        static void Apply( Engine & random_engine, const Polynomial & J )
+        {
+            state_type s = {};
+
+            for( std::size_t i = 0; i < degree; ++i )
+            {
+                if( (J[i / word_bits] >> (i % word_bits)) & std::uint64_t(1) )
+                {
+                    const state_type t = random_engine.State();
+
+                    for( std::size_t j = 0; j < s.size(); ++j )
+                    {
+                        s[j] ^= t[j];
+                    }
+                }
+
+                random_engine();
+            }
+
+            random_engine.SetState( s );
+        }
+
+        // Advances random_engine by N steps.
+        void Jump( Engine & random_engine, const Distance & N ) const
+        {
+            Apply( random_engine, JumpPolynomial( N ) );
+        }
+
+    private:
+
+        JumpAhead()
+        {
+            ComputeCharacteristicPolynomial();
+
+            // x^(2^0) = x
+            Polynomial x = {};
+            x[0] = 2;
+
+            powers.resize( 256 );
+
+            powers[0] = x;
+
+            for( std::size_t k = 1; k < 256; ++k )
+            {
+                powers[k] = MulMod( powers[k-1], powers[k-1] );
+            }
+        }
+
+        // Berlekamp-Massey over GF(2) applied to the lowest bit of the first state word.
+        void ComputeCharacteristicPolynomial()
+        {
+            Engine random_engine ( state_type{ UInt(0x9e3779b97f4a7c15ull), UInt(0xbf58476d1ce4e5b9ull) } );
+
+            const std::size_t n = 2 * degree;
+
+            std::vector<std::uint8_t> s ( n );
+
+            for( std::size_t i = 0; i < n; ++i )
+            {
+                s[i] = static_cast<std::uint8_t>( random_engine.State()[0] & UInt(1) );
+                random_engine();
+            }
+
+            std::vector<std::uint8_t> C ( n + 1, 0 );
+            std::vector<std::uint8_t> B ( n + 1, 0 );
+            C[0] = 1;
+            B[0] = 1;
+
+            std::size_t L = 0;
+            std::size_t m = 1;
+
+            for( std::size_t i = 0; i < n; ++i )
+            {
+                std::uint8_t d = s[i];
+
+                for( std::size_t j = 1; j <= L; ++j )
+                {
+                    d ^= C[j] & s[i-j];
+                }
+
+                if( d == 0 )
+                {
+                    ++m;
+                }
+                else if( 2 * L <= i )
+                {
+                    const std::vector<std::uint8_t> T = C;
+
+                    for( std::size_t j = 0; j + m <= n; ++j )
+                    {
+                        C[j+m] ^= B[j];
+                    }
+
+                    L = i + 1 - L;
+                    B = T;
+                    m = 1;
+                }
+                else
+                {
+                    for( std::size_t j = 0; j + m <= n; ++j )
+                    {
+                        C[j+m] ^= B[j];
+                    }
+
+                    ++m;
+                }
+            }
+
+            if( L != degree )
+            {
+                eprint("JumpAhead: Berlekamp-Massey found a polynomial of degree "+ToString(L)+" instead of "+ToString(degree)+".");
+            }
+
+            // The characteristic polynomial is the reciprocal of the connection polynomial C.
+            P = {};
+
+            for( std::size_t j = 0; j <= L; ++j )
+            {
+                if( C[j] )
+                {
+                    const std::size_t i = L - j;
+
+                    P[i / word_bits] |= std::uint64_t(1) << (i % word_bits);
+                }
+            }
+        }
+
+        // Returns a * b mod P.
+        Polynomial MulMod( const Polynomial & a, const Polynomial & b ) const
+        {
+            // Carry-less product with 2 * word_count words.
+            std::array<std::uint64_t,2*word_count> c = {};
+
+            for( std::size_t i = 0; i < degree; ++i )
+            {
+                if( (a[i / word_bits] >> (i % word_bits)) & std::uint64_t(1) )
+                {
+                    // c ^= b << i
+                    const std::size_t w = i / word_bits;
+                    const std::size_t r = i % word_bits;
+
+                    for( std::size_t j = 0; j < word_count; ++j )
+                    {
+                        c[j+w] ^= b[j] << r;
+
+                        if( r != 0 )
+                        {
+                            c[j+w+1] ^= b[j] >> (word_bits - r);
+                        }
+                    }
+                }
+            }
+
+            // Reduce from the top.
+            for( std::size_t i = 2 * degree; i-- > degree; )
+            {
+                if( (c[i / word_bits] >> (i % word_bits)) & std::uint64_t(1) )
+                {
+                    // c ^= P << (i - degree)
+                    const std::size_t shift = i - degree;
+                    const std::size_t w = shift / word_bits;
+                    const std::size_t r = shift % word_bits;
+
+                    for( std::size_t j = 0; j < word_count; ++j )
+                    {
+                        c[j+w] ^= P[j] << r;
+
+                        if( (r != 0) && (j+w+1 < c.size()) )
+                        {
+                            c[j+w+1] ^= P[j] >> (word_bits - r);
+                        }
+                    }
+                }
+            }
+
+            Polynomial result;
+
+            for( std::size_t j = 0; j < word_count; ++j )
+            {
+                result[j] = c[j];
+            }
+
+            return result;
+        }
+
+    private:
+
+        Polynomial P = {};
+
+        std::vector<Polynomial> powers;
+    };
+}
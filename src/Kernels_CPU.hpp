@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Metrics.hpp"
+#include "TruncatedNormal.hpp"
+#include "TabulatedDistribution.hpp"
+
+namespace Randomizor
+{
+    // Bulk kernels that fill a contiguous block of memory from a single engine.
+    // They are the CPU counterparts of the Metal kernels. Their cost is data-dependent (rejection
+    // sampling), which is why the callers hand them out through the work-stealing ThreadPool.
+
+    // The template parameters buffer_size and unroll select among loop variants that produce the
+    // same output at different speeds; Dispatch.hpp instantiates them and Tuning.hpp picks one.
+
+    // Fills a[0],...,a[n-1] with the raw output of random_engine, 64 bits per word (see Bits64).
+    // The loop is unrolled unroll times.
+    template<std::size_t unroll = 1, typename Engine>
+    force_inline void Bits_Kernel( Engine & random_engine, std::uint64_t * restrict a, const std::size_t n )
+    {
+        const std::size_t n_unrolled = n - (n % unroll);
+
+        for( std::size_t i = 0; i < n_unrolled; i += unroll )
+        {
+            for( std::size_t j = 0; j < unroll; ++j )
+            {
+                a[i+j] = Bits64( random_engine );
+            }
+        }
+
+        for( std::size_t i = n_unrolled; i < n; ++i )
+        {
+            a[i] = Bits64( random_engine );
+        }
+    }
+
+    // Converts random bits to n floats in [0,1) with the given policy (see Helpers.hpp): two floats
+    // per word, low half first, or one float per word.
+    template<typename Conversion = Conversion_Standard>
+    force_inline void UniformFromBits_Kernel( const std::uint64_t * restrict bits, float * restrict a, const std::size_t n )
+    {
+        if constexpr ( Conversion::floats_per_word == 2 )
+        {
+            const std::size_t n_even = n - (n % 2);
+
+            for( std::size_t i = 0; i < n_even; i += 2 )
+            {
+                a[i+0] = Conversion::FromBits32( static_cast<std::uint32_t>(bits[i/2]      ) );
+                a[i+1] = Conversion::FromBits32( static_cast<std::uint32_t>(bits[i/2] >> 32) );
+            }
+
+            if( n_even < n )
+            {
+                a[n_even] = Conversion::FromBits32( static_cast<std::uint32_t>(bits[n_even/2]) );
+            }
+        }
+        else
+        {
+            for( std::size_t i = 0; i < n; ++i )
+            {
+                a[i] = Conversion::FromBits64( bits[i] );
+            }
+        }
+    }
+
+    // Fills a[0],...,a[n-1] with uniformly distributed floats in [0,1) (or the interval of the
+    // conversion policy). The engine runs serially, but the conversion is a loop that vectorizes,
+    // so the bits go through a buffer of buffer_size words. With buffer_size == 0, every word is
+    // converted right away instead, which needs no buffer but does not vectorize.
+    template<
+        typename Conversion = Conversion_Standard, std::size_t buffer_size = 256, std::size_t unroll = 1,
+        typename Engine
+    >
+    force_inline void Uniform_Kernel( Engine & random_engine, float * restrict a, const std::size_t n )
+    {
+        constexpr std::size_t k = Conversion::floats_per_word;
+
+        if constexpr ( buffer_size == 0 )
+        {
+            const std::size_t word_count = (n + k - 1) / k;
+
+            for( std::size_t w = 0; w < word_count; ++w )
+            {
+                std::uint64_t bits [1];
+
+                Bits_Kernel( random_engine, &bits[0], 1 );
+
+                UniformFromBits_Kernel<Conversion>( &bits[0], &a[k * w], std::min( k, n - k * w ) );
+            }
+        }
+        else
+        {
+            std::uint64_t bits [buffer_size];
+
+            for( std::size_t i = 0; i < n; i += k * buffer_size )
+            {
+                const std::size_t m = std::min( k * buffer_size, n - i );
+
+                Bits_Kernel<unroll>( random_engine, &bits[0], (m + k - 1) / k );
+
+                UniformFromBits_Kernel<Conversion>( &bits[0], &a[i], m );
+            }
+        }
+    }
+
+    // Fills a[0],...,a[n-1] with standard normally distributed floats.
+    // With metrics enabled, the rejected attempts of the polar method are counted once per call.
+    template<typename Engine>
+    force_inline void Normal_Kernel( Engine & random_engine, float * restrict a, const std::size_t n )
+    {
+        const std::size_t n_even = n - (n % 2);
+
+        std::uint64_t rejections = 0;
+
+        for( std::size_t i = 0; i < n_even; i += 2 )
+        {
+            rejections += getNormalFloatPair( random_engine, a[i+0], a[i+1] );
+        }
+
+        if( n_even < n )
+        {
+            float y;
+
+            rejections += getNormalFloatPair( random_engine, a[n_even], y );
+        }
+
+        if constexpr ( metrics_enabled )
+        {
+            RANDOMIZOR_METRIC_ITERATIONS( "Normal_Kernel", rejections );
+        }
+    }
+
+    // Fills a[0],...,a[n-1] with samples of N(mu,sigma^2). The normal samples are transformed in
+    // blocks right after they are made, while they are still in the L1 cache; so the output is
+    // mu + sigma * x for the output x of Normal_Kernel. std::fma, instead of a product and a sum
+    // that some ISA levels would contract, keeps the output the same on all of them.
+    template<typename Engine>
+    force_inline void AffineNormal_Kernel( Engine & random_engine, float * restrict a, const std::size_t n, const float mu, const float sigma )
+    {
+        constexpr std::size_t block_size = 256;
+
+        for( std::size_t i = 0; i < n; i += block_size )
+        {
+            const std::size_t m = std::min( block_size, n - i );
+
+            Normal_Kernel( random_engine, &a[i], m );
+
+            for( std::size_t k = 0; k < m; ++k )
+            {
+                a[i+k] = std::fma( sigma, a[i+k], mu );
+            }
+        }
+    }
+
+    // Same as AffineNormal_Kernel, but with the parameters mu[i] and sigma[i] for a[i].
+    template<typename Engine>
+    force_inline void AffineNormalArray_Kernel(
+        Engine & random_engine, float * restrict a, const std::size_t n,
+        const float * restrict mu, const float * restrict sigma
+    )
+    {
+        constexpr std::size_t block_size = 256;
+
+        for( std::size_t i = 0; i < n; i += block_size )
+        {
+            const std::size_t m = std::min( block_size, n - i );
+
+            Normal_Kernel( random_engine, &a[i], m );
+
+            for( std::size_t k = 0; k < m; ++k )
+            {
+                a[i+k] = std::fma( sigma[i+k], a[i+k], mu[i+k] );
+            }
+        }
+    }
+
+    // Fills a[0],...,a[n-1] with samples of the tabulated distribution D, one random word per
+    // sample (see TabulatedDistribution::Transform).
+    template<typename Engine>
+    force_inline void Tabulated_Kernel( Engine & random_engine, float * restrict a, const std::size_t n, const TabulatedDistribution & D )
+    {
+        constexpr std::size_t buffer_size = 256;
+
+        std::uint64_t bits [buffer_size];
+
+        for( std::size_t i = 0; i < n; i += buffer_size )
+        {
+            const std::size_t m = std::min( buffer_size, n - i );
+
+            Bits_Kernel( random_engine, &bits[0], m );
+
+            D.Transform( &bits[0], &a[i], m );
+        }
+    }
+
+    // Bernoulli samples, 64 per word: bit j of the result is 1 with probability
+    // p = p_bits / 2^(64 + p_zeros), independently for all j. Each bit compares a uniform number
+    // U_j in [0,1) with p, one binary digit at a time from the most significant one on; bit j of
+    // the k-th random word is the complement of the k-th digit of U_j. So the 64 comparisons run
+    // in parallel, and they stop as soon as all of them are decided, or when the remaining digits
+    // of p are all zero (then U_j >= p for the undecided ones). The p_zeros leading zero digits of
+    // p only decide U_j > p, so a tiny p costs no more than any other. That takes 7.3 words on
+    // average, and fewer if p has only a few binary digits; for p = 1/2 the result is the random
+    // word itself.
+    template<typename Engine>
+    force_inline std::uint64_t BernoulliWord( Engine & random_engine, const std::uint64_t p_bits, const std::size_t p_zeros = 0 )
+    {
+        std::uint64_t result    = 0;
+        std::uint64_t undecided = ~std::uint64_t(0);
+        std::uint64_t p_digits  = p_bits;
+
+        // Digit of p is 0: U_j > p if its digit is 1.
+        for( std::size_t k = 0; (k < p_zeros) && (undecided != 0); ++k )
+        {
+            undecided &= Bits64( random_engine );
+        }
+
+        while( (undecided != 0) && (p_digits != 0) )
+        {
+            const std::uint64_t r = Bits64( random_engine );
+
+            if( p_digits >> 63 )
+            {
+                // Digit of p is 1: U_j < p if its digit is 0.
+                result    |= undecided & r;
+                undecided &= ~r;
+            }
+            else
+            {
+                // Digit of p is 0: U_j > p if its digit is 1.
+                undecided &= r;
+            }
+
+            p_digits <<= 1;
+        }
+
+        return result;
+    }
+
+    // Fills a[0],...,a[n-1] with packed Bernoulli samples (see BernoulliWord).
+    template<typename Engine>
+    force_inline void Bernoulli_Kernel( Engine & random_engine, std::uint64_t * restrict a, const std::size_t n, const std::uint64_t p_bits, const std::size_t p_zeros = 0 )
+    {
+        if( (p_bits == (std::uint64_t(1) << 63)) && (p_zeros == 0) )
+        {
+            Bits_Kernel( random_engine, a, n );
+            return;
+        }
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            a[i] = BernoulliWord( random_engine, p_bits, p_zeros );
+        }
+    }
+
+    // Splits p in (0,1) into p = p_bits / 2^(64 + p_zeros) with the top bit of p_bits set, the
+    // arguments of BernoulliWord. This is exact for every double, including subnormal ones.
+    inline void BernoulliDigits( const double p, std::uint64_t & p_bits, std::size_t & p_zeros )
+    {
+        int exponent;
+
+        // p = f * 2^exponent with f in [1/2,1) and exponent <= 0; f has at most 53 digits.
+        const double f = std::frexp( p, &exponent );
+
+        p_bits  = static_cast<std::uint64_t>( std::ldexp( f, 64 ) );
+        p_zeros = static_cast<std::size_t>( -exponent );
+    }
+
+    // Writes bit i of bits[0],bits[1],... to a[i] as 0 or 1, for i = 0,...,n-1. Spreads 8 bits at
+    // a time to the 8 bytes of a word with a multiplication, so the loop vectorizes.
+    force_inline void UnpackBits_Kernel( const std::uint64_t * restrict bits, std::uint8_t * restrict a, const std::size_t n )
+    {
+        constexpr std::uint64_t spread = 0x0101010101010101;
+        constexpr std::uint64_t select = 0x8040201008040201;
+        constexpr std::uint64_t carry  = 0x7F7F7F7F7F7F7F7F;
+
+        const std::size_t byte_count = n / 8;
+
+        for( std::size_t k = 0; k < byte_count; ++k )
+        {
+            const std::uint64_t b = (bits[k / 8] >> (8 * (k % 8))) & 0xFF;
+
+            // Byte l of (b * spread) & select is nonzero iff bit l of b is set; adding 0x7F moves
+            // that to the top bit of the byte without a carry into the next one.
+            const std::uint64_t x = ((((b * spread) & select) + carry) >> 7) & spread;
+
+            std::memcpy( &a[8 * k], &x, 8 );
+        }
+
+        for( std::size_t i = 8 * byte_count; i < n; ++i )
+        {
+            a[i] = static_cast<std::uint8_t>( (bits[i / 64] >> (i % 64)) & 1 );
+        }
+    }
+
+    // Fills a[0],...,a[n-1] with Bernoulli samples, one byte (0 or 1) per sample. The bytes are
+    // the bits that Bernoulli_Kernel would produce, in the same order.
+    template<std::size_t buffer_size = 64, typename Engine>
+    force_inline void BernoulliBytes_Kernel( Engine & random_engine, std::uint8_t * restrict a, const std::size_t n, const std::uint64_t p_bits, const std::size_t p_zeros = 0 )
+    {
+        std::uint64_t bits [buffer_size];
+
+        for( std::size_t i = 0; i < n; i += 64 * buffer_size )
+        {
+            const std::size_t m = std::min( 64 * buffer_size, n - i );
+
+            Bernoulli_Kernel( random_engine, &bits[0], (m + 63) / 64, p_bits, p_zeros );
+
+            UnpackBits_Kernel( &bits[0], &a[i], m );
+        }
+    }
+
+    // Double precision variants, with 53 random bits per sample.
+
+    // Fills a[0],...,a[n-1] with uniformly distributed doubles in [0,1).
+    template<typename Engine>
+    void Uniform_Kernel( Engine & random_engine, double * restrict a, const std::size_t n )
+    {
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            a[i] = DoubleFromBits( Bits64( random_engine ) );
+        }
+    }
+
+    // Polar method in double precision; consumes two 64-bit numbers per attempt.
+    template<typename Engine>
+    force_inline void getNormalDoublePair( Engine & random_engine, double & a, double & b )
+    {
+        double x;
+        double y;
+        double s;
+
+        do
+        {
+            x = 0x1.0p-52 * static_cast<double>( static_cast<std::int64_t>(Bits64( random_engine )) >> 11 );
+            y = 0x1.0p-52 * static_cast<double>( static_cast<std::int64_t>(Bits64( random_engine )) >> 11 );
+            s = x * x + y * y;
+        } while ( s > 1. || s == 0. );
+
+        const double r = std::sqrt(- 2. * std::log(s) / s );
+        a = r * x;
+        b = r * y;
+    }
+
+    // Fills a[0],...,a[n-1] with standard normally distributed doubles.
+    template<typename Engine>
+    void Normal_Kernel( Engine & random_engine, double * restrict a, const std::size_t n )
+    {
+        const std::size_t n_even = n - (n % 2);
+
+        for( std::size_t i = 0; i < n_even; i += 2 )
+        {
+            getNormalDoublePair( random_engine, a[i+0], a[i+1] );
+        }
+
+        if( n_even < n )
+        {
+            double y;
+
+            getNormalDoublePair( random_engine, a[n_even], y );
+        }
+    }
+}
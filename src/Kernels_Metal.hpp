@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace Randomizor
+{
+    // Descriptions of the Metal kernels for Randomizor_Metal_Emulator and for the small requests
+    // that Randomizor_Metal serves on the CPU: how a GPU thread reads and writes its state in the
+    // states buffer, and one float4 chunk of uniform floats computed the way the kernel does it.
+    // The states buffer is the one of Randomizor_Metal, an array of 64-bit words with
+    // StateSize() = 32 bytes per GPU thread, as Seed fills it.
+
+    // Xoshiro256Plus_UniformDistribution and Xoshiro256Plus_NormalDistribution. Thread i reads the
+    // ulong4 states[i], i.e., words 4 * i,...,4 * i + 3, and writes them back.
+    struct Xoshiro256Plus_Metal_Kernel
+    {
+        using Lanes      = XoshiroLanes<Xoshiro256Plus>;
+        using state_type = Xoshiro256Plus::state_type;
+
+        static state_type LoadState( const std::uint64_t * restrict states, const std::size_t i )
+        {
+            return { states[4 * i + 0], states[4 * i + 1], states[4 * i + 2], states[4 * i + 3] };
+        }
+
+        static void StoreState( std::uint64_t * restrict states, const std::size_t i, const state_type & state )
+        {
+            states[4 * i + 0] = state[0];
+            states[4 * i + 1] = state[1];
+            states[4 * i + 2] = state[2];
+            states[4 * i + 3] = state[3];
+        }
+
+        // Two outputs, each split into two floats, low half first.
+        static void Chunk( state_type & state, float * restrict u )
+        {
+            for( std::size_t r = 0; r < 2; ++r )
+            {
+                const std::uint64_t bits = Xoshiro256Plus::Step( state );
+
+                u[2 * r + 0] = FloatFrom32Bits( static_cast<std::uint32_t>(bits      ) );
+                u[2 * r + 1] = FloatFrom32Bits( static_cast<std::uint32_t>(bits >> 32) );
+            }
+        }
+
+        static std::string MetalClassName()
+        {
+            return "Randomizor_Metal_Xoshiro";
+        }
+    };
+
+    // PCG_UniformDistribution and PCG_NormalDistribution. These declare the states as ulong2, so
+    // thread i reads words 2 * i and 2 * i + 1 as { state, increment }, although Seed writes four
+    // words per thread; thread 2k gets words 0,1 and thread 2k+1 words 2,3 of what Seed meant for
+    // thread k. When done, the kernels assign the 64-bit state to the ulong2, which stores it into
+    // both components; so from the second call on, the increment is the last state (made odd).
+    // We reproduce both effects, since the output depends on them.
+    struct PCG_Metal_Kernel
+    {
+        using Lanes      = PCG32StreamLanes;
+        using state_type = PCG32::state_type;
+
+        static state_type LoadState( const std::uint64_t * restrict states, const std::size_t i )
+        {
+            return { states[2 * i + 0], states[2 * i + 1] };
+        }
+
+        static void StoreState( std::uint64_t * restrict states, const std::size_t i, const state_type & state )
+        {
+            states[2 * i + 0] = state[0];
+            states[2 * i + 1] = state[0];
+        }
+
+        // Four outputs of 32 bits.
+        static void Chunk( state_type & state, float * restrict u )
+        {
+            PCG32 random_engine ( state );
+
+            for( std::size_t k = 0; k < 4; ++k )
+            {
+                u[k] = FloatFrom32Bits( random_engine() );
+            }
+
+            state = random_engine.State();
+        }
+
+        static std::string MetalClassName()
+        {
+            return "Randomizor_Metal_PCG";
+        }
+    };
+
+    // Writes a[0],...,a[n-1] as a fill of the reservoir by thread_count GPU threads would write
+    // them, but on the calling thread: GPU thread i computes the chunks i, i + thread_count, ...
+    // of the ceil( n / 4 ) chunks that a needs, and stores its state back once, as the kernel
+    // does. A trailing partial chunk is computed in full and cut off. Unlike on the GPU, only the
+    // threads that compute one of these chunks advance.
+    template<typename Kernel, bool normal>
+    void RandomizeChunks_CPU(
+        std::uint64_t * restrict states, const std::size_t thread_count,
+        float * restrict a, const std::size_t n
+    )
+    {
+        const std::size_t chunk_count = (n + 3) / 4;
+
+        const std::size_t used_thread_count = std::min( chunk_count, thread_count );
+
+        for( std::size_t i = 0; i < used_thread_count; ++i )
+        {
+            typename Kernel::state_type state = Kernel::LoadState( states, i );
+
+            for( std::size_t c = i; c < chunk_count; c += thread_count )
+            {
+                float u [4];
+
+                Kernel::Chunk( state, &u[0] );
+
+                if constexpr ( normal )
+                {
+                    BoxMuller_Chunk( &u[0] );
+                }
+
+                std::memcpy( &a[4 * c], &u[0], std::min( std::size_t(4), n - 4 * c ) * sizeof(float) );
+            }
+
+            Kernel::StoreState( states, i, state );
+        }
+    }
+}
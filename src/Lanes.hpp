@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+namespace Randomizor
+{
+    // Many independent copies ("lanes") of an engine with their states stored as structure of
+    // arrays, so that one round, which advances every lane once, is a plain loop over arrays that
+    // the compiler vectorizes for whatever SIMD width the target has.
+    //
+    // Next( out ) writes one output per lane, out[l] for lane l. This is also the memory layout
+    // of the Metal kernels, where GPU thread l writes chunk j * threads_per_grid + l; see
+    // Uniform_Chunks and Normal_Chunks below.
+    //
+    // SplitMix64Lanes and PCG32Lanes are arranged such that the interleaved output of all lanes is
+    // exactly the output of one scalar engine. XoshiroLanes cannot do that cheaply; its lanes are
+    // one Jump() apart, like the streams of the samplers. It takes any engine of Xoshiro.hpp; with
+    // xoshiro128 the lanes are 32 bits wide, so twice as many fit into a vector register.
+
+    template<typename Engine_T = Xoshiro256Plus>
+    class XoshiroLanes
+    {
+    public:
+
+        using Engine      = Engine_T;
+        using UInt        = typename Engine::UInt;
+        using result_type = UInt;
+        using state_type  = typename Engine::state_type;
+
+        static constexpr std::size_t word_count = std::tuple_size_v<state_type>;
+
+        // Lane l starts with the state of random_engine after l calls of Jump().
+        XoshiroLanes( Engine random_engine, const std::size_t lane_count_ )
+        :   lane_count ( lane_count_ )
+        ,   s ( word_count * lane_count_ )
+        {
+            for( std::size_t l = 0; l < lane_count; ++l )
+            {
+                SetState( l, random_engine.State() );
+                random_engine.Jump();
+            }
+        }
+
+        // Lane l starts with states[l].
+        XoshiroLanes( const state_type * states, const std::size_t lane_count_ )
+        :   lane_count ( lane_count_ )
+        ,   s ( word_count * lane_count_ )
+        {
+            for( std::size_t l = 0; l < lane_count; ++l )
+            {
+                SetState( l, states[l] );
+            }
+        }
+
+        std::size_t LaneCount() const
+        {
+            return lane_count;
+        }
+
+        void Next( UInt * restrict out )
+        {
+            // A local copy, since out might alias lane_count as far as the compiler knows.
+            const std::size_t L = lane_count;
+
+            UInt * restrict v = s.data();
+
+            for( std::size_t l = 0; l < L; ++l )
+            {
+                state_type x;
+
+                for( std::size_t k = 0; k < word_count; ++k )
+                {
+                    x[k] = v[k * L + l];
+                }
+
+                out[l] = Engine::Step( x );
+
+                for( std::size_t k = 0; k < word_count; ++k )
+                {
+                    v[k * L + l] = x[k];
+                }
+            }
+        }
+
+        state_type State( const std::size_t l ) const
+        {
+            state_type state;
+
+            for( std::size_t k = 0; k < word_count; ++k )
+            {
+                state[k] = s[k * lane_count + l];
+            }
+
+            return state;
+        }
+
+        void SetState( const std::size_t l, const state_type & state )
+        {
+            for( std::size_t k = 0; k < word_count; ++k )
+            {
+                s[k * lane_count + l] = state[k];
+            }
+        }
+
+    private:
+
+        std::size_t lane_count;
+
+        std::vector<UInt> s;
+    };
+
+    using Xoshiro256PlusLanes = XoshiroLanes<Xoshiro256Plus>;
+
+    class SplitMix64Lanes
+    {
+    public:
+
+        using UInt        = std::uint64_t;
+        using result_type = UInt;
+
+        static constexpr UInt gamma = 0x9e3779b97f4a7c15ull;
+
+        // The interleaved output equals the output of SplitMix64{ seed }.
+        SplitMix64Lanes( const UInt seed, const std::size_t lane_count_ )
+        :   lane_count ( lane_count_ )
+        ,   stride     ( lane_count_ * gamma )
+        ,   s          ( lane_count_ )
+        {
+            // Lane l produces outputs l, l + lane_count, ...; Next adds stride before mixing.
+            for( std::size_t l = 0; l < lane_count; ++l )
+            {
+                s[l] = seed + (l + 1) * gamma - stride;
+            }
+        }
+
+        std::size_t LaneCount() const
+        {
+            return lane_count;
+        }
+
+        void Next( UInt * restrict out )
+        {
+            const std::size_t L = lane_count;
+
+            UInt * restrict state = s.data();
+
+            for( std::size_t l = 0; l < L; ++l )
+            {
+                UInt z = (state[l] += stride);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                out[l] = z ^ (z >> 31);
+            }
+        }
+
+    private:
+
+        std::size_t lane_count;
+
+        UInt stride;
+
+        std::vector<UInt> s;
+    };
+
+    class PCG32Lanes
+    {
+    public:
+
+        using UInt        = std::uint64_t;
+        using result_type = std::uint32_t;
+
+        // The interleaved output equals the output of random_engine.
+        PCG32Lanes( PCG32 random_engine, const std::size_t lane_count_ )
+        :   lane_count ( lane_count_ )
+        ,   s          ( lane_count_ )
+        {
+            const std::array<UInt,2> stride = PCG32::Stride( lane_count, random_engine.State()[1] );
+
+            mult = stride[0];
+            plus = stride[1];
+
+            for( std::size_t l = 0; l < lane_count; ++l )
+            {
+                s[l] = random_engine.State()[0];
+                random_engine();
+            }
+        }
+
+        std::size_t LaneCount() const
+        {
+            return lane_count;
+        }
+
+        void Next( result_type * restrict out )
+        {
+            const std::size_t L = lane_count;
+
+            UInt * restrict state = s.data();
+
+            for( std::size_t l = 0; l < L; ++l )
+            {
+                const UInt oldstate = state[l];
+                state[l] = oldstate * mult + plus;
+                out[l] = PCG32::Output( oldstate );
+            }
+        }
+
+    private:
+
+        std::size_t lane_count;
+
+        UInt mult;
+        UInt plus;
+
+        std::vector<UInt> s;
+    };
+
+    // Lanes with independent PCG32 streams, each with its own state and increment, like the GPU
+    // threads of the Metal PCG kernels. Unlike PCG32Lanes, the lanes are not parts of one sequence.
+    class PCG32StreamLanes
+    {
+    public:
+
+        using UInt        = std::uint64_t;
+        using result_type = std::uint32_t;
+        using state_type  = PCG32::state_type;
+
+        // Lane l starts with states[l].
+        PCG32StreamLanes( const state_type * states, const std::size_t lane_count_ )
+        :   lane_count ( lane_count_ )
+        ,   s          ( lane_count_ )
+        ,   inc        ( lane_count_ )
+        {
+            for( std::size_t l = 0; l < lane_count; ++l )
+            {
+                SetState( l, states[l] );
+            }
+        }
+
+        std::size_t LaneCount() const
+        {
+            return lane_count;
+        }
+
+        void Next( result_type * restrict out )
+        {
+            const std::size_t L = lane_count;
+
+                  UInt * restrict state = s.data();
+            const UInt * restrict plus  = inc.data();
+
+            for( std::size_t l = 0; l < L; ++l )
+            {
+                const UInt oldstate = state[l];
+                state[l] = oldstate * PCG32::multiplier + plus[l];
+                out[l] = PCG32::Output( oldstate );
+            }
+        }
+
+        // The increment is returned as the odd number that is actually used.
+        state_type State( const std::size_t l ) const
+        {
+            return { s[l], inc[l] };
+        }
+
+        void SetState( const std::size_t l, const state_type & state )
+        {
+            s[l]   = state[0];
+            inc[l] = state[1] | 1;
+        }
+
+    private:
+
+        std::size_t lane_count;
+
+        std::vector<UInt> s;
+        std::vector<UInt> inc;
+    };
+
+    // The Metal kernels write one float4 per GPU thread and grid step, made from 128 random bits of
+    // the thread's engine: two 64-bit outputs of xoshiro (low half first) or four outputs of PCG.
+    // With one lane per GPU thread, a[4 * (j * lane_count + l) + k] is component k of the chunk
+    // that thread l writes in grid step j.
+
+    // Fills chunk_rounds * lane_count float4 chunks of uniform floats in [0,1).
+    // bits must have room for 4 * lane_count words of 32 bits.
+    template<typename Lanes_T>
+    void Uniform_Chunks( Lanes_T & lanes, float * restrict a, const std::size_t chunk_rounds, std::uint32_t * restrict bits )
+    {
+        using R = typename Lanes_T::result_type;
+
+        constexpr std::size_t words_per_output = sizeof(R) / sizeof(std::uint32_t);
+        constexpr std::size_t rounds_per_chunk = 4 / words_per_output;
+
+        const std::size_t L = lanes.LaneCount();
+
+        for( std::size_t j = 0; j < chunk_rounds; ++j )
+        {
+            for( std::size_t r = 0; r < rounds_per_chunk; ++r )
+            {
+                lanes.Next( reinterpret_cast<R *>(&bits[r * words_per_output * L]) );
+            }
+
+            float * restrict chunk = &a[4 * j * L];
+
+            for( std::size_t l = 0; l < L; ++l )
+            {
+                for( std::size_t k = 0; k < 4; ++k )
+                {
+                    // Word w of output r of lane l sits at bits[(r * L + l) * words_per_output + w].
+                    const std::size_t r = k / words_per_output;
+                    const std::size_t w = k % words_per_output;
+
+                    chunk[4 * l + k] = FloatFrom32Bits( bits[(r * L + l) * words_per_output + w] );
+                }
+            }
+        }
+    }
+
+    // The Box-Muller transform of the Metal normal kernels, in place on one float4 chunk of uniform
+    // floats. Every operation is a single float operation in the order of the kernel (no
+    // contraction into fma), so the values agree with the GPU up to the rounding of log, sqrt and
+    // sincos.
+    force_inline void BoxMuller_Chunk( float * restrict u )
+    {
+        const float r0 = std::sqrt( -2.0f * std::log( 1.0f - u[0] ) );
+        const float r1 = std::sqrt( -2.0f * std::log( 1.0f - u[2] ) );
+
+        const float phi0 = 6.283185307179586f * u[1];
+        const float phi1 = 6.283185307179586f * u[3];
+
+        u[0] = r0 * std::cos( phi0 );
+        u[1] = r0 * std::sin( phi0 );
+        u[2] = r1 * std::cos( phi1 );
+        u[3] = r1 * std::sin( phi1 );
+    }
+
+    // Same as Uniform_Chunks followed by the Box-Muller transform of the Metal normal kernels.
+    // The layout is exact; the values agree with the GPU up to the rounding of log, sqrt and sincos.
+    template<typename Lanes_T>
+    void Normal_Chunks( Lanes_T & lanes, float * restrict a, const std::size_t chunk_rounds, std::uint32_t * restrict bits )
+    {
+        Uniform_Chunks( lanes, a, chunk_rounds, bits );
+
+        const std::size_t chunk_count = chunk_rounds * lanes.LaneCount();
+
+        for( std::size_t c = 0; c < chunk_count; ++c )
+        {
+            BoxMuller_Chunk( &a[4 * c] );
+        }
+    }
+}
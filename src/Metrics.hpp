@@ -0,0 +1,411 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+namespace Randomizor
+{
+    // Counters for the public entry points of the samplers, compiled in only with
+    // -DRANDOMIZOR_METRICS. Without it, the macros below expand to nothing and their arguments are
+    // not even evaluated, so the instrumentation costs nothing.
+    //
+    // A site is named by a string literal, which is interned once into a small integer tag (the
+    // first call of the site takes a mutex, later calls only read a function-local static). Each
+    // thread adds to its own block of relaxed atomic counters, so recording never contends and,
+    // after the first call of the thread, never allocates. Snapshot() sums over the blocks of all live
+    // threads and the totals that exited threads left behind.
+    //
+    // Per tag, we count calls, samples, bytes, wall time and CPU time of the calling thread (the time
+    // that pool workers spend is in the wall time, not in the CPU time), and iterations of rejection
+    // loops (the excess of attempts over accepted pairs in the polar method). Reading the thread's
+    // CPU clock is a system call on many machines, which would cost more than a small fill itself.
+    // So it is read only for calls of at least cpu_time_min_bytes bytes; smaller calls run inline on
+    // the calling thread, and their CPU time is taken to be their wall time.
+    //
+    //     RANDOMIZOR_METRIC_SCOPE( "Randomizor_CPU::Fill_Normal", n, n * sizeof(float) );
+    //     RANDOMIZOR_METRIC_ITERATIONS( "Normal_Kernel", rejections );
+
+#if defined(RANDOMIZOR_METRICS)
+    inline constexpr bool metrics_enabled = true;
+#else
+    inline constexpr bool metrics_enabled = false;
+#endif
+
+    struct MetricValues
+    {
+        std::uint64_t calls       = 0;
+        std::uint64_t samples     = 0;
+        std::uint64_t bytes       = 0;
+        std::uint64_t wall_ns     = 0;
+        std::uint64_t cpu_ns      = 0;
+        std::uint64_t iterations  = 0;
+
+        MetricValues & operator+=( const MetricValues & other )
+        {
+            calls      += other.calls;
+            samples    += other.samples;
+            bytes      += other.bytes;
+            wall_ns    += other.wall_ns;
+            cpu_ns     += other.cpu_ns;
+            iterations += other.iterations;
+
+            return *this;
+        }
+    };
+
+    struct MetricSample
+    {
+        std::string  name;
+        MetricValues values;
+    };
+
+    class Metrics
+    {
+    public:
+
+        using Tag = std::uint32_t;
+
+        static constexpr std::size_t max_tag_count = 256;
+
+        static constexpr std::size_t field_count = 6;
+
+        static constexpr std::uint64_t cpu_time_min_bytes = std::uint64_t(1) << 16;
+
+        // Returns the tag of name, registering it on first use. Sites call this once and keep the
+        // result in a static. Beyond max_tag_count names, everything goes to the last tag.
+        static Tag Intern( const char * name )
+        {
+            Registry & r = GetRegistry();
+
+            std::lock_guard<std::mutex> lock ( r.mutex );
+
+            for( std::size_t i = 0; i < r.names.size(); ++i )
+            {
+                if( r.names[i] == name )
+                {
+                    return static_cast<Tag>(i);
+                }
+            }
+
+            if( r.names.size() + 1 >= max_tag_count )
+            {
+                r.names.resize( max_tag_count, "overflow" );
+
+                return static_cast<Tag>(max_tag_count - 1);
+            }
+
+            r.names.emplace_back( name );
+
+            return static_cast<Tag>(r.names.size() - 1);
+        }
+
+        // Only the owning thread writes to its block, so a relaxed load and store suffice; no locked
+        // read-modify-write is needed.
+        static void Record( const Tag tag, const MetricValues & v )
+        {
+            std::atomic<std::uint64_t> * c = LocalBlock().counters[tag].data();
+
+            Add( c[0], v.calls      );
+            Add( c[1], v.samples    );
+            Add( c[2], v.bytes      );
+            Add( c[3], v.wall_ns    );
+            Add( c[4], v.cpu_ns     );
+            Add( c[5], v.iterations );
+        }
+
+        static void AddIterations( const Tag tag, const std::uint64_t count )
+        {
+            Add( LocalBlock().counters[tag][5], count );
+        }
+
+        // Totals per registered tag, over all threads.
+        static std::vector<MetricSample> Snapshot()
+        {
+            Registry & r = GetRegistry();
+
+            std::lock_guard<std::mutex> lock ( r.mutex );
+
+            std::vector<MetricSample> result ( r.names.size() );
+
+            for( std::size_t i = 0; i < r.names.size(); ++i )
+            {
+                result[i].name   = r.names[i];
+                result[i].values = r.retired[i];
+
+                for( const Block * block : r.blocks )
+                {
+                    result[i].values += block->Load( i );
+                }
+            }
+
+            return result;
+        }
+
+        // Sets all counters to zero. Counts that other threads record at the same time may survive.
+        static void Reset()
+        {
+            Registry & r = GetRegistry();
+
+            std::lock_guard<std::mutex> lock ( r.mutex );
+
+            for( std::size_t i = 0; i < max_tag_count; ++i )
+            {
+                r.retired[i] = MetricValues();
+
+                for( Block * block : r.blocks )
+                {
+                    for( auto & c : block->counters[i] )
+                    {
+                        c.store( 0, std::memory_order_relaxed );
+                    }
+                }
+            }
+        }
+
+        static std::string ToJSON()
+        {
+            std::stringstream s;
+
+            s << "{\n  \"enabled\": " << (metrics_enabled ? "true" : "false") << ",\n  \"metrics\": [";
+
+            const std::vector<MetricSample> snapshot = Snapshot();
+
+            for( std::size_t i = 0; i < snapshot.size(); ++i )
+            {
+                const MetricValues & v = snapshot[i].values;
+
+                s << (i == 0 ? "\n" : ",\n")
+                  << "    { \"name\": \"" << snapshot[i].name << "\""
+                  << ", \"calls\": "      << v.calls
+                  << ", \"samples\": "    << v.samples
+                  << ", \"bytes\": "      << v.bytes
+                  << ", \"wall_ns\": "    << v.wall_ns
+                  << ", \"cpu_ns\": "     << v.cpu_ns
+                  << ", \"iterations\": " << v.iterations
+                  << " }";
+            }
+
+            s << "\n  ]\n}\n";
+
+            return s.str();
+        }
+
+        // Prometheus text exposition format; the tag becomes the label "site".
+        static std::string ToPrometheus()
+        {
+            const std::vector<MetricSample> snapshot = Snapshot();
+
+            std::stringstream s;
+
+            auto family = [&]( const char * name, const char * help, auto get, const double scale = 1. )
+            {
+                s << "# HELP randomizor_" << name << " " << help << "\n";
+                s << "# TYPE randomizor_" << name << " counter\n";
+
+                for( const auto & m : snapshot )
+                {
+                    s << "randomizor_" << name << "{site=\"" << m.name << "\"} ";
+
+                    if( scale == 1. )
+                    {
+                        s << get( m.values );
+                    }
+                    else
+                    {
+                        s << static_cast<double>( get( m.values ) ) * scale;
+                    }
+
+                    s << "\n";
+                }
+            };
+
+            family( "calls_total",            "Number of calls.",
+                []( const MetricValues & v ) { return v.calls; } );
+            family( "samples_total",          "Number of samples produced.",
+                []( const MetricValues & v ) { return v.samples; } );
+            family( "bytes_total",            "Number of bytes written.",
+                []( const MetricValues & v ) { return v.bytes; } );
+            family( "wall_seconds_total",     "Wall-clock time.",
+                []( const MetricValues & v ) { return v.wall_ns; }, 1e-9 );
+            family( "cpu_seconds_total",      "CPU time of the calling thread.",
+                []( const MetricValues & v ) { return v.cpu_ns; }, 1e-9 );
+            family( "iterations_total",       "Extra iterations of rejection loops.",
+                []( const MetricValues & v ) { return v.iterations; } );
+
+            return s.str();
+        }
+
+        static std::uint64_t ThreadCPUTimeNanoseconds()
+        {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+            timespec t;
+
+            ::clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t );
+
+            return static_cast<std::uint64_t>(t.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(t.tv_nsec);
+#else
+            return 0;
+#endif
+        }
+
+    private:
+
+        static void Add( std::atomic<std::uint64_t> & c, const std::uint64_t x )
+        {
+            c.store( c.load( std::memory_order_relaxed ) + x, std::memory_order_relaxed );
+        }
+
+        struct Block
+        {
+            alignas(64) std::array<std::array<std::atomic<std::uint64_t>,field_count>,max_tag_count> counters {};
+
+            MetricValues Load( const std::size_t i ) const
+            {
+                const auto & c = counters[i];
+
+                return {
+                    c[0].load( std::memory_order_relaxed ), c[1].load( std::memory_order_relaxed ),
+                    c[2].load( std::memory_order_relaxed ), c[3].load( std::memory_order_relaxed ),
+                    c[4].load( std::memory_order_relaxed ), c[5].load( std::memory_order_relaxed )
+                };
+            }
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+
+            std::vector<std::string> names;
+
+            std::vector<Block *> blocks;
+
+            std::array<MetricValues,max_tag_count> retired {};
+        };
+
+        // Never destroyed, so that threads that exit late can still hand in their counts.
+        static Registry & GetRegistry()
+        {
+            static Registry * registry = new Registry();
+
+            return *registry;
+        }
+
+        // Registers the block of a thread on construction and folds it into the totals on exit.
+        struct LocalBlockOwner
+        {
+            Block block;
+
+            LocalBlockOwner()
+            {
+                Registry & r = GetRegistry();
+
+                std::lock_guard<std::mutex> lock ( r.mutex );
+
+                r.blocks.push_back( &block );
+            }
+
+            ~LocalBlockOwner()
+            {
+                Registry & r = GetRegistry();
+
+                std::lock_guard<std::mutex> lock ( r.mutex );
+
+                for( std::size_t i = 0; i < max_tag_count; ++i )
+                {
+                    r.retired[i] += block.Load( i );
+                }
+
+                std::erase( r.blocks, &block );
+            }
+        };
+
+        static Block & LocalBlock()
+        {
+            thread_local LocalBlockOwner owner;
+
+            return owner.block;
+        }
+    };
+
+    // Records one call of a site with its wall and CPU time on destruction.
+    class MetricScope
+    {
+    public:
+
+        MetricScope( const Metrics::Tag tag_, const std::uint64_t samples_, const std::uint64_t bytes_ )
+        :   tag        ( tag_ )
+        ,   samples    ( samples_ )
+        ,   bytes      ( bytes_ )
+        ,   wall_start ( std::chrono::steady_clock::now() )
+        ,   cpu_start  ( bytes >= Metrics::cpu_time_min_bytes ? Metrics::ThreadCPUTimeNanoseconds() : 0 )
+        {}
+
+        MetricScope( const MetricScope & ) = delete;
+        MetricScope & operator=( const MetricScope & ) = delete;
+
+        ~MetricScope()
+        {
+            MetricValues v;
+
+            v.calls   = 1;
+            v.samples = samples;
+            v.bytes   = bytes;
+            v.wall_ns = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - wall_start ).count()
+            );
+            v.cpu_ns  = bytes >= Metrics::cpu_time_min_bytes
+                      ? Metrics::ThreadCPUTimeNanoseconds() - cpu_start
+                      : v.wall_ns;
+
+            Metrics::Record( tag, v );
+        }
+
+    private:
+
+        const Metrics::Tag tag;
+
+        const std::uint64_t samples;
+        const std::uint64_t bytes;
+
+        const std::chrono::steady_clock::time_point wall_start;
+
+        const std::uint64_t cpu_start;
+    };
+}
+
+#define RANDOMIZOR_METRIC_CONCAT_( a, b ) a##b
+#define RANDOMIZOR_METRIC_CONCAT( a, b ) RANDOMIZOR_METRIC_CONCAT_( a, b )
+
+#if defined(RANDOMIZOR_METRICS)
+
+    #define RANDOMIZOR_METRIC_SCOPE( name, samples, bytes )                                         \
+        static const ::Randomizor::Metrics::Tag RANDOMIZOR_METRIC_CONCAT(randomizor_metric_tag_,__LINE__) \
+            = ::Randomizor::Metrics::Intern( name );                                                \
+        const ::Randomizor::MetricScope RANDOMIZOR_METRIC_CONCAT(randomizor_metric_scope_,__LINE__) ( \
+            RANDOMIZOR_METRIC_CONCAT(randomizor_metric_tag_,__LINE__),                              \
+            static_cast<std::uint64_t>(samples), static_cast<std::uint64_t>(bytes)                  \
+        )
+
+    #define RANDOMIZOR_METRIC_ITERATIONS( name, count )                                             \
+        do                                                                                          \
+        {                                                                                           \
+            static const ::Randomizor::Metrics::Tag randomizor_metric_tag = ::Randomizor::Metrics::Intern( name ); \
+            ::Randomizor::Metrics::AddIterations( randomizor_metric_tag, static_cast<std::uint64_t>(count) ); \
+        }                                                                                           \
+        while( false )
+
+#else
+
+    #define RANDOMIZOR_METRIC_SCOPE( name, samples, bytes )
+
+    #define RANDOMIZOR_METRIC_ITERATIONS( name, count ) do {} while( false )
+
+#endif
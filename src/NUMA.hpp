@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include <unistd.h>
+
+namespace Randomizor
+{
+    using namespace Tools;
+    
+    // Helpers for NUMA-aware placement of threads and memory.
+    //
+    // Linux places a page on the NUMA node of the thread that first writes to it. So memory that
+    // is allocated without touching it (e.g., in an Arena) and then first written by the threads
+    // that will later fill it ends up distributed over the sockets the same way as the work.
+    // On other systems, pinning is a no-op and there is one node.
+
+    // Parses a cpulist such as "0-15,32-47".
+    inline std::vector<int> ParseCPUList( const std::string & list )
+    {
+        std::vector<int> cpus;
+
+        std::size_t pos = 0;
+
+        while( pos < list.size() )
+        {
+            std::size_t end = list.find( ',', pos );
+
+            if( end == std::string::npos )
+            {
+                end = list.size();
+            }
+
+            const std::string item = list.substr( pos, end - pos );
+
+            const std::size_t dash = item.find( '-' );
+
+            try
+            {
+                if( dash == std::string::npos )
+                {
+                    if( !item.empty() && (item[0] != '\n') )
+                    {
+                        cpus.push_back( std::stoi(item) );
+                    }
+                }
+                else
+                {
+                    const int first = std::stoi( item.substr( 0, dash ) );
+                    const int last  = std::stoi( item.substr( dash + 1 ) );
+
+                    for( int cpu = first; cpu <= last; ++cpu )
+                    {
+                        cpus.push_back( cpu );
+                    }
+                }
+            }
+            catch( ... )
+            {
+                // Ignore malformed entries.
+            }
+
+            pos = end + 1;
+        }
+
+        return cpus;
+    }
+
+    // Returns the CPUs of each NUMA node.
+    inline std::vector<std::vector<int>> NUMANodeCPUs()
+    {
+        std::vector<std::vector<int>> nodes;
+
+#if defined(__linux__)
+        for( int node = 0; ; ++node )
+        {
+            std::ifstream file ( "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist" );
+
+            if( !file )
+            {
+                break;
+            }
+
+            std::string list;
+            std::getline( file, list );
+
+            std::vector<int> cpus = ParseCPUList( list );
+
+            if( !cpus.empty() )
+            {
+                nodes.push_back( std::move(cpus) );
+            }
+        }
+#endif
+
+        if( nodes.empty() )
+        {
+            const int n = std::max( 1, static_cast<int>(std::thread::hardware_concurrency()) );
+
+            nodes.emplace_back();
+
+            for( int cpu = 0; cpu < n; ++cpu )
+            {
+                nodes[0].push_back( cpu );
+            }
+        }
+
+        return nodes;
+    }
+
+    // Assigns CPUs to thread_count threads such that threads with neighbouring indices share a
+    // node: thread t goes to node floor(t * node_count / thread_count). Since the ThreadPool gives
+    // thread t the t-th contiguous slice of every job list, each node works on a contiguous part
+    // of the reservoir.
+    inline std::vector<int> SpreadCPUs( const std::size_t thread_count )
+    {
+        const std::vector<std::vector<int>> nodes = NUMANodeCPUs();
+
+        const std::size_t node_count = nodes.size();
+
+        std::vector<int> cpus ( thread_count );
+
+        for( std::size_t t = 0; t < thread_count; ++t )
+        {
+            const std::size_t node = (t * node_count) / thread_count;
+
+            // Index of this thread among the threads of its node.
+            const std::size_t first = (node * thread_count + node_count - 1) / node_count;
+
+            const std::vector<int> & node_cpus = nodes[node];
+
+            cpus[t] = node_cpus[(t - first) % node_cpus.size()];
+        }
+
+        return cpus;
+    }
+
+    // Pins the calling thread to cpu. Returns false if that is not possible or not supported.
+    inline bool PinThisThread( const int cpu )
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        CPU_SET( cpu, &set );
+
+        return pthread_setaffinity_np( pthread_self(), sizeof(cpu_set_t), &set ) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+    // Writes a zero to every page that starts in [begin,end), so that the calling thread becomes
+    // the first toucher of these pages. If neighbouring threads call this on adjacent ranges,
+    // every page is touched exactly once, namely by the thread whose range contains its start.
+    inline void FirstTouch( void * begin, void * end )
+    {
+        static const std::uintptr_t page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+
+        const std::uintptr_t b = reinterpret_cast<std::uintptr_t>(begin);
+        const std::uintptr_t e = reinterpret_cast<std::uintptr_t>(end);
+
+        for( std::uintptr_t p = ((b + page_size - 1) / page_size) * page_size; p < e; p += page_size )
+        {
+            *reinterpret_cast<volatile unsigned char *>(p) = 0;
+        }
+    }
+
+    // Pins the calling thread to cpu for the lifetime of this object and restores the previous
+    // affinity afterwards. Does nothing for cpu < 0.
+    class ScopedPin
+    {
+    public:
+
+        explicit ScopedPin( const int cpu )
+        {
+#if defined(__linux__)
+            if( cpu >= 0 )
+            {
+                active = (pthread_getaffinity_np( pthread_self(), sizeof(cpu_set_t), &previous ) == 0)
+                      && PinThisThread( cpu );
+            }
+#else
+            (void)cpu;
+#endif
+        }
+
+        ScopedPin( const ScopedPin & ) = delete;
+        ScopedPin & operator=( const ScopedPin & ) = delete;
+
+        ~ScopedPin()
+        {
+#if defined(__linux__)
+            if( active )
+            {
+                pthread_setaffinity_np( pthread_self(), sizeof(cpu_set_t), &previous );
+            }
+#endif
+        }
+
+    private:
+
+#if defined(__linux__)
+        cpu_set_t previous;
+#endif
+        bool active = false;
+    };
+}
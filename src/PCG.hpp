@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <limits>
+
+namespace Randomizor
+{
+    // PCG32 (PCG-XSH-RR 64/32)
+    // Output: 32 bits
+    // Period: 2^64 per stream, 2^63 streams
+    // Footprint: 16 bytes
+    // Original implementation: https://www.pcg-random.org/download.html (pcg32_random_r)
+    // The state layout { state, increment } is the one of the Metal PCG kernels, which use
+    // increment | 1 as the odd increment of the underlying LCG.
+    class PCG32
+    {
+    public:
+        
+        using UInt = std::uint64_t;
+        
+        using state_type  = std::array<UInt,2>;
+        using result_type = std::uint32_t;
+        
+        static constexpr UInt multiplier = 6364136223846793005ULL;
+        
+        explicit constexpr PCG32(const UInt seed) noexcept
+        :   state( SplitMix64{ seed }.generateSeedSequence<2>() )
+        {}
+        
+        explicit constexpr PCG32(const state_type state_) noexcept
+        :   state(state_)
+        {}
+        
+        constexpr result_type operator()() noexcept
+        {
+            const UInt oldstate = state[0];
+            // Advance internal state
+            state[0] = oldstate * multiplier + (state[1] | 1);
+            // Calculate output function (XSH RR), uses old state for max ILP
+            return Output( oldstate );
+        }
+        
+        static constexpr result_type Output( const UInt s ) noexcept
+        {
+            const std::uint32_t xorshifted = static_cast<std::uint32_t>(((s >> 18u) ^ s) >> 27u);
+            const std::uint32_t rot = static_cast<std::uint32_t>(s >> 59u);
+            return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+        }
+        
+        // Multiplier and increment of the LCG that performs delta steps at once
+        // (Brown, "Random number generation with arbitrary strides", 1994).
+        static constexpr std::array<UInt,2> Stride( UInt delta, const UInt increment ) noexcept
+        {
+            UInt cur_mult = multiplier;
+            UInt cur_plus = increment | 1;
+            UInt acc_mult = 1;
+            UInt acc_plus = 0;
+            
+            while( delta > 0 )
+            {
+                if( delta & 1 )
+                {
+                    acc_mult *= cur_mult;
+                    acc_plus = acc_plus * cur_mult + cur_plus;
+                }
+                cur_plus = (cur_mult + 1) * cur_plus;
+                cur_mult *= cur_mult;
+                delta /= 2;
+            }
+            
+            return { acc_mult, acc_plus };
+        }
+        
+        // Equivalent to delta calls to operator(), in O(log delta) time.
+        constexpr void Advance( const UInt delta ) noexcept
+        {
+            const std::array<UInt,2> s = Stride( delta, state[1] );
+            
+            state[0] = s[0] * state[0] + s[1];
+        }
+        
+        static constexpr result_type min() noexcept
+        {
+            return std::numeric_limits<result_type>::lowest();
+        }
+        
+        static constexpr result_type max() noexcept
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+        
+        constexpr state_type State() const noexcept
+        {
+            return state;
+        }
+        
+        constexpr void SetState(const state_type state_) noexcept
+        {
+            state = state_;
+        }
+        
+        friend bool operator ==(const PCG32& lhs, const PCG32& rhs) noexcept
+        {
+            return (lhs.state == rhs.state);
+        }
+        
+        friend bool operator !=(const PCG32& lhs, const PCG32& rhs) noexcept
+        {
+            return (lhs.state != rhs.state);
+        }
+        
+    private:
+        
+        state_type state;
+    };
+    
+}
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace Randomizor
+{
+    // Serves many concurrent small requests from few large batches.
+    //
+    // Client threads push their requests into a lock-free multi-producer single-consumer queue.
+    // A single service thread collects them until either batch_size samples are pending or the
+    // oldest request has waited for max_delay. It then generates all samples of one distribution
+    // with a single bulk call of the generator (a parallel CPU fill or a single Metal dispatch)
+    // and copies them to the requesting threads.
+    //
+    // Generator_T must provide Fill_Uniform( float *, size_t ) and Fill_Normal( float *, size_t ),
+    // e.g., Randomizor_CPU or one of the Metal samplers. Only the service thread calls them.
+    // Set the generator's InlineThreshold() to 0 so that every batch takes the bulk path.
+    //
+    // The destructor serves all requests that were submitted before it started, without waiting
+    // for max_delay, and returns once no thread is waiting in Fill_Uniform or Fill_Normal anymore.
+    // Submitting requests while or after the service is destroyed is an error.
+    template<typename Generator_T>
+    class RandomService
+    {
+    public:
+
+        enum class Distribution : int
+        {
+            Uniform = 0,
+            Normal  = 1
+        };
+
+        explicit RandomService(
+            Generator_T & generator_,
+            const size_t batch_size_ = size_t(1) << 20,
+            const std::chrono::microseconds max_delay_ = std::chrono::microseconds(100)
+        )
+        :   generator  ( generator_  )
+        ,   batch_size ( batch_size_ )
+        ,   max_delay  ( max_delay_  )
+        {
+            worker = std::thread( [this](){ Serve(); } );
+        }
+
+        ~RandomService()
+        {
+            // The extra count wakes the service thread and keeps it from sleeping while it drains.
+            stop.store( true, std::memory_order_release );
+            pending_count.fetch_add( 1, std::memory_order_release );
+            pending_count.notify_one();
+
+            worker.join();
+
+            // Waiters that were woken last may still be on their way out of Wait.
+            while( waiting_count.load( std::memory_order_acquire ) > 0 )
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        RandomService( const RandomService & ) = delete;
+        RandomService & operator=( const RandomService & ) = delete;
+
+        // Fills a[0],...,a[n-1] and returns when done.
+        void Fill_Uniform( float * a, const size_t n )
+        {
+            Request r ( a, n, Distribution::Uniform );
+            waiting_count.fetch_add( 1, std::memory_order_relaxed );
+            Submit( &r );
+            Wait( r );
+        }
+
+        // Fills a[0],...,a[n-1] and returns when done.
+        void Fill_Normal( float * a, const size_t n )
+        {
+            Request r ( a, n, Distribution::Normal );
+            waiting_count.fetch_add( 1, std::memory_order_relaxed );
+            Submit( &r );
+            Wait( r );
+        }
+
+        // Returns immediately; the future becomes ready once a[0],...,a[n-1] are filled.
+        // a must stay valid until then.
+        std::future<void> Fill_Uniform_Async( float * a, const size_t n )
+        {
+            return SubmitAsync( a, n, Distribution::Uniform );
+        }
+
+        // Returns immediately; the future becomes ready once a[0],...,a[n-1] are filled.
+        // a must stay valid until then.
+        std::future<void> Fill_Normal_Async( float * a, const size_t n )
+        {
+            return SubmitAsync( a, n, Distribution::Normal );
+        }
+
+        // Number of batches generated so far.
+        size_t BatchCount() const
+        {
+            return batch_count.load( std::memory_order_relaxed );
+        }
+
+        // Number of requests served so far.
+        size_t RequestCount() const
+        {
+            return request_count.load( std::memory_order_relaxed );
+        }
+
+    private:
+
+        struct Node
+        {
+            std::atomic<Node *> next { nullptr };
+        };
+
+        struct Request : public Node
+        {
+            float * a;
+            size_t  n;
+            Distribution distribution;
+
+            // Only set for asynchronous requests; then the service thread deletes the request.
+            std::promise<void> * promise = nullptr;
+
+            std::atomic<bool> done { false };
+
+            Request( float * a_, const size_t n_, const Distribution distribution_ )
+            :   a            ( a_            )
+            ,   n            ( n_            )
+            ,   distribution ( distribution_ )
+            {}
+        };
+
+        // Dmitry Vyukov's intrusive MPSC queue: producers swap themselves into head;
+        // the single consumer walks from tail.
+        void Push( Node * node )
+        {
+            node->next.store( nullptr, std::memory_order_relaxed );
+
+            Node * prev = head.exchange( node, std::memory_order_acq_rel );
+
+            prev->next.store( node, std::memory_order_release );
+        }
+
+        // Returns nullptr if the queue is empty or if a producer is in the middle of a Push.
+        Node * Pop()
+        {
+            Node * t    = tail;
+            Node * next = t->next.load( std::memory_order_acquire );
+
+            if( t == &stub )
+            {
+                if( next == nullptr )
+                {
+                    return nullptr;
+                }
+
+                tail = next;
+                t    = next;
+                next = next->next.load( std::memory_order_acquire );
+            }
+
+            if( next != nullptr )
+            {
+                tail = next;
+                return t;
+            }
+
+            if( t != head.load( std::memory_order_acquire ) )
+            {
+                return nullptr;
+            }
+
+            Push( &stub );
+
+            next = t->next.load( std::memory_order_acquire );
+
+            if( next != nullptr )
+            {
+                tail = next;
+                return t;
+            }
+
+            return nullptr;
+        }
+
+        void Submit( Request * r )
+        {
+            Push( r );
+
+            pending_samples.fetch_add( r->n, std::memory_order_relaxed );
+
+            if( pending_count.fetch_add( 1, std::memory_order_release ) == 0 )
+            {
+                pending_count.notify_one();
+            }
+        }
+
+        // The service thread must not touch r after setting r.done, because r lives on the stack of
+        // the requesting thread. So the notification goes through served_generation instead.
+        // The last access to the service is the decrement of waiting_count, for which the
+        // destructor waits.
+        void Wait( const Request & r )
+        {
+            std::uint64_t g = served_generation.load( std::memory_order_acquire );
+
+            while( !r.done.load( std::memory_order_acquire ) )
+            {
+                served_generation.wait( g, std::memory_order_acquire );
+
+                g = served_generation.load( std::memory_order_acquire );
+            }
+
+            waiting_count.fetch_sub( 1, std::memory_order_release );
+        }
+
+        std::future<void> SubmitAsync( float * a, const size_t n, const Distribution distribution )
+        {
+            Request * r = new Request( a, n, distribution );
+
+            r->promise = new std::promise<void>();
+
+            std::future<void> f = r->promise->get_future();
+
+            Submit( r );
+
+            return f;
+        }
+
+        void Serve()
+        {
+            using Clock = std::chrono::steady_clock;
+
+            std::vector<Request *> requests;
+
+            while( true )
+            {
+                pending_count.wait( 0, std::memory_order_acquire );
+
+                // When stopping, the destructor's count is the only one left once all requests
+                // are served.
+                if(
+                    stop.load( std::memory_order_acquire )
+                    &&
+                    (pending_count.load( std::memory_order_acquire ) == 1)
+                )
+                {
+                    break;
+                }
+
+                // Bounded latency: wait for more requests only until the deadline.
+                const auto deadline = Clock::now() + max_delay;
+
+                while(
+                    (pending_samples.load( std::memory_order_relaxed ) < batch_size)
+                    &&
+                    (Clock::now() < deadline)
+                    &&
+                    !stop.load( std::memory_order_relaxed )
+                )
+                {
+                    std::this_thread::yield();
+                }
+
+                requests.clear();
+
+                while( Node * node = Pop() )
+                {
+                    requests.push_back( static_cast<Request *>(node) );
+                }
+
+                if( requests.empty() )
+                {
+                    // A producer is still in the middle of Push; try again.
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                size_t served_samples = 0;
+
+                for( Request * r : requests )
+                {
+                    served_samples += r->n;
+                }
+
+                Generate( requests, Distribution::Uniform );
+                Generate( requests, Distribution::Normal  );
+
+                pending_samples.fetch_sub( served_samples, std::memory_order_relaxed );
+                pending_count.fetch_sub( requests.size(), std::memory_order_acq_rel );
+
+                request_count.fetch_add( requests.size(), std::memory_order_relaxed );
+
+                for( Request * r : requests )
+                {
+                    if( r->promise != nullptr )
+                    {
+                        r->promise->set_value();
+                        delete r->promise;
+                        delete r;
+                    }
+                    else
+                    {
+                        r->done.store( true, std::memory_order_release );
+                    }
+                }
+
+                served_generation.fetch_add( 1, std::memory_order_release );
+                served_generation.notify_all();
+            }
+        }
+
+        void Generate( const std::vector<Request *> & requests, const Distribution distribution )
+        {
+            size_t total = 0;
+
+            for( const Request * r : requests )
+            {
+                total += (r->distribution == distribution) ? r->n : size_t(0);
+            }
+
+            if( total == 0 )
+            {
+                return;
+            }
+
+            // Grows geometrically, so that the steady state does not allocate.
+            if( batch.size() < total )
+            {
+                batch.resize( std::max( total, 2 * batch.size() ) );
+            }
+
+            if( distribution == Distribution::Uniform )
+            {
+                generator.Fill_Uniform( batch.data(), total );
+            }
+            else
+            {
+                generator.Fill_Normal( batch.data(), total );
+            }
+
+            batch_count.fetch_add( 1, std::memory_order_relaxed );
+
+            const float * restrict b = batch.data();
+
+            for( Request * r : requests )
+            {
+                if( r->distribution == distribution )
+                {
+                    std::copy( b, b + r->n, r->a );
+
+                    b += r->n;
+                }
+            }
+        }
+
+    private:
+
+        Generator_T & generator;
+
+        const size_t batch_size;
+
+        const std::chrono::microseconds max_delay;
+
+        Node stub;
+
+        alignas(64) std::atomic<Node *> head { &stub };
+
+        alignas(64) Node * tail = &stub;
+
+        alignas(64) std::atomic<size_t> pending_count   { 0 };
+
+        std::atomic<size_t> pending_samples { 0 };
+
+        std::atomic<bool> stop { false };
+
+        // Number of threads in Fill_Uniform or Fill_Normal.
+        std::atomic<size_t> waiting_count { 0 };
+
+        alignas(64) std::atomic<std::uint64_t> served_generation { 0 };
+
+        std::atomic<size_t> batch_count   { 0 };
+
+        std::atomic<size_t> request_count { 0 };
+
+        std::vector<float> batch;
+
+        std::thread worker;
+    };
+}
@@ -6,6 +6,13 @@
 
 #include "../Tools/Tools.hpp"
 #include "Helpers.hpp"
+#include "SplitMix64.hpp"
+#include "Xoshiro.hpp"
+#include "PCG.hpp"
+#include "Lanes.hpp"
+#include "Kernels_Metal.hpp"
+#include "Checkpoint.hpp"
+#include "Metrics.hpp"
 
 //TODO: Offline compilation https://developer.apple.com/videos/play/wwdc2022/10102/?time=168
 
@@ -70,6 +77,12 @@ namespace Randomizor
         
         NS::SharedPtr<MTL::Buffer> states;
         
+        // Backs states after a no-copy Load.
+        MappedFile state_file;
+        
+        // Requests up to this size are cheaper to serve on the CPU than to submit a command buffer.
+        size_t inline_threshold = 8192;
+        
     protected:
         
         void LoadPipeline(
@@ -276,19 +289,14 @@ namespace Randomizor
         {
             std::string fun_fullname = FullPipelineName(fun_name,param_vals);
             
-            std::string tag = ClassName()+"::GetPipeline(" + fun_fullname + ")";
-            
-            ptic(tag);
-            
+            // This runs on every fill, so the tag is only built for the error message.
             if( pipelines.count(fun_fullname) == 0 )
             {
-                eprint(tag+": Pipeline not found.");
-                ptoc(tag);
+                eprint(ClassName()+"::GetPipeline(" + fun_fullname + "): Pipeline not found.");
                 std::exit(-1);
             }
             else
             {
-                ptoc(tag);
                 return pipelines[fun_fullname];
             }
         }
@@ -305,6 +313,11 @@ namespace Randomizor
         
         virtual void Fill_Normal() = 0;
         
+        // Runs the kernel of the subclass on the CPU; see RandomizeArray_CPU.
+        virtual void Fill_Uniform_CPU( float * a, const size_t n ) = 0;
+        
+        virtual void Fill_Normal_CPU( float * a, const size_t n ) = 0;
+        
     public:
         
         size_t ReservoirSize( const size_t n )
@@ -326,11 +339,20 @@ namespace Randomizor
             return reservoir_size;
         }
         
+        // Reuses the current buffer if it is large enough; otherwise grows it by at least a factor
+        // of 1.5, so that a sequence of growing requests causes only logarithmically many allocations.
         void RequireReservoir( const size_t n )
         {
-            reservoir = NS::TransferPtr(
-                device->newBuffer(ReservoirSize(n) * sizeof(float), Managed)
-            );
+            const size_t bytes = ReservoirSize(n) * sizeof(float);
+            
+            if( (reservoir.get() == nullptr) || (reservoir->length() < bytes) )
+            {
+                const size_t old_bytes = (reservoir.get() == nullptr) ? 0 : reservoir->length();
+                
+                reservoir = NS::TransferPtr(
+                    device->newBuffer( std::max( bytes, old_bytes + old_bytes / 2 ), Managed )
+                );
+            }
         }
         
         void LoadReservoir( float * external_reservoir, const size_t external_size )
@@ -374,7 +396,204 @@ namespace Randomizor
             }
         }
         
+        // Number of GPU threads that a fill dispatches: threads_per_device rounded down to whole
+        // threadgroups.
+        size_t ThreadsPerGrid() const
+        {
+            return static_cast<size_t>(threads_per_device / threads_per_threadgroup) * static_cast<size_t>(threads_per_threadgroup);
+        }
+        
+        size_t InlineThreshold() const
+        {
+            return inline_threshold;
+        }
+        
+        void SetInlineThreshold( const size_t n )
+        {
+            inline_threshold = n;
+        }
+        
+        // Fills a[0],...,a[n-1]: the samples are generated in the reservoir (which grows if
+        // necessary) and copied to a. Every request goes through the GPU states, so it is
+        // reproducible from Seed and Load and continues the sequence that Save records.
+        //
+        // Requests of at most InlineThreshold() samples do not submit a command buffer. The calling
+        // thread runs the kernel on the states buffer instead, as the GPU threads would for a
+        // reservoir (see RandomizeChunks_CPU in Kernels_Metal.hpp): the samples are the first n
+        // of a GPU fill, up to the rounding of log, sqrt and sincos in normal samples. Only the
+        // GPU threads that compute one of them advance, so the sequences after a small request
+        // depend on the threshold; they stay reproducible from Seed and Load for a fixed one.
+        void Fill_Uniform( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal::Fill_Uniform", n, n * sizeof(float) );
+            
+            if( n <= inline_threshold )
+            {
+                this->Fill_Uniform_CPU( a, n );
+            }
+            else
+            {
+                RequireReservoir(n);
+                this->Fill_Uniform();
+                std::memcpy( a, Reservoir(), n * sizeof(float) );
+            }
+        }
+        
+        void Fill_Normal( float * a, const size_t n )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal::Fill_Normal", n, n * sizeof(float) );
+            
+            if( n <= inline_threshold )
+            {
+                this->Fill_Normal_CPU( a, n );
+            }
+            else
+            {
+                RequireReservoir(n);
+                this->Fill_Normal();
+                std::memcpy( a, Reservoir(), n * sizeof(float) );
+            }
+        }
+        
+        // Measures for which request sizes the calling thread is faster than a command buffer and
+        // sets InlineThreshold() accordingly. This advances the states; call it once at startup,
+        // before seeding and issuing requests.
+        void TuneInlineThreshold( const size_t max_n = size_t(1) << 20, const size_t repetitions = 16 )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal::TuneInlineThreshold", 0, 0 );
+            
+            using Clock = std::chrono::steady_clock;
+            
+            std::vector<float> a ( max_n );
+            
+            RequirePipeline();
+            
+            size_t threshold = 0;
+            
+            for( size_t n = 16; n <= max_n; n *= 2 )
+            {
+                std::vector<double> t_CPU ( repetitions );
+                std::vector<double> t_GPU ( repetitions );
+                
+                for( size_t rep = 0; rep < repetitions; ++rep )
+                {
+                    inline_threshold = n;
+                    
+                    auto start = Clock::now();
+                    Fill_Normal( a.data(), n );
+                    t_CPU[rep] = std::chrono::duration<double>(Clock::now() - start).count();
+                    
+                    inline_threshold = 0;
+                    
+                    start = Clock::now();
+                    Fill_Normal( a.data(), n );
+                    t_GPU[rep] = std::chrono::duration<double>(Clock::now() - start).count();
+                }
+                
+                std::sort( t_CPU.begin(), t_CPU.end() );
+                std::sort( t_GPU.begin(), t_GPU.end() );
+                
+                // Compare medians.
+                if( t_CPU[repetitions/2] <= t_GPU[repetitions/2] )
+                {
+                    threshold = n;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            
+            inline_threshold = threshold;
+        }
+        
+        // Writes the per-thread states to a checkpoint file (see Checkpoint.hpp).
+        bool Save( const std::string & path )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal::Save", 0, threads_per_device * StateSize() );
+            
+            RequireSeed();
+            
+            const bool success = SaveCheckpoint(
+                path, ClassName(),
+                threads_per_device, states->length() / threads_per_device,
+                states->contents()
+            );
+            
+            return success;
+        }
+        
+        // Restores the per-thread states from a checkpoint written by Save.
+        // If the state array fills whole pages, the GPU works directly on the mapped file
+        // (copy-on-write); otherwise the states are copied once into a new buffer.
+        bool Load( const std::string & path, const bool verify = true )
+        {
+            RANDOMIZOR_METRIC_SCOPE( "Randomizor_Metal::Load", 0, threads_per_device * StateSize() );
+            
+            const size_t state_size = StateSize();
+            
+            MappedFile file;
+            
+            unsigned char * payload = LoadCheckpoint( file, path, ClassName(), threads_per_device, state_size, verify );
+            
+            if( payload != nullptr )
+            {
+                const size_t length    = threads_per_device * state_size;
+                const size_t page_size = static_cast<size_t>(::getpagesize());
+                
+                if( (length % page_size == 0) && (reinterpret_cast<std::uintptr_t>(payload) % page_size == 0) )
+                {
+                    states = NS::TransferPtr(
+                        device->newBuffer( payload, length, Managed, nullptr )
+                    );
+                    
+                    state_file = std::move(file);
+                }
+                else
+                {
+                    states = NS::TransferPtr(
+                        device->newBuffer( payload, length, Managed )
+                    );
+                    
+                    state_file.Close();
+                }
+            }
+            
+            return payload != nullptr;
+        }
+        
+    protected:
+        
+        // Number of bytes of state per GPU thread.
+        virtual size_t StateSize() const
+        {
+            return 4 * sizeof(uint64_t);
+        }
+        
     protected:
+        
+        // Serves a small request on the CPU with the kernel description Kernel of Kernels_Metal.hpp.
+        // The states buffer is managed, so the GPU sees the new states only after didModifyRange.
+        template<typename Kernel, bool normal>
+        void RandomizeArray_CPU( float * a, const size_t n )
+        {
+            RequireSeed();
+            
+            const size_t T = ThreadsPerGrid();
+            
+            if( (n == 0) || (T == 0) )
+            {
+                return;
+            }
+            
+            RandomizeChunks_CPU<Kernel,normal>(
+                reinterpret_cast<uint64_t *>(states->contents()), T, a, n
+            );
+            
+            const size_t used_thread_count = std::min( (n + sample_chunk_size - 1) / sample_chunk_size, T );
+            
+            states->didModifyRange( { 0, std::min( used_thread_count * StateSize(), static_cast<size_t>(states->length()) ) } );
+        }
 
         void RandomizeReservoir( const std::string & name )
         {
@@ -383,7 +602,7 @@ namespace Randomizor
             
             RequireSeed();
             
-            const size_t n = reservoir->length() / sizeof(float);
+            const size_t n = (reservoir.get() == nullptr) ? 0 : reservoir_size;
             
             if( n <= 0 )
             {
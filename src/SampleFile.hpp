@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // On-disk sample files, written in place through memory maps.
+    //
+    // A file is either raw (just the samples) or a NumPy .npy file (chosen by the extension).
+    // The .npy header is padded to sample_file_header_size bytes, so the samples start page-aligned
+    // and every block of sample_file_block_size samples occupies whole pages. Block b is always
+    // generated by substream b of the keyed stream "Randomizor::FillFile" of a StreamPartition, so
+    // the file depends only on seed, count, distribution and dtype, not on the number of threads.
+
+    enum class Distribution
+    {
+        Uniform,
+        Normal
+    };
+
+    enum class DType
+    {
+        Float32,
+        Float64
+    };
+
+    static constexpr std::size_t sample_file_header_size = 16384;
+
+    // Samples per block. A multiple of the page size in either dtype.
+    static constexpr std::size_t sample_file_block_size = std::size_t(1) << 20;
+
+    // Blocks that are mapped at once. Memory use is bounded by this, not by the file size.
+    static constexpr std::size_t sample_file_window_blocks = 64;
+
+    inline std::size_t DTypeSize( const DType dtype )
+    {
+        return (dtype == DType::Float64) ? sizeof(double) : sizeof(float);
+    }
+
+    inline bool IsNpyPath( const std::string & path )
+    {
+        return (path.size() >= 4) && (path.compare( path.size() - 4, 4, ".npy" ) == 0);
+    }
+
+    // Returns a .npy (version 1.0) header of exactly sample_file_header_size bytes for a
+    // one-dimensional array of count elements.
+    inline std::string NpyHeader( const DType dtype, const std::size_t count )
+    {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        const char byte_order = '>';
+#else
+        const char byte_order = '<';
+#endif
+        std::string dict = std::string("{'descr': '") + byte_order
+                         + ((dtype == DType::Float64) ? "f8" : "f4")
+                         + "', 'fortran_order': False, 'shape': (" + std::to_string(count) + ",), }";
+
+        // Magic string (6), version (2), header length (2).
+        constexpr std::size_t preamble_size = 10;
+
+        const std::size_t header_length = sample_file_header_size - preamble_size;
+
+        dict.resize( header_length - 1, ' ' );
+        dict.push_back( '\n' );
+
+        std::string header = "\x93NUMPY";
+        header.push_back( char(1) );
+        header.push_back( char(0) );
+        header.push_back( static_cast<char>( header_length & 0xff ) );
+        header.push_back( static_cast<char>( header_length >> 8 ) );
+
+        return header + dict;
+    }
+
+    // A file of fixed size that is written through a sequence of shared memory maps.
+    class SampleFile
+    {
+    public:
+
+        SampleFile() = default;
+
+        SampleFile( const SampleFile & ) = delete;
+        SampleFile & operator=( const SampleFile & ) = delete;
+
+        ~SampleFile()
+        {
+            Close();
+        }
+
+        // Creates (or truncates) path with size bytes. The file is sparse until written.
+        bool Create( const std::string & path, const std::size_t size )
+        {
+            Close();
+
+            fd = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+
+            if( fd < 0 )
+            {
+                eprint("SampleFile::Create: Could not open file "+path+" for writing.");
+                return false;
+            }
+
+            if( ::ftruncate( fd, static_cast<off_t>(size) ) != 0 )
+            {
+                eprint("SampleFile::Create: Could not resize file "+path+" to "+ToString(size)+" bytes.");
+                Close();
+                return false;
+            }
+
+            return true;
+        }
+
+        // Maps bytes [offset, offset + size) for writing. offset must be page-aligned.
+        unsigned char * Map( const std::size_t offset, const std::size_t size )
+        {
+            void * p = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset) );
+
+            if( p == MAP_FAILED )
+            {
+                eprint("SampleFile::Map: Could not map "+ToString(size)+" bytes at offset "+ToString(offset)+".");
+                return nullptr;
+            }
+
+#if defined(MADV_SEQUENTIAL)
+            ::madvise( p, size, MADV_SEQUENTIAL );
+#endif
+            return static_cast<unsigned char *>(p);
+        }
+
+        // Starts the write-back of a window and unmaps it, so that its pages can be reclaimed.
+        void Unmap( unsigned char * p, const std::size_t size )
+        {
+            ::msync( p, size, MS_ASYNC );
+            ::munmap( p, size );
+        }
+
+        bool Close()
+        {
+            bool success = true;
+
+            if( fd >= 0 )
+            {
+                success = (::close( fd ) == 0);
+                fd = -1;
+            }
+
+            return success;
+        }
+
+    private:
+
+        int fd = -1;
+    };
+}
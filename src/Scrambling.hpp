@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Randomizor
+{
+    // Randomizations of the quasi-random sequences (see Sobol.hpp and Halton.hpp). Each of them
+    // keeps the low discrepancy of the point set and makes every single point uniformly distributed,
+    // so that independent scramblings (different seeds) give unbiased estimators with error bars.
+    //
+    //     None         : the plain deterministic sequence.
+    //     DigitalShift : adds one random digit per dimension and digit position, modulo the base
+    //                    (XOR with a random word for Sobol).
+    //     Owen         : nested uniform scrambling for Sobol, by the hash-based permutation of
+    //                    Laine and Karras as refined by Burley (2020); for Halton, one random
+    //                    permutation per dimension and digit position.
+    enum class Scrambling
+    {
+        None,
+        DigitalShift,
+        Owen
+    };
+
+    force_inline constexpr std::uint32_t ReverseBits( std::uint32_t x ) noexcept
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+
+        return (x >> 16) | (x << 16);
+    }
+
+    // Every bit is flipped depending only on the higher bits (in the reversed order: the lower ones),
+    // which is exactly what a nested uniform scrambling does.
+    force_inline constexpr std::uint32_t LaineKarrasPermutation( std::uint32_t x, const std::uint32_t seed ) noexcept
+    {
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+
+        return x;
+    }
+
+    // Owen scrambling of a 32-bit fixed-point coordinate x / 2^32.
+    force_inline constexpr std::uint32_t NestedUniformScramble( const std::uint32_t x, const std::uint32_t seed ) noexcept
+    {
+        return ReverseBits( LaineKarrasPermutation( ReverseBits( x ), seed ) );
+    }
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SobolDirectionNumbers.hpp"
+#include "Scrambling.hpp"
+#include "InverseNormalCDF.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // The Sobol sequence in up to sobol_max_dimension dimensions with 32-bit resolution, i.e., for
+    // up to 2^32 points.
+    //
+    // Points are enumerated in Gray-code order (Antonov and Saleev): point i + 1 differs from point
+    // i by a single XOR with the direction numbers of bit ctz(i + 1) in every dimension. Any point
+    // can be computed directly in O(log i) steps, so a range of points splits into blocks that are
+    // filled in parallel, with results that do not depend on the split.
+    //
+    // Point i is written to a[dimension * i + j], j = 0,...,dimension-1.
+    class Sobol
+    {
+    public:
+
+        using UInt = std::uint32_t;
+
+        static constexpr std::size_t bit_count = 32;
+
+        static constexpr std::uint64_t max_point_count = std::uint64_t(1) << bit_count;
+
+        explicit Sobol(
+            const std::size_t   dimension_,
+            const Scrambling    scrambling_ = Scrambling::None,
+            const std::uint64_t seed        = 0
+        )
+        :   dimension  ( std::min( std::max( dimension_, std::size_t(1) ), sobol_max_dimension ) )
+        ,   scrambling ( scrambling_ )
+        ,   directions ( bit_count * dimension )
+        ,   keys       ( dimension, 0 )
+        {
+            if( dimension_ > sobol_max_dimension )
+            {
+                eprint(ClassName()+": Requested dimension "+ToString(dimension_)+" exceeds the maximum "+ToString(sobol_max_dimension)+".");
+            }
+
+            ComputeDirections();
+
+            SplitMix64 key_engine ( seed );
+
+            for( std::size_t j = 0; j < dimension; ++j )
+            {
+                keys[j] = static_cast<UInt>( key_engine() >> 32 );
+            }
+        }
+
+        std::size_t Dimension() const
+        {
+            return dimension;
+        }
+
+        // Writes the point_count points with indices begin, begin + 1, ... to a, as floats in [0,1).
+        void Fill_Uniform( const std::uint64_t begin, const std::size_t point_count, float * restrict a ) const
+        {
+            Fill( begin, point_count, a,
+                []( const UInt x )
+                {
+                    return FloatFrom32Bits( x );
+                }
+            );
+        }
+
+        // Same as Fill_Uniform, but mapped to standard normal floats by the inverse CDF. The
+        // coordinate x / 2^32 is shifted to the midpoint of its cell first, so it never is 0.
+        void Fill_Normal( const std::uint64_t begin, const std::size_t point_count, float * restrict a ) const
+        {
+            Fill( begin, point_count, a,
+                []( const UInt x )
+                {
+                    return static_cast<float>( InverseNormalCDF( (static_cast<double>(x) + 0.5) * 0x1.0p-32 ) );
+                }
+            );
+        }
+
+        static std::string ClassName()
+        {
+            return "Sobol";
+        }
+
+    private:
+
+        // Joe and Kuo's recurrence for the direction numbers v_k = m_k / 2^k, stored as 32-bit
+        // fixed-point numbers. directions[dimension * k + j] is v_k of dimension j, so that one Gray
+        // code step is a contiguous XOR over all dimensions.
+        void ComputeDirections()
+        {
+            for( std::size_t k = 0; k < bit_count; ++k )
+            {
+                directions[k * dimension] = UInt(1) << (bit_count - 1 - k);
+            }
+
+            for( std::size_t j = 1; j < dimension; ++j )
+            {
+                const std::uint16_t * row = sobol_direction_numbers[j-1];
+
+                const std::size_t s = row[0];
+                const std::size_t a = row[1];
+
+                std::vector<UInt> v ( bit_count );
+
+                for( std::size_t k = 0; k < s; ++k )
+                {
+                    v[k] = static_cast<UInt>(row[2 + k]) << (bit_count - 1 - k);
+                }
+
+                for( std::size_t k = s; k < bit_count; ++k )
+                {
+                    v[k] = v[k-s] ^ (v[k-s] >> s);
+
+                    for( std::size_t l = 1; l < s; ++l )
+                    {
+                        if( (a >> (s - 1 - l)) & std::size_t(1) )
+                        {
+                            v[k] ^= v[k-l];
+                        }
+                    }
+                }
+
+                for( std::size_t k = 0; k < bit_count; ++k )
+                {
+                    directions[k * dimension + j] = v[k];
+                }
+            }
+        }
+
+        // Skip to index: point i is the XOR of the direction numbers of the set bits of gray(i).
+        void Point( const std::uint64_t i, UInt * restrict x ) const
+        {
+            const std::uint64_t gray = i ^ (i >> 1);
+
+            for( std::size_t j = 0; j < dimension; ++j )
+            {
+                x[j] = 0;
+            }
+
+            for( std::size_t k = 0; k < bit_count; ++k )
+            {
+                if( (gray >> k) & std::uint64_t(1) )
+                {
+                    const UInt * restrict v = &directions[k * dimension];
+
+                    for( std::size_t j = 0; j < dimension; ++j )
+                    {
+                        x[j] ^= v[j];
+                    }
+                }
+            }
+        }
+
+        template<typename F>
+        void Fill( const std::uint64_t begin, const std::size_t point_count, float * restrict a, F && f ) const
+        {
+            if( begin + point_count > max_point_count )
+            {
+                eprint(ClassName()+"::Fill: Points beyond index 2^32 are not available.");
+                return;
+            }
+
+            if( point_count == 0 )
+            {
+                return;
+            }
+
+            const std::size_t d = dimension;
+
+            std::vector<UInt> x ( d );
+
+            Point( begin, x.data() );
+
+            for( std::size_t p = 0; p < point_count; ++p )
+            {
+                float * restrict y = &a[d * p];
+
+                switch( scrambling )
+                {
+                    case Scrambling::DigitalShift:
+                    {
+                        for( std::size_t j = 0; j < d; ++j )
+                        {
+                            y[j] = f( x[j] ^ keys[j] );
+                        }
+                        break;
+                    }
+                    case Scrambling::Owen:
+                    {
+                        for( std::size_t j = 0; j < d; ++j )
+                        {
+                            y[j] = f( NestedUniformScramble( x[j], keys[j] ) );
+                        }
+                        break;
+                    }
+                    default:
+                    {
+                        for( std::size_t j = 0; j < d; ++j )
+                        {
+                            y[j] = f( x[j] );
+                        }
+                        break;
+                    }
+                }
+
+                // Gray code step to the next point (not needed after the last one, whose successor
+                // might not exist).
+                const std::uint64_t next = begin + p + 1;
+
+                if( next < max_point_count )
+                {
+                    const UInt * restrict v = &directions[d * static_cast<std::size_t>(std::countr_zero( next ))];
+
+                    for( std::size_t j = 0; j < d; ++j )
+                    {
+                        x[j] ^= v[j];
+                    }
+                }
+            }
+        }
+
+    private:
+
+        const std::size_t dimension;
+
+        const Scrambling scrambling;
+
+        std::vector<UInt> directions;
+
+        std::vector<UInt> keys;
+    };
+}
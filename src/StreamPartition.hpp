@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "JumpAhead.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // Hashes a string key to a 64-bit stream id by feeding it through SplitMix64 in 8-byte words.
+    // The result does not depend on the platform's endianness.
+    inline std::uint64_t StreamId( std::string_view key )
+    {
+        std::uint64_t h = SplitMix64{ static_cast<std::uint64_t>(key.size()) }();
+
+        std::size_t i = 0;
+
+        while( i < key.size() )
+        {
+            std::uint64_t word = 0;
+
+            for( std::size_t b = 0; (b < 8) && (i < key.size()); ++b, ++i )
+            {
+                word |= static_cast<std::uint64_t>(static_cast<unsigned char>(key[i])) << (8 * b);
+            }
+
+            h = SplitMix64{ h ^ word }();
+        }
+
+        return h;
+    }
+
+    // Deterministic, hierarchical partition of the period of a xoshiro engine into streams.
+    //
+    // The stream with address (rank, thread, substream) starts
+    //
+    //     rank * 2^192 + thread * 2^128 + substream * 2^64
+    //
+    // steps after the state derived from the global seed. So a rank owns the same 2^192 steps
+    // that LongJump() skips, a thread owns 2^128 steps like Jump(), and each substream has 2^64 steps.
+    // For engines with 128 state bits (xoshiro128, xoroshiro128), all exponents are halved: rank,
+    // thread and substream must stay below 2^32, and a stream must not draw more than 2^32 numbers.
+    // Streams never overlap (as long as no stream draws more than 2^64 numbers), and the stream of
+    // an address does not depend on how many ranks, threads or substreams there are.
+    // Stream() costs O(log) products of polynomials plus one application of the jump polynomial.
+    // Addresses beyond these bounds would alias other streams; Stream and ThreadStates report them
+    // as errors.
+    //
+    // Keyed streams, e.g., one per simulated entity, use the upper half of the rank range:
+    // Stream(key) is rank 2^63 + (StreamId(key) mod 2^63). Application ranks must stay below 2^63
+    // (below 2^31 for 128 state bits).
+    template<typename Engine_T = Xoshiro256Plus>
+    class StreamPartition
+    {
+    public:
+
+        using Engine     = Engine_T;
+        using state_type = typename Engine::state_type;
+        using UInt       = std::uint64_t;
+
+        // Exponent of the substream size: 64 for 256 state bits, 32 for 128 state bits.
+        static constexpr std::size_t level_bits = 2 * sizeof(state_type);
+
+        explicit StreamPartition( const UInt global_seed_ )
+        :   global_seed ( global_seed_ )
+        ,   root        ( Engine( global_seed_ ).State() )
+        {}
+
+        UInt GlobalSeed() const
+        {
+            return global_seed;
+        }
+
+        // Whether each of rank, thread and substream is below 2^level_bits. For 256 state bits, every
+        // address is valid.
+        static constexpr bool ValidAddress( const UInt rank, const UInt thread, const UInt substream )
+        {
+            if constexpr ( level_bits < 64 )
+            {
+                constexpr UInt bound = UInt(1) << level_bits;
+
+                return (rank < bound) && (thread < bound) && (substream < bound);
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        // For an invalid address, the error is reported and the stream of the address with each
+        // level reduced modulo 2^level_bits is returned, i.e., one that belongs to another address.
+        Engine Stream( const UInt rank, const UInt thread = 0, const UInt substream = 0 ) const
+        {
+            if( !ValidAddress( rank, thread, substream ) )
+            {
+                eprint(ClassName()+"::Stream: Address ("+ToString(rank)+","+ToString(thread)+","+ToString(substream)+") exceeds 2^"+ToString(level_bits)+" in some level, so it aliases another stream.");
+            }
+
+            Engine random_engine ( root );
+
+            using J = JumpAhead<Engine>;
+
+            const typename J::Distance N = J::Add(
+                J::Add( J::Shifted( substream, level_bits ), J::Shifted( thread, 2 * level_bits ) ),
+                J::Shifted( rank, 3 * level_bits )
+            );
+
+            J::Get().Jump( random_engine, N );
+
+            return random_engine;
+        }
+
+        Engine Stream( std::string_view key, const UInt substream = 0 ) const
+        {
+            const UInt high_bit = UInt(1) << (level_bits - 1);
+
+            const UInt keyed_rank = high_bit | (StreamId(key) & (high_bit - 1));
+
+            return Stream( keyed_rank, 0, substream );
+        }
+
+        // Writes the states of count consecutive threads of one rank, starting with first_thread.
+        // Only the first state needs the full jump-ahead; the others follow by jumps of 2^128
+        // (2^64 for 128 state bits). If a thread would exceed 2^level_bits, the error is reported
+        // and nothing is written.
+        void ThreadStates( const UInt rank, const UInt first_thread, state_type * states, const std::size_t count ) const
+        {
+            if( count == 0 )
+            {
+                return;
+            }
+
+            const UInt last_thread = first_thread + static_cast<UInt>(count - 1);
+
+            if( (last_thread < first_thread) || !ValidAddress( rank, last_thread, 0 ) )
+            {
+                eprint(ClassName()+"::ThreadStates: Threads "+ToString(first_thread)+",...,"+ToString(first_thread)+" + "+ToString(count - 1)+" of rank "+ToString(rank)+" exceed 2^"+ToString(level_bits)+", so they alias other streams.");
+                return;
+            }
+
+            Engine random_engine = Stream( rank, first_thread );
+
+            states[0] = random_engine.State();
+
+            const auto & J = JumpAhead<Engine>::Get().PowerOfTwo(2 * level_bits);
+
+            for( std::size_t i = 1; i < count; ++i )
+            {
+                JumpAhead<Engine>::Apply( random_engine, J );
+                states[i] = random_engine.State();
+            }
+        }
+
+        std::string ClassName() const
+        {
+            return std::string("StreamPartition<")+Engine::ClassName()+">";
+        }
+
+    private:
+
+        const UInt global_seed;
+
+        const state_type root;
+    };
+}
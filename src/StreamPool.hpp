@@ -0,0 +1,243 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <random>
+
+namespace Randomizor
+{
+    using namespace Tools;
+    
+    // Hands out disjoint random engines to threads on demand.
+    //
+    // The constructor precomputes a table of capacity engine states, each one Jump() (2^128 steps
+    // for xoshiro256) ahead of the previous one. Acquire() takes the next unused entry with a single
+    // atomic increment or reuses a returned one from a lock-free free list. Every engine lives in its
+    // own cache line, so threads that draw from neighbouring streams do not slow each other down by
+    // false sharing.
+    //
+    // A returned engine keeps its current state, so a later owner continues the sequence where the
+    // previous one stopped and never repeats numbers.
+    template<typename Engine_T = Xoshiro256Plus>
+    class StreamPool
+    {
+    public:
+
+        using Engine     = Engine_T;
+        using state_type = typename Engine::state_type;
+
+        // Owns one stream of the pool as long as it lives; gives it back on destruction.
+        class Handle
+        {
+        public:
+
+            Handle() = default;
+
+            Handle( StreamPool * pool_, const std::uint32_t index_ )
+            :   pool  ( pool_  )
+            ,   index ( index_ )
+            {}
+
+            Handle( Handle && other ) noexcept
+            :   pool  ( other.pool  )
+            ,   index ( other.index )
+            {
+                other.pool = nullptr;
+            }
+
+            Handle & operator=( Handle && other ) noexcept
+            {
+                if( this != &other )
+                {
+                    Release();
+                    pool  = other.pool;
+                    index = other.index;
+                    other.pool = nullptr;
+                }
+                return *this;
+            }
+
+            Handle( const Handle & ) = delete;
+            Handle & operator=( const Handle & ) = delete;
+
+            ~Handle()
+            {
+                Release();
+            }
+
+            bool Valid() const
+            {
+                return pool != nullptr;
+            }
+
+            std::uint32_t Index() const
+            {
+                return index;
+            }
+
+            Engine & operator*() const
+            {
+                return pool->streams[index].engine;
+            }
+
+            Engine * operator->() const
+            {
+                return &pool->streams[index].engine;
+            }
+
+            void Release()
+            {
+                if( pool != nullptr )
+                {
+                    pool->Release( index );
+                    pool = nullptr;
+                }
+            }
+
+        private:
+
+            StreamPool * pool = nullptr;
+
+            std::uint32_t index = 0;
+        };
+
+        explicit StreamPool( const state_type & seed, const std::size_t capacity_ = 1024 )
+        :   capacity   ( capacity_ )
+        ,   streams    ( new Stream [capacity_] )
+        ,   next_free  ( new std::atomic<std::uint32_t> [capacity_] )
+        {
+            Engine seeder ( seed );
+
+            for( std::size_t i = 0; i < capacity; ++i )
+            {
+                seeder.Jump();
+                streams[i].engine.SetState( seeder.State() );
+                next_free[i].store( 0, std::memory_order_relaxed );
+            }
+        }
+
+        explicit StreamPool( const std::size_t capacity_ = 1024 )
+        :   StreamPool( RandomSeed(), capacity_ )
+        {}
+
+        StreamPool( const StreamPool & ) = delete;
+        StreamPool & operator=( const StreamPool & ) = delete;
+
+        std::size_t Capacity() const
+        {
+            return capacity;
+        }
+
+        // Returns an invalid handle if all streams are in use.
+        Handle Acquire()
+        {
+            std::uint32_t index;
+
+            if( PopFree( index ) )
+            {
+                return Handle( this, index );
+            }
+
+            const std::size_t i = handed_out.fetch_add( 1, std::memory_order_relaxed );
+
+            if( i < capacity )
+            {
+                return Handle( this, static_cast<std::uint32_t>(i) );
+            }
+
+            eprint("StreamPool::Acquire: All "+ToString(capacity)+" streams are in use.");
+
+            return Handle();
+        }
+
+    private:
+
+        struct alignas(64) Stream
+        {
+            Engine engine { state_type{} };
+        };
+
+        static state_type RandomSeed()
+        {
+            std::random_device r;
+
+            state_type seed;
+            {
+                std::uint32_t* seed_ = reinterpret_cast<std::uint32_t*>(&seed);
+                for( std::size_t i = 0; i < sizeof(state_type) / sizeof(std::uint32_t); ++i )
+                {
+                    seed_[i] = r();
+                }
+            }
+
+            return seed;
+        }
+
+        // The free list is a Treiber stack of indices. free_top packs a tag (against ABA) into the
+        // upper 32 bits and index + 1 (0 meaning empty) into the lower 32 bits.
+        bool PopFree( std::uint32_t & index )
+        {
+            std::uint64_t top = free_top.load( std::memory_order_acquire );
+
+            while( (top & 0xFFFFFFFFull) != 0 )
+            {
+                const std::uint32_t i = static_cast<std::uint32_t>(top & 0xFFFFFFFFull) - 1;
+
+                const std::uint64_t new_top = (((top >> 32) + 1) << 32)
+                                            | next_free[i].load( std::memory_order_relaxed );
+
+                if( free_top.compare_exchange_weak(
+                        top, new_top, std::memory_order_acq_rel, std::memory_order_acquire
+                    )
+                )
+                {
+                    index = i;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void Release( const std::uint32_t index )
+        {
+            std::uint64_t top = free_top.load( std::memory_order_relaxed );
+
+            while( true )
+            {
+                next_free[index].store( static_cast<std::uint32_t>(top & 0xFFFFFFFFull), std::memory_order_relaxed );
+
+                const std::uint64_t new_top = (((top >> 32) + 1) << 32) | (std::uint64_t(index) + 1);
+
+                if( free_top.compare_exchange_weak(
+                        top, new_top, std::memory_order_release, std::memory_order_relaxed
+                    )
+                )
+                {
+                    return;
+                }
+            }
+        }
+
+    private:
+
+        const std::size_t capacity;
+
+        std::unique_ptr<Stream[]> streams;
+
+        std::unique_ptr<std::atomic<std::uint32_t>[]> next_free;
+
+        alignas(64) std::atomic<std::size_t> handed_out { 0 };
+
+        alignas(64) std::atomic<std::uint64_t> free_top { 0 };
+    };
+
+    // The pool from which ThreadLocalEngine<Engine>() draws; one per engine type.
+    template<typename Engine = Xoshiro256Plus>
+    inline StreamPool<Engine> & DefaultStreamPool()
+    {
+        static StreamPool<Engine> pool ( 4096 );
+
+        return pool;
+    }
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+#if defined(__APPLE__)
+    #include <sys/sysctl.h>
+#endif
+
+#include <unistd.h>
+
+#include "Dispatch.hpp"
+
+namespace Randomizor
+{
+    // Non-temporal ("streaming") stores for fills that are larger than the last-level cache.
+    //
+    // An ordinary store first reads the destination cache line into the cache (read-for-ownership)
+    // and then overwrites it. For a reservoir that does not fit into the cache, this doubles the
+    // memory traffic and evicts everybody else's working set. Streaming stores write whole lines
+    // through write-combining buffers instead. So the kernels generate into a small buffer that
+    // stays in L1 and StreamStore moves it to its destination with streaming stores.
+    // On targets without such stores (e.g., ARM), StreamStore is an ordinary copy.
+
+    // Size of the last-level cache in bytes (the largest data or unified cache the system reports).
+    inline std::size_t LastLevelCacheSize()
+    {
+        static const std::size_t size = []()
+        {
+            long result = 0;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+            result = std::max( result, ::sysconf(_SC_LEVEL3_CACHE_SIZE) );
+#endif
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+            result = std::max( result, ::sysconf(_SC_LEVEL2_CACHE_SIZE) );
+#endif
+#if defined(__APPLE__)
+            for( const char * name : { "hw.l3cachesize", "hw.l2cachesize" } )
+            {
+                std::int64_t value = 0;
+                std::size_t  len   = sizeof(value);
+
+                if( ::sysctlbyname( name, &value, &len, nullptr, 0 ) == 0 )
+                {
+                    result = std::max( result, static_cast<long>(value) );
+                }
+            }
+#endif
+            // Unknown: assume a typical server LLC.
+            return (result > 0) ? static_cast<std::size_t>(result) : (std::size_t(32) << 20);
+        }();
+
+        return size;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+
+    // Copies src[0],...,src[n-1] to dst with streaming stores of width floats. The head and tail
+    // that do not fill an aligned vector are stored normally. Like the kernel variants of
+    // Dispatch.hpp, each variant carries a target attribute, so that one binary uses the widest
+    // stores of the machine it runs on.
+    #define RANDOMIZOR_STREAM_STORE_VARIANT( name, attribute, width, stream, loadu )                \
+    attribute inline void name( float * restrict dst, const float * restrict src, const std::size_t n ) \
+    {                                                                                               \
+        std::size_t i = 0;                                                                          \
+                                                                                                    \
+        while( (i < n) && (reinterpret_cast<std::uintptr_t>(&dst[i]) % (width * sizeof(float)) != 0) ) \
+        {                                                                                           \
+            dst[i] = src[i];                                                                        \
+            ++i;                                                                                    \
+        }                                                                                           \
+                                                                                                    \
+        for( ; i + width <= n; i += width )                                                         \
+        {                                                                                           \
+            stream( &dst[i], loadu( &src[i] ) );                                                    \
+        }                                                                                           \
+                                                                                                    \
+        for( ; i < n; ++i )                                                                         \
+        {                                                                                           \
+            dst[i] = src[i];                                                                        \
+        }                                                                                           \
+    }
+
+    RANDOMIZOR_STREAM_STORE_VARIANT( StreamStore_SSE2,   __attribute__((target("sse2"))),     4, _mm_stream_ps,    _mm_loadu_ps    )
+    RANDOMIZOR_STREAM_STORE_VARIANT( StreamStore_AVX,    __attribute__((target("avx"))),      8, _mm256_stream_ps, _mm256_loadu_ps )
+    RANDOMIZOR_STREAM_STORE_VARIANT( StreamStore_AVX512, __attribute__((target("avx512f"))), 16, _mm512_stream_ps, _mm512_loadu_ps )
+
+    #undef RANDOMIZOR_STREAM_STORE_VARIANT
+
+#endif
+
+    using StreamStore_T = void (*)( float *, const float *, std::size_t );
+
+    // The widest streaming store for the ISA that SelectISA() picks, resolved once.
+    inline StreamStore_T StreamStoreFunction()
+    {
+        static const StreamStore_T f = []() -> StreamStore_T
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            switch( SelectISA() )
+            {
+                case ISA::AVX512: return StreamStore_AVX512;
+                case ISA::AVX2:   return StreamStore_AVX;
+                default:          return StreamStore_SSE2;
+            }
+#else
+            return []( float * dst, const float * src, const std::size_t n )
+            {
+                std::memcpy( dst, src, n * sizeof(float) );
+            };
+#endif
+        }();
+
+        return f;
+    }
+
+    // Copies src[0],...,src[n-1] to dst with streaming stores. The head and tail that do not fill
+    // an aligned vector are stored normally. Call StreamStoreFence() before others read dst.
+    inline void StreamStore( float * restrict dst, const float * restrict src, const std::size_t n )
+    {
+        StreamStoreFunction()( dst, src, n );
+    }
+
+    // Orders the streaming stores of the calling thread before its subsequent stores.
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("sse2"))) inline void StreamStoreFence()
+    {
+        _mm_sfence();
+    }
+#else
+    inline void StreamStoreFence()
+    {
+    }
+#endif
+
+    // Calls kernel( random_engine, pointer, count, offset ) if the kernel takes the offset of
+    // pointer[0] in the whole fill (e.g., to read per-element parameters), and
+    // kernel( random_engine, pointer, count ) otherwise. The pointer need not point into the
+    // destination: Streaming_Kernel passes its buffer.
+    template<typename Kernel_T, typename Engine, typename T>
+    force_inline void InvokeKernel(
+        Kernel_T && kernel, Engine & random_engine, T * pointer, const std::size_t count, const std::size_t offset
+    )
+    {
+        if constexpr ( std::is_invocable_v<Kernel_T &, Engine &, T *, std::size_t, std::size_t> )
+        {
+            kernel( random_engine, pointer, count, offset );
+        }
+        else
+        {
+            (void)offset;
+
+            kernel( random_engine, pointer, count );
+        }
+    }
+
+    // Runs the kernel (see InvokeKernel) on a[0],...,a[n-1], the elements offset,...,offset + n - 1
+    // of the fill, through an L1-resident buffer and streams the result to a. The buffer size is
+    // even, so the pair-producing kernels consume exactly the same random numbers as when they
+    // write to a directly.
+    template<typename Engine, typename Kernel_T>
+    void Streaming_Kernel(
+        Kernel_T && kernel, Engine & random_engine, float * restrict a, const std::size_t n, const std::size_t offset = 0
+    )
+    {
+        constexpr std::size_t buffer_size = 2048;
+
+        alignas(64) float buffer [buffer_size];
+
+        for( std::size_t i = 0; i < n; i += buffer_size )
+        {
+            const std::size_t m = std::min( buffer_size, n - i );
+
+            InvokeKernel( kernel, random_engine, &buffer[0], m, offset + i );
+
+            StreamStore( &a[i], &buffer[0], m );
+        }
+
+        StreamStoreFence();
+    }
+}
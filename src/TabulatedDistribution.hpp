@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // A continuous distribution given by a table, sampled by inversion of its CDF.
+    //
+    // SetCDF takes knots x[0] < ... < x[m-1] and the values F[0] <= ... <= F[m-1] of the CDF there;
+    // SetPDF takes the values of the density instead and integrates it by the trapezoidal rule.
+    // Both normalize the CDF to [0,1]. The inverse CDF is interpolated on every interval
+    // [F[i],F[i+1]], either linearly (a piecewise constant density) or by a monotone cubic
+    // Hermite spline: with Fritsch–Butland slopes for a tabulated CDF, and with the slopes
+    // 1/pdf, limited to keep the spline monotone, for a tabulated density.
+    //
+    // Sample( u ) finds the interval with a guide table (Chen and Asau, 1974): guide[k] is the
+    // last interval that starts at or below k / G, so that a lookup starts at most a few intervals
+    // before the right one, and the expected cost is constant, whatever the shape of the CDF. The
+    // splines are stored per interval as polynomials in the local coordinate t in [0,1); their
+    // evaluation uses std::fma throughout, so that it gives the same result on every ISA level.
+    //
+    // The construction runs on a ThreadPool in blocks of block_size knots, also the prefix sum
+    // of the trapezoids: block sums, a serial scan over the blocks, and a second pass.
+    class TabulatedDistribution
+    {
+    public:
+
+        enum class Interpolation
+        {
+            Linear,
+            Cubic
+        };
+
+        static constexpr std::size_t block_size = 1 << 16;
+
+        // The inverse CDF on one interval: x = x0 + t * (c1 + t * (c2 + t * c3)) with
+        // t = (u - F) * inv_h.
+        struct Segment
+        {
+            double F;
+            double inv_h;
+            double x0;
+            double c1;
+            double c2;
+            double c3;
+        };
+
+        TabulatedDistribution() = default;
+
+        bool SetCDF(
+            const double * x, const double * F, const std::size_t m,
+            const Interpolation interpolation = Interpolation::Cubic, const std::size_t thread_count = 1
+        )
+        {
+            ThreadPool pool ( thread_count );
+
+            if( !CheckKnots( pool, x, m, "SetCDF" ) )
+            {
+                return false;
+            }
+
+            std::vector<double> cdf ( F, F + m );
+
+            if( !Normalize( pool, cdf, "SetCDF" ) )
+            {
+                return false;
+            }
+
+            // Fritsch–Butland: the harmonic mean of the neighbouring secants, in terms of the
+            // inverse secants s = h / dx, which stay finite where the CDF is flat.
+            std::vector<double> slope ( m );
+
+            ParallelBlocks( pool, m, [&]( const std::size_t begin, const std::size_t end )
+            {
+                for( std::size_t i = begin; i < end; ++i )
+                {
+                    const double s_left  = (i > 0    ) ? InverseSecant( x, cdf, i - 1 ) : InverseSecant( x, cdf, i     );
+                    const double s_right = (i < m - 1) ? InverseSecant( x, cdf, i     ) : InverseSecant( x, cdf, i - 1 );
+
+                    const double s = s_left + s_right;
+
+                    slope[i] = (s > 0) ? 2. / s : 0.;
+                }
+            });
+
+            Build( pool, x, cdf, slope, interpolation );
+
+            return true;
+        }
+
+        bool SetPDF(
+            const double * x, const double * pdf, const std::size_t m,
+            const Interpolation interpolation = Interpolation::Cubic, const std::size_t thread_count = 1
+        )
+        {
+            ThreadPool pool ( thread_count );
+
+            if( !CheckKnots( pool, x, m, "SetPDF" ) )
+            {
+                return false;
+            }
+
+            for( std::size_t i = 0; i < m; ++i )
+            {
+                if( !(pdf[i] >= 0) || !std::isfinite( pdf[i] ) )
+                {
+                    eprint("TabulatedDistribution::SetPDF: pdf["+ToString(i)+"] = "+ToString(pdf[i])+" is not a finite nonnegative number.");
+                    return false;
+                }
+            }
+
+            // cdf[i+1] = sum of the trapezoids up to x[i+1]; first the sums per block, then a serial
+            // scan over the blocks, then the running sums inside every block.
+            std::vector<double> cdf ( m, 0. );
+
+            const std::size_t block_count = (m - 1 + block_size - 1) / block_size;
+
+            std::vector<double> block_sum ( block_count + 1, 0. );
+
+            pool.ParallelFor( block_count, [&]( const std::size_t b, const std::size_t thread )
+            {
+                (void)thread;
+
+                const std::size_t end = std::min( m - 1, block_size * (b + 1) );
+
+                double sum = 0;
+
+                for( std::size_t i = block_size * b; i < end; ++i )
+                {
+                    sum += 0.5 * (pdf[i] + pdf[i+1]) * (x[i+1] - x[i]);
+                }
+
+                block_sum[b+1] = sum;
+            });
+
+            for( std::size_t b = 0; b < block_count; ++b )
+            {
+                block_sum[b+1] += block_sum[b];
+            }
+
+            pool.ParallelFor( block_count, [&]( const std::size_t b, const std::size_t thread )
+            {
+                (void)thread;
+
+                const std::size_t end = std::min( m - 1, block_size * (b + 1) );
+
+                double sum = block_sum[b];
+
+                // The running sum may differ from block_sum[b+1] by rounding; capping it keeps the
+                // CDF nondecreasing across the block boundary.
+                for( std::size_t i = block_size * b; i < end; ++i )
+                {
+                    sum += 0.5 * (pdf[i] + pdf[i+1]) * (x[i+1] - x[i]);
+
+                    cdf[i+1] = std::min( sum, block_sum[b+1] );
+                }
+
+                cdf[end] = block_sum[b+1];
+            });
+
+            if( !Normalize( pool, cdf, "SetPDF" ) )
+            {
+                return false;
+            }
+
+            const double total = block_sum[block_count];
+
+            // The slope of the inverse CDF is 1/pdf, with pdf normalized like the CDF. Limiting it to
+            // three times the neighbouring secants keeps the spline monotone (Fritsch and Carlson).
+            std::vector<double> slope ( m );
+
+            ParallelBlocks( pool, m, [&]( const std::size_t begin, const std::size_t end )
+            {
+                for( std::size_t i = begin; i < end; ++i )
+                {
+                    const double s_left  = (i > 0    ) ? InverseSecant( x, cdf, i - 1 ) : InverseSecant( x, cdf, i     );
+                    const double s_right = (i < m - 1) ? InverseSecant( x, cdf, i     ) : InverseSecant( x, cdf, i - 1 );
+
+                    const double s_max = std::max( s_left, s_right );
+
+                    const double f = pdf[i] / total;
+
+                    slope[i] = (s_max > 0) ? 3. / std::max( s_max, 3. * f ) : 0.;
+                }
+            });
+
+            Build( pool, x, cdf, slope, interpolation );
+
+            return true;
+        }
+
+        bool Empty() const
+        {
+            return segments.empty();
+        }
+
+        std::size_t KnotCount() const
+        {
+            return F.size();
+        }
+
+        // Index of the interval that contains u in [0,1).
+        force_inline std::size_t Find( const double u ) const
+        {
+            std::size_t i = guide[ std::min( static_cast<std::size_t>( u * guide_scale ), guide.size() - 1 ) ];
+
+            // The guide entry was computed with k / G, and u * G may round up to k.
+            while( (i > 0) && (F[i] > u) )
+            {
+                --i;
+            }
+
+            while( F[i+1] <= u )
+            {
+                ++i;
+            }
+
+            return i;
+        }
+
+        force_inline double Evaluate( const std::size_t i, const double u ) const
+        {
+            const Segment & s = segments[i];
+
+            const double t = (u - s.F) * s.inv_h;
+
+            return std::fma( t, std::fma( t, std::fma( t, s.c3, s.c2 ), s.c1 ), s.x0 );
+        }
+
+        // The quantile of u in [0,1).
+        force_inline double Sample( const double u ) const
+        {
+            return Evaluate( Find( u ), u );
+        }
+
+        // a[i] = Sample( u ) for the uniform u that DoubleFromBits makes of bits[i]. The lookups and
+        // the evaluations are separate loops, so that the latter vectorizes (with gathers).
+        force_inline void Transform( const std::uint64_t * restrict bits, float * restrict a, const std::size_t n ) const
+        {
+            constexpr std::size_t batch_size = 256;
+
+            std::uint32_t index [batch_size];
+
+            for( std::size_t i = 0; i < n; i += batch_size )
+            {
+                const std::size_t m = std::min( batch_size, n - i );
+
+                for( std::size_t k = 0; k < m; ++k )
+                {
+                    index[k] = static_cast<std::uint32_t>( Find( DoubleFromBits( bits[i+k] ) ) );
+                }
+
+                for( std::size_t k = 0; k < m; ++k )
+                {
+                    a[i+k] = static_cast<float>( Evaluate( index[k], DoubleFromBits( bits[i+k] ) ) );
+                }
+            }
+        }
+
+    private:
+
+        std::vector<double>  F;        // normalized CDF at the knots; F[0] = 0, F[m-1] = 1
+        std::vector<Segment> segments; // m - 1 intervals
+        std::vector<std::uint32_t> guide;
+
+        double guide_scale = 0;
+
+        template<typename Fun_T>
+        static void ParallelBlocks( ThreadPool & pool, const std::size_t n, Fun_T && fun )
+        {
+            pool.ParallelFor( (n + block_size - 1) / block_size, [&]( const std::size_t b, const std::size_t thread )
+            {
+                (void)thread;
+
+                fun( block_size * b, std::min( n, block_size * (b + 1) ) );
+            });
+        }
+
+        static double InverseSecant( const double * x, const std::vector<double> & cdf, const std::size_t i )
+        {
+            return (cdf[i+1] - cdf[i]) / (x[i+1] - x[i]);
+        }
+
+        static bool CheckKnots( ThreadPool & pool, const double * x, const std::size_t m, const std::string & tag )
+        {
+            if( m < 2 )
+            {
+                eprint("TabulatedDistribution::"+tag+": At least two knots are needed.");
+                return false;
+            }
+
+            if( m - 1 > std::numeric_limits<std::uint32_t>::max() )
+            {
+                eprint("TabulatedDistribution::"+tag+": Too many knots.");
+                return false;
+            }
+
+            std::vector<char> ok ( (m + block_size - 1) / block_size, 1 );
+
+            ParallelBlocks( pool, m, [&]( const std::size_t begin, const std::size_t end )
+            {
+                for( std::size_t i = begin; i < end; ++i )
+                {
+                    if( !std::isfinite( x[i] ) || ((i + 1 < m) && !(x[i] < x[i+1])) )
+                    {
+                        ok[begin / block_size] = 0;
+                    }
+                }
+            });
+
+            if( std::find( ok.begin(), ok.end(), 0 ) != ok.end() )
+            {
+                eprint("TabulatedDistribution::"+tag+": The knots must be finite and strictly increasing.");
+                return false;
+            }
+
+            return true;
+        }
+
+        // Maps cdf to [0,1] and checks that it is nondecreasing.
+        static bool Normalize( ThreadPool & pool, std::vector<double> & cdf, const std::string & tag )
+        {
+            const std::size_t m = cdf.size();
+
+            const double first = cdf.front();
+            const double range = cdf.back() - first;
+
+            if( !std::isfinite( range ) || !(range > 0) )
+            {
+                eprint("TabulatedDistribution::"+tag+": The distribution has no mass.");
+                return false;
+            }
+
+            std::vector<char> ok ( (m + block_size - 1) / block_size, 1 );
+
+            ParallelBlocks( pool, m, [&]( const std::size_t begin, const std::size_t end )
+            {
+                for( std::size_t i = begin; i < end; ++i )
+                {
+                    if( !std::isfinite( cdf[i] ) || ((i + 1 < m) && (cdf[i+1] < cdf[i])) )
+                    {
+                        ok[begin / block_size] = 0;
+                    }
+                }
+            });
+
+            if( std::find( ok.begin(), ok.end(), 0 ) != ok.end() )
+            {
+                eprint("TabulatedDistribution::"+tag+": The CDF must be finite and nondecreasing.");
+                return false;
+            }
+
+            ParallelBlocks( pool, m, [&]( const std::size_t begin, const std::size_t end )
+            {
+                for( std::size_t i = begin; i < end; ++i )
+                {
+                    cdf[i] = (cdf[i] - first) / range;
+                }
+            });
+
+            cdf.front() = 0.;
+            cdf.back()  = 1.;
+
+            return true;
+        }
+
+        // Makes the segments from the normalized CDF and the slopes dx/dF at the knots, and the
+        // guide table with one entry per interval.
+        void Build(
+            ThreadPool & pool, const double * x, std::vector<double> & cdf, const std::vector<double> & slope,
+            const Interpolation interpolation
+        )
+        {
+            const std::size_t m = cdf.size();
+
+            segments.resize( m - 1 );
+
+            ParallelBlocks( pool, m - 1, [&]( const std::size_t begin, const std::size_t end )
+            {
+                for( std::size_t i = begin; i < end; ++i )
+                {
+                    const double h  = cdf[i+1] - cdf[i];
+                    const double dx = x[i+1] - x[i];
+
+                    Segment & s = segments[i];
+
+                    s.F     = cdf[i];
+                    s.inv_h = (h > 0) ? 1. / h : 0.;
+                    s.x0    = x[i];
+
+                    if( (interpolation == Interpolation::Linear) || !(h > 0) )
+                    {
+                        s.c1 = dx;
+                        s.c2 = 0;
+                        s.c3 = 0;
+                    }
+                    else
+                    {
+                        // Cubic Hermite with the end slopes m0 and m1 in terms of t.
+                        const double m0 = slope[i  ] * h;
+                        const double m1 = slope[i+1] * h;
+
+                        s.c1 = m0;
+                        s.c2 = 3. * dx - 2. * m0 - m1;
+                        s.c3 = m0 + m1 - 2. * dx;
+                    }
+                }
+            });
+
+            F = std::move( cdf );
+
+            const std::size_t G = m - 1;
+
+            guide.resize( G );
+
+            guide_scale = static_cast<double>(G);
+
+            ParallelBlocks( pool, G, [&]( const std::size_t begin, const std::size_t end )
+            {
+                // Last knot i < m - 1 with F[i] <= k / G; a binary search for the first k of the
+                // block, then a walk.
+                std::size_t i = static_cast<std::size_t>(
+                    std::upper_bound( F.begin(), F.end() - 1, static_cast<double>(begin) / guide_scale ) - F.begin()
+                ) - 1;
+
+                for( std::size_t k = begin; k < end; ++k )
+                {
+                    const double u = static_cast<double>(k) / guide_scale;
+
+                    while( (i + 2 < m) && (F[i+1] <= u) )
+                    {
+                        ++i;
+                    }
+
+                    guide[k] = static_cast<std::uint32_t>(i);
+                }
+            });
+        }
+    };
+}
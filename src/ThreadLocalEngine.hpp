@@ -0,0 +1,34 @@
+#pragma once
+
+#include <random>
+
+#include "StreamPool.hpp"
+
+namespace Randomizor
+{
+    // Returns the engine of type Engine (Xoshiro256+ by default) that belongs to the calling thread.
+    // On first use, the thread acquires a stream from DefaultStreamPool<Engine>(); it gives it back when the
+    // thread exits, so that the next thread continues that stream. Later calls cost a thread_local access.
+    //
+    // If all streams of the pool are in use, the thread gets an engine of its own instead, seeded
+    // from std::random_device; it is not one of the pool's disjoint streams, but it overlaps with
+    // them only with negligible probability.
+    template<typename Engine = Xoshiro256Plus>
+    inline Engine & ThreadLocalEngine()
+    {
+        thread_local typename StreamPool<Engine>::Handle handle = DefaultStreamPool<Engine>().Acquire();
+
+        if( handle.Valid() ) [[likely]]
+        {
+            return *handle;
+        }
+
+        thread_local Engine fallback = [](){
+            std::random_device r;
+
+            return Engine( (std::uint64_t(r()) << 32) | std::uint64_t(r()) );
+        }();
+
+        return fallback;
+    }
+}
@@ -0,0 +1,461 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "NUMA.hpp"
+
+namespace Randomizor
+{
+    // A persistent pool of worker threads that processes lists of jobs with chunked work-stealing.
+    //
+    // ParallelFor( job_count, fun ) first hands each thread the same contiguous range of jobs that
+    // JobPointer(job_count,thread_count,thread) would give it. A thread works on its own range
+    // from the front. When its range is exhausted, it steals the back half of the largest range
+    // that is left. So threads that run slower (efficiency cores, hyperthreads, long rejection
+    // loops) do not keep the others waiting at the end.
+    //
+    // The calling thread takes part as thread 0, so a pool with thread_count == 1 starts no threads.
+    // ParallelFor itself does not allocate.
+    //
+    // Pin( cpus ) binds thread t to cpus[t]. The calling thread is bound only for the duration of
+    // each ParallelFor or Do and gets its previous affinity back afterwards.
+    class ThreadPool
+    {
+    public:
+
+        using Clock = std::chrono::steady_clock;
+
+        // ParallelFor splits longer job lists into portions of at most this many jobs.
+        static constexpr std::size_t max_job_count = std::size_t(0xFFFFFFFF);
+
+        struct alignas(64) ThreadStatistics
+        {
+            std::size_t call_count  = 0; // Number of calls of ParallelFor this thread took part in.
+            std::size_t job_count   = 0; // Number of jobs executed by this thread.
+            std::size_t steal_count = 0; // Number of successful steals.
+            std::size_t stolen_job_count = 0; // Number of jobs obtained by stealing.
+            double      busy_time   = 0; // Seconds spent inside jobs.
+            double      total_time  = 0; // Seconds spent inside ParallelFor.
+        };
+
+        explicit ThreadPool( const std::size_t thread_count_ = 1 )
+        :   thread_count ( thread_count_ < 1 ? 1 : thread_count_ )
+        ,   ranges       ( thread_count )
+        ,   stats        ( thread_count )
+        {
+            workers.reserve( thread_count - 1 );
+
+            for( std::size_t thread = 1; thread < thread_count; ++thread )
+            {
+                workers.emplace_back( [this,thread](){ WorkerLoop(thread); } );
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock ( mutex );
+                stop = true;
+                ++generation;
+            }
+
+            wake.notify_all();
+
+            for( auto & w : workers )
+            {
+                w.join();
+            }
+        }
+
+        ThreadPool( const ThreadPool & ) = delete;
+        ThreadPool & operator=( const ThreadPool & ) = delete;
+
+        std::size_t ThreadCount() const
+        {
+            return thread_count;
+        }
+
+        // Calls fun( job, thread ) for every job in [0,job_count), where thread is the index of the
+        // thread that executes the job. Returns after all jobs are finished.
+        // Concurrent calls from different threads are serialized.
+        template<typename F>
+        void ParallelFor( const std::size_t job_count, F && fun )
+        {
+            if( job_count == 0 )
+            {
+                return;
+            }
+
+            // Ranges store their ends in 32 bits (see Pack); larger lists run in portions.
+            if( job_count > max_job_count )
+            {
+                for( std::size_t offset = 0; offset < job_count; offset += max_job_count )
+                {
+                    ParallelForPortion(
+                        std::min( max_job_count, job_count - offset ),
+                        [&fun,offset]( const std::size_t job, const std::size_t thread )
+                        {
+                            fun( offset + job, thread );
+                        }
+                    );
+                }
+            }
+            else
+            {
+                ParallelForPortion( job_count, std::forward<F>(fun) );
+            }
+        }
+
+    private:
+
+        // ParallelFor for at most max_job_count jobs.
+        template<typename F>
+        void ParallelForPortion( const std::size_t job_count, F && fun )
+        {
+            std::lock_guard<std::mutex> call_lock ( call_mutex );
+
+            ScopedPin pin ( cpus.empty() ? -1 : cpus[0] );
+
+            if( (thread_count == 1) || (job_count == 1) )
+            {
+                const auto start = Clock::now();
+
+                for( std::size_t job = 0; job < job_count; ++job )
+                {
+                    fun( job, std::size_t(0) );
+                }
+
+                const double t = std::chrono::duration<double>(Clock::now() - start).count();
+
+                ++stats[0].call_count;
+                stats[0].job_count  += job_count;
+                stats[0].busy_time  += t;
+                stats[0].total_time += t;
+
+                return;
+            }
+
+            using F_T = std::remove_reference_t<F>;
+
+            job_fun    = const_cast<void *>(static_cast<const void *>(&fun));
+            job_invoke = []( void * f, std::size_t job, std::size_t thread )
+            {
+                (*static_cast<F_T *>(f))( job, thread );
+            };
+
+            const std::uint64_t n = static_cast<std::uint64_t>(job_count);
+
+            for( std::size_t thread = 0; thread < thread_count; ++thread )
+            {
+                const std::uint64_t begin = (n / thread_count) * thread       + (n % thread_count) * thread       / thread_count;
+                const std::uint64_t end   = (n / thread_count) * (thread + 1) + (n % thread_count) * (thread + 1) / thread_count;
+
+                ranges[thread].value.store( Pack(begin,end), std::memory_order_relaxed );
+            }
+
+            Run();
+        }
+
+    public:
+
+        // Calls fun( thread ) exactly once on each thread of the pool, e.g., to let each thread
+        // initialize memory that it will later work on.
+        template<typename F>
+        void Do( F && fun )
+        {
+            std::lock_guard<std::mutex> call_lock ( call_mutex );
+
+            ScopedPin pin ( cpus.empty() ? -1 : cpus[0] );
+
+            if( thread_count == 1 )
+            {
+                fun( std::size_t(0) );
+                return;
+            }
+
+            using F_T = std::remove_reference_t<F>;
+
+            job_fun    = const_cast<void *>(static_cast<const void *>(&fun));
+            job_invoke = []( void * f, std::size_t job, std::size_t thread )
+            {
+                (void)job;
+                (*static_cast<F_T *>(f))( thread );
+            };
+
+            broadcast = true;
+
+            Run();
+
+            broadcast = false;
+        }
+
+        // Binds thread t to the CPU cpus[t] (on Linux; elsewhere this has no effect).
+        // SpreadCPUs( ThreadCount() ) distributes the threads evenly over the NUMA nodes.
+        void Pin( const std::vector<int> & cpus_ )
+        {
+            if( cpus_.size() < thread_count )
+            {
+                eprint("ThreadPool::Pin: Need one CPU per thread.");
+                return;
+            }
+
+            Do(
+                [&]( const std::size_t thread )
+                {
+                    if( thread > 0 )
+                    {
+                        PinThisThread( cpus_[thread] );
+                    }
+                }
+            );
+
+            std::lock_guard<std::mutex> call_lock ( call_mutex );
+
+            cpus = cpus_;
+        }
+
+        // Returns a copy of the accumulated per-thread statistics.
+        std::vector<ThreadStatistics> Statistics() const
+        {
+            std::lock_guard<std::mutex> call_lock ( call_mutex );
+
+            return stats;
+        }
+
+        void ResetStatistics()
+        {
+            std::lock_guard<std::mutex> call_lock ( call_mutex );
+
+            for( auto & s : stats )
+            {
+                s = ThreadStatistics();
+            }
+        }
+
+    private:
+
+        // Wakes the workers, works as thread 0, and waits for the workers to finish.
+        void Run()
+        {
+            {
+                std::lock_guard<std::mutex> lock ( mutex );
+                busy_worker_count = thread_count - 1;
+                ++generation;
+            }
+
+            wake.notify_all();
+
+            Work(0);
+
+            {
+                std::unique_lock<std::mutex> lock ( mutex );
+                done.wait( lock, [this](){ return busy_worker_count == 0; } );
+            }
+
+            job_fun    = nullptr;
+            job_invoke = nullptr;
+        }
+
+        // A range [begin,end) of job indices, packed into a single word so that the owner and
+        // the thieves can modify it with a single compare-and-swap.
+        struct alignas(64) Range
+        {
+            std::atomic<std::uint64_t> value { 0 };
+        };
+
+        static constexpr std::uint64_t Pack( const std::uint64_t begin, const std::uint64_t end )
+        {
+            return (begin << 32) | end;
+        }
+
+        static constexpr std::uint64_t Begin( const std::uint64_t r )
+        {
+            return r >> 32;
+        }
+
+        static constexpr std::uint64_t End( const std::uint64_t r )
+        {
+            return r & 0xFFFFFFFFull;
+        }
+
+        // Takes the first job from the own range.
+        bool Pop( const std::size_t thread, std::size_t & job )
+        {
+            std::atomic<std::uint64_t> & range = ranges[thread].value;
+
+            std::uint64_t r = range.load( std::memory_order_relaxed );
+
+            while( Begin(r) < End(r) )
+            {
+                if( range.compare_exchange_weak(
+                        r, Pack(Begin(r)+1,End(r)), std::memory_order_acq_rel, std::memory_order_relaxed
+                    )
+                )
+                {
+                    job = static_cast<std::size_t>(Begin(r));
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Moves the back half of the largest foreign range into the own (empty) range.
+        bool Steal( const std::size_t thread )
+        {
+            while( true )
+            {
+                std::size_t   victim  = thread;
+                std::uint64_t largest = 0;
+                std::uint64_t r_v     = 0;
+
+                for( std::size_t i = 1; i < thread_count; ++i )
+                {
+                    const std::size_t v = (thread + i) % thread_count;
+
+                    const std::uint64_t r = ranges[v].value.load( std::memory_order_relaxed );
+
+                    if( End(r) > Begin(r) + largest )
+                    {
+                        largest = End(r) - Begin(r);
+                        victim  = v;
+                        r_v     = r;
+                    }
+                }
+
+                if( largest == 0 )
+                {
+                    return false;
+                }
+
+                const std::uint64_t take = (largest + 1) / 2;
+                const std::uint64_t mid  = End(r_v) - take;
+
+                if( ranges[victim].value.compare_exchange_strong(
+                        r_v, Pack(Begin(r_v),mid), std::memory_order_acq_rel, std::memory_order_relaxed
+                    )
+                )
+                {
+                    ranges[thread].value.store( Pack(mid,End(r_v)), std::memory_order_release );
+
+                    ++stats[thread].steal_count;
+                    stats[thread].stolen_job_count += take;
+
+                    return true;
+                }
+
+                // Somebody else modified the victim's range in the meantime; look again.
+            }
+        }
+
+        void Work( const std::size_t thread )
+        {
+            if( broadcast )
+            {
+                job_invoke( job_fun, thread, thread );
+                return;
+            }
+
+            ThreadStatistics & s = stats[thread];
+
+            const auto start = Clock::now();
+
+            double busy = 0;
+
+            std::size_t job;
+
+            do
+            {
+                while( Pop( thread, job ) )
+                {
+                    const auto job_start = Clock::now();
+
+                    job_invoke( job_fun, job, thread );
+
+                    busy += std::chrono::duration<double>(Clock::now() - job_start).count();
+
+                    ++s.job_count;
+                }
+            }
+            while( Steal( thread ) );
+
+            ++s.call_count;
+            s.busy_time  += busy;
+            s.total_time += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        void WorkerLoop( const std::size_t thread )
+        {
+            std::uint64_t seen_generation = 0;
+
+            while( true )
+            {
+                {
+                    std::unique_lock<std::mutex> lock ( mutex );
+
+                    wake.wait( lock, [&](){ return generation != seen_generation; } );
+
+                    seen_generation = generation;
+
+                    if( stop )
+                    {
+                        return;
+                    }
+                }
+
+                Work(thread);
+
+                bool last;
+                {
+                    std::lock_guard<std::mutex> lock ( mutex );
+                    last = (--busy_worker_count == 0);
+                }
+
+                if( last )
+                {
+                    done.notify_one();
+                }
+            }
+        }
+
+    private:
+
+        const std::size_t thread_count;
+
+        std::vector<Range> ranges;
+
+        std::vector<ThreadStatistics> stats;
+
+        std::vector<std::thread> workers;
+
+        void * job_fun = nullptr;
+
+        void (*job_invoke)( void *, std::size_t, std::size_t ) = nullptr;
+
+        bool broadcast = false;
+
+        std::vector<int> cpus;
+
+        mutable std::mutex call_mutex;
+
+        std::mutex mutex;
+
+        std::condition_variable wake;
+
+        std::condition_variable done;
+
+        std::uint64_t generation = 0;
+
+        std::size_t busy_worker_count = 0;
+
+        bool stop = false;
+    };
+}
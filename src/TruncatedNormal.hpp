@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+
+#include "InverseNormalCDF.hpp"
+#include "Metrics.hpp"
+
+namespace Randomizor
+{
+    // The normal distribution N(mu,sigma^2) truncated to [lower,upper], with the sampling method
+    // chosen once per parameter set. In terms of the standardized bounds alpha = (lower-mu)/sigma
+    // and beta = (upper-mu)/sigma, mirrored so that alpha + beta >= 0:
+    //
+    //  - UniformRejection if the density varies by less than a factor 2 on [alpha,beta], which
+    //    covers all narrow intervals, also far out in the tail: z uniform in [alpha,beta],
+    //    accepted with probability exp((z_min^2 - z^2)/2).
+    //  - ExponentialRejection if alpha >= 3: Robert's sampler (Statistics and Computing 5, 1995),
+    //    z = alpha + Exp(lambda) with lambda = (alpha + sqrt(alpha^2+4))/2, accepted with
+    //    probability exp(-(z-lambda)^2/2) if z <= beta. The acceptance rate tends to 1 as alpha grows.
+    //  - Inversion otherwise, i.e., in the body: z = Phi^-1 of a uniform number between Phi(alpha)
+    //    and Phi(beta), through the upper tail 1 - Phi if alpha >= 0, so that no precision is lost.
+    //
+    // The acceptance rate is at least 1/2 in every case, however extreme the truncation.
+    struct TruncatedNormal
+    {
+        enum class Method
+        {
+            Inversion,
+            UniformRejection,
+            ExponentialRejection
+        };
+
+        Method method = Method::Inversion;
+
+        double mu    = 0;
+        double sigma = 1;     // sign included: negative if the bounds were mirrored
+        double lower = -std::numeric_limits<double>::infinity();
+        double upper =  std::numeric_limits<double>::infinity();
+
+        double alpha = -std::numeric_limits<double>::infinity();
+        double beta  =  std::numeric_limits<double>::infinity();
+
+        double lambda     = 0; // ExponentialRejection
+        double z_min_sq   = 0; // UniformRejection
+        double p_begin    = 0; // Inversion: z = inversion_sign * Phi^-1( p_begin + p_width * U )
+        double p_width    = 1;
+        double inversion_sign = 1;
+
+        TruncatedNormal() = default;
+
+        // Requires sigma > 0 and lower < upper; the bounds may be infinite.
+        TruncatedNormal( const double mu_, const double sigma_, const double lower_, const double upper_ )
+        :   mu    ( mu_    )
+        ,   sigma ( sigma_ )
+        ,   lower ( lower_ )
+        ,   upper ( upper_ )
+        {
+            alpha = (lower - mu) / sigma;
+            beta  = (upper - mu) / sigma;
+
+            if( alpha + beta < 0 )
+            {
+                const double a = alpha;
+
+                alpha = -beta;
+                beta  = -a;
+                sigma = -sigma;
+            }
+
+            constexpr double sqrt1_2 = 1. / std::numbers::sqrt2;
+
+            // Now beta >= |alpha|.
+            z_min_sq = (alpha <= 0) ? 0. : alpha * alpha;
+
+            if( std::isfinite( beta ) && (0.5 * (beta * beta - z_min_sq) <= std::log(2.)) )
+            {
+                method = Method::UniformRejection;
+            }
+            else if( alpha >= 3 )
+            {
+                method = Method::ExponentialRejection;
+                lambda = 0.5 * (alpha + std::sqrt( alpha * alpha + 4. ));
+            }
+            else if( alpha >= 0 )
+            {
+                // Upper tail Q(x) = 1 - Phi(x) = erfc(x/sqrt(2))/2, and Phi^-1(1-q) = -Phi^-1(q).
+                const double q_alpha = 0.5 * std::erfc( alpha * sqrt1_2 );
+                const double q_beta  = 0.5 * std::erfc( beta  * sqrt1_2 );
+
+                method         = Method::Inversion;
+                p_begin        = q_alpha;
+                p_width        = q_beta - q_alpha;
+                inversion_sign = -1;
+            }
+            else
+            {
+                const double p_alpha = 0.5 * std::erfc( -alpha * sqrt1_2 );
+                const double p_beta  = 0.5 * std::erfc( -beta  * sqrt1_2 );
+
+                method         = Method::Inversion;
+                p_begin        = p_alpha;
+                p_width        = p_beta - p_alpha;
+                inversion_sign = 1;
+            }
+        }
+
+        // The sample for the standardized value z, clamped to [lower,upper] against rounding.
+        force_inline float Sample( const double z ) const
+        {
+            const double x = std::fma( sigma, z, mu );
+
+            return static_cast<float>( std::min( std::max( x, lower ), upper ) );
+        }
+    };
+
+    // Uniform double in (0,1), from the upper 53 bits.
+    force_inline double OpenDoubleFromBits( const std::uint64_t i ) noexcept
+    {
+        return (static_cast<double>(i >> 11) + 0.5) * 0x1.0p-53;
+    }
+
+    // Fills a[0],...,a[n-1] with samples of T. The candidates are made in batches: the engine
+    // fills the uniforms, then a branch-free loop computes the candidates and their acceptance,
+    // and the accepted ones are copied out in order. A batch is never larger than the number of
+    // samples still missing, so no candidate is thrown away, and the samples are the accepted
+    // ones of a fixed sequence of candidates, however a fill is split into calls (e.g., by
+    // Streaming_Kernel). The loops vectorize where exp and log have vector versions (e.g.,
+    // glibc's libmvec under -ffast-math).
+    //
+    // Unlike the kernels of Dispatch.hpp, this one is compiled only once: its multiply-adds could
+    // be contracted to FMAs differently at each ISA level, which would change the samples.
+    // With metrics enabled, the rejected candidates are counted once per call.
+    template<typename Engine>
+    force_inline void TruncatedNormal_Kernel( Engine & random_engine, float * restrict a, const std::size_t n, const TruncatedNormal & T )
+    {
+        constexpr std::size_t batch_size = 256;
+
+        double u [batch_size];
+        double v [batch_size];
+        double z [batch_size];
+        bool   accept [batch_size];
+
+        const bool rejection = (T.method != TruncatedNormal::Method::Inversion);
+
+        std::uint64_t rejections = 0;
+
+        std::size_t i = 0;
+
+        while( i < n )
+        {
+            const std::size_t m = std::min( batch_size, n - i );
+
+            if( rejection )
+            {
+                for( std::size_t k = 0; k < m; ++k )
+                {
+                    u[k] = OpenDoubleFromBits( Bits64( random_engine ) );
+                    v[k] = OpenDoubleFromBits( Bits64( random_engine ) );
+                }
+            }
+            else
+            {
+                for( std::size_t k = 0; k < m; ++k )
+                {
+                    u[k] = OpenDoubleFromBits( Bits64( random_engine ) );
+                }
+            }
+
+            switch( T.method )
+            {
+                case TruncatedNormal::Method::UniformRejection:
+                {
+                    const double width = T.beta - T.alpha;
+
+                    for( std::size_t k = 0; k < m; ++k )
+                    {
+                        z[k]      = T.alpha + width * u[k];
+                        accept[k] = v[k] <= std::exp( 0.5 * (T.z_min_sq - z[k] * z[k]) );
+                    }
+                    break;
+                }
+                case TruncatedNormal::Method::ExponentialRejection:
+                {
+                    for( std::size_t k = 0; k < m; ++k )
+                    {
+                        z[k] = T.alpha - std::log( u[k] ) / T.lambda;
+
+                        const double d = z[k] - T.lambda;
+
+                        accept[k] = (z[k] <= T.beta) && (v[k] <= std::exp( -0.5 * d * d ));
+                    }
+                    break;
+                }
+                default:
+                {
+                    for( std::size_t k = 0; k < m; ++k )
+                    {
+                        z[k]      = T.inversion_sign * InverseNormalCDF( T.p_begin + T.p_width * u[k] );
+                        accept[k] = true;
+                    }
+                    break;
+                }
+            }
+
+            for( std::size_t k = 0; k < m; ++k )
+            {
+                if( accept[k] )
+                {
+                    a[i++] = T.Sample( z[k] );
+                }
+                else
+                {
+                    ++rejections;
+                }
+            }
+        }
+
+        if constexpr ( metrics_enabled )
+        {
+            RANDOMIZOR_METRIC_ITERATIONS( "TruncatedNormal_Kernel", rejections );
+        }
+    }
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__APPLE__)
+    #include <sys/sysctl.h>
+#endif
+
+namespace Randomizor
+{
+    using namespace Tools;
+
+    // The machine-dependent settings of Randomizor_CPU that do not change the samples: the ISA and
+    // loop variant of the kernels (see Dispatch.hpp), the number of threads, and the thresholds
+    // for inline requests and for streaming stores. The kernel variants are bit-identical, and the
+    // thresholds only decide whether the calling thread or the pool runs the blocks of a fill and
+    // how the blocks are stored; the blocks and their streams stay the same (see Randomizor_CPU.hpp).
+    //
+    // Randomizor_CPU_T::Autotune measures them on the current machine; Save and Load keep them in a
+    // small text file, so that later runs can skip the measurement:
+    //
+    //     # Randomizor tuning profile
+    //     machine             Intel(R) Xeon(R) ... | 64 threads | 33554432 bytes LLC
+    //     isa                 avx512
+    //     kernel_variant      buffered_256_unroll_4
+    //     CPU_thread_count    32
+    //     inline_threshold    16384
+    //     streaming_threshold 67108864
+    //
+    // A profile only applies to the machine it was measured on; Load refuses others.
+    //
+    // The Metal samplers are not tuned this way: their chunk size and grid shape determine which
+    // GPU thread writes which sample, so changing them would change the samples.
+    struct TuningProfile
+    {
+        std::string machine             = MachineName();
+        ISA         isa                 = SelectISA();
+        std::size_t kernel_variant      = default_kernel_variant;
+        std::size_t CPU_thread_count    = std::max( 1u, std::thread::hardware_concurrency() );
+        std::size_t inline_threshold    = 32768;
+        std::size_t streaming_threshold = LastLevelCacheSize();
+
+        // CPU model, number of hardware threads and cache size; a profile from a machine with
+        // another name is not loaded.
+        static std::string MachineName()
+        {
+            std::string model = "unknown CPU";
+
+#if defined(__APPLE__)
+            char buffer [256] = {};
+            std::size_t len = sizeof(buffer);
+
+            if( ::sysctlbyname( "machdep.cpu.brand_string", buffer, &len, nullptr, 0 ) == 0 )
+            {
+                model = buffer;
+            }
+#else
+            std::ifstream cpuinfo ( "/proc/cpuinfo" );
+
+            std::string line;
+
+            while( std::getline( cpuinfo, line ) )
+            {
+                if( (line.rfind( "model name", 0 ) == 0) || (line.rfind( "Model", 0 ) == 0) )
+                {
+                    const std::size_t colon = line.find( ':' );
+
+                    if( colon != std::string::npos )
+                    {
+                        model = Trim( line.substr( colon + 1 ) );
+                        break;
+                    }
+                }
+            }
+#endif
+            return model
+                + " | " + std::to_string( std::thread::hardware_concurrency() ) + " threads"
+                + " | " + std::to_string( LastLevelCacheSize() ) + " bytes LLC";
+        }
+
+        std::string Text() const
+        {
+            std::stringstream s;
+
+            s << "# Randomizor tuning profile\n";
+            s << "machine             " << machine                            << "\n";
+            s << "isa                 " << ISAName( isa )                     << "\n";
+            s << "kernel_variant      " << KernelVariantName( kernel_variant ) << "\n";
+            s << "CPU_thread_count    " << CPU_thread_count                   << "\n";
+            s << "inline_threshold    " << inline_threshold                   << "\n";
+            s << "streaming_threshold " << streaming_threshold                << "\n";
+
+            return s.str();
+        }
+
+        bool Save( const std::string & path ) const
+        {
+            std::ofstream file ( path );
+
+            file << Text();
+
+            file.close();
+
+            if( !file )
+            {
+                eprint("TuningProfile::Save: Could not write "+path+".");
+                return false;
+            }
+
+            return true;
+        }
+
+        // Reads a profile written by Save. Returns false, and leaves *this unchanged, if the file
+        // cannot be read, is incomplete, or belongs to another machine, or if its ISA is not
+        // supported here.
+        bool Load( const std::string & path )
+        {
+            std::ifstream file ( path );
+
+            if( !file )
+            {
+                return false;
+            }
+
+            TuningProfile p;
+
+            std::size_t found = 0;
+
+            std::string line;
+
+            while( std::getline( file, line ) )
+            {
+                if( line.empty() || (line[0] == '#') )
+                {
+                    continue;
+                }
+
+                const std::size_t space = line.find( ' ' );
+
+                const std::string key   = line.substr( 0, space );
+                const std::string value = (space == std::string::npos) ? std::string() : Trim( line.substr( space ) );
+
+                if( key == "machine" )
+                {
+                    p.machine = value;
+                    ++found;
+                }
+                else if( key == "isa" )
+                {
+                    bool known = false;
+
+                    for( ISA isa : { ISA::Generic, ISA::AVX2, ISA::AVX512, ISA::NEON } )
+                    {
+                        if( value == ISAName( isa ) )
+                        {
+                            p.isa = isa;
+                            known = true;
+                        }
+                    }
+
+                    found += known;
+                }
+                else if( key == "kernel_variant" )
+                {
+                    for( std::size_t v = 0; v < kernel_variant_count; ++v )
+                    {
+                        if( value == KernelVariantName( v ) )
+                        {
+                            p.kernel_variant = v;
+                            ++found;
+                        }
+                    }
+                }
+                else if( key == "CPU_thread_count" )
+                {
+                    found += ParseSize( value, p.CPU_thread_count ) && (p.CPU_thread_count > 0);
+                }
+                else if( key == "inline_threshold" )
+                {
+                    found += ParseSize( value, p.inline_threshold );
+                }
+                else if( key == "streaming_threshold" )
+                {
+                    found += ParseSize( value, p.streaming_threshold );
+                }
+            }
+
+            if( found != 6 )
+            {
+                wprint("TuningProfile::Load: "+path+" is incomplete. Ignoring it.");
+                return false;
+            }
+
+            if( p.machine != MachineName() )
+            {
+                wprint("TuningProfile::Load: "+path+" was measured on another machine ("+p.machine+"). Ignoring it.");
+                return false;
+            }
+
+            if( !Supports( p.isa ) )
+            {
+                wprint("TuningProfile::Load: "+path+" uses "+ISAName(p.isa)+", which this machine does not support. Ignoring it.");
+                return false;
+            }
+
+            *this = p;
+
+            return true;
+        }
+
+    private:
+
+        static bool ParseSize( const std::string & s, std::size_t & result )
+        {
+            char * end = nullptr;
+
+            const unsigned long long x = std::strtoull( s.c_str(), &end, 10 );
+
+            if( s.empty() || (end == nullptr) || (*end != '\0') )
+            {
+                return false;
+            }
+
+            result = static_cast<std::size_t>(x);
+
+            return true;
+        }
+
+        static std::string Trim( const std::string & s )
+        {
+            const std::size_t begin = s.find_first_not_of( " \t\r" );
+            const std::size_t end   = s.find_last_not_of ( " \t\r" );
+
+            return (begin == std::string::npos) ? std::string() : s.substr( begin, end - begin + 1 );
+        }
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "InverseNormalCDF.hpp"
+#include "TruncatedNormal.hpp"
+
+namespace Randomizor
+{
+    // Sampling modes that reduce the variance of Monte Carlo estimates of means.
+    //
+    //  - Antithetic: the samples come in pairs (x, x'), with x' = 1 - x for uniform and x' = -x
+    //    for normal samples; a[2i] and a[2i+1] form a pair.
+    //  - Stratified: a[i] is uniform in the stratum [i/n, (i+1)/n) of a fill of n samples (or its
+    //    image under Phi^-1 for normal samples), so every stratum gets exactly one sample.
+    //
+    // Latin hypercube designs in d dimensions are stratified in every coordinate at once; see
+    // Randomizor_CPU_T::Fill_LatinHypercube.
+    enum class VarianceReduction
+    {
+        None,
+        Antithetic,
+        Stratified
+    };
+
+    // The float nearest to (k + u) / total for u in [0,1), moved by one ulp where rounding took it
+    // out of the stratum [k/total, (k+1)/total); in particular, it is below 1. This needs strata
+    // wider than an ulp, i.e., total < 2^23; for more strata, some samples end up in a neighbour.
+    force_inline float StratumPoint( const std::size_t k, const double u, const std::size_t total )
+    {
+        const double k_ = static_cast<double>(k);
+        const double n_ = static_cast<double>(total);
+
+        float x = static_cast<float>( (k_ + u) / n_ );
+
+        if( static_cast<double>(x) * n_ < k_ )
+        {
+            x = std::nextafter( x, 1.f );
+        }
+        else if( static_cast<double>(x) * n_ >= k_ + 1. )
+        {
+            x = std::nextafter( x, 0.f );
+        }
+
+        return x;
+    }
+
+    // Spreads the n/2 (rounded up) samples a[0],a[1],... to the antithetic pairs a[2i] = a[i],
+    // a[2i+1] = mirror( a[i] ) of n samples. Runs backwards, so that it works in place.
+    template<typename Mirror_T>
+    force_inline void AntitheticExpand( float * restrict a, const std::size_t n, Mirror_T && mirror )
+    {
+        const std::size_t h = (n + 1) / 2;
+
+        for( std::size_t i = h; i --> 0; )
+        {
+            const float x = a[i];
+
+            if( 2 * i + 1 < n )
+            {
+                a[2 * i + 1] = mirror( x );
+            }
+
+            a[2 * i] = x;
+        }
+    }
+
+    // a[i] = (first + i + u_i) / total for uniform u_i in [0,1), i.e., one sample in each of the
+    // strata first,...,first + n - 1 of total strata.
+    template<typename Engine>
+    force_inline void StratifiedUniform_Kernel(
+        Engine & random_engine, float * restrict a, const std::size_t n,
+        const std::size_t first, const std::size_t total
+    )
+    {
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            a[i] = StratumPoint( first + i, DoubleFromBits( Bits64( random_engine ) ), total );
+        }
+    }
+
+    // a[i] = Phi^-1( (first + i + u_i) / total ) for uniform u_i in (0,1).
+    template<typename Engine>
+    force_inline void StratifiedNormal_Kernel(
+        Engine & random_engine, float * restrict a, const std::size_t n,
+        const std::size_t first, const std::size_t total
+    )
+    {
+        const double scale = 1. / static_cast<double>(total);
+
+        for( std::size_t i = 0; i < n; ++i )
+        {
+            const double u = OpenDoubleFromBits( Bits64( random_engine ) );
+
+            a[i] = static_cast<float>( InverseNormalCDF( (static_cast<double>(first + i) + u) * scale ) );
+        }
+    }
+
+    // Uniform integer in [0,bound), by Lemire's multiply-and-reject method; bound > 0.
+    template<typename Engine>
+    force_inline std::uint64_t BoundedRandom( Engine & random_engine, const std::uint64_t bound )
+    {
+        unsigned __int128 product = static_cast<unsigned __int128>(Bits64( random_engine )) * bound;
+
+        std::uint64_t low = static_cast<std::uint64_t>(product);
+
+        if( low < bound )
+        {
+            const std::uint64_t threshold = (-bound) % bound;
+
+            while( low < threshold )
+            {
+                product = static_cast<unsigned __int128>(Bits64( random_engine )) * bound;
+                low     = static_cast<std::uint64_t>(product);
+            }
+        }
+
+        return static_cast<std::uint64_t>(product >> 64);
+    }
+
+    // One coordinate of a Latin hypercube design of n points in d dimensions, stored point by point:
+    // a[d * p + j] = (perm[p] + u_p) / n for a uniformly random permutation perm of 0,...,n-1
+    // (Fisher–Yates) and uniform u_p in [0,1). perm must have room for n entries.
+    template<typename Engine>
+    force_inline void LatinHypercubeCoordinate_Kernel(
+        Engine & random_engine, float * restrict a, const std::size_t n, const std::size_t d, const std::size_t j,
+        std::uint32_t * restrict perm
+    )
+    {
+        for( std::size_t p = 0; p < n; ++p )
+        {
+            perm[p] = static_cast<std::uint32_t>(p);
+        }
+
+        for( std::size_t p = n; p --> 1; )
+        {
+            std::swap( perm[p], perm[BoundedRandom( random_engine, p + 1 )] );
+        }
+
+        for( std::size_t p = 0; p < n; ++p )
+        {
+            a[d * p + j] = StratumPoint( perm[p], DoubleFromBits( Bits64( random_engine ) ), n );
+        }
+    }
+}
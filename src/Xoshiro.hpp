@@ -0,0 +1,336 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace Randomizor
+{
+    // The xoshiro / xoroshiro family of Blackman and Vigna as one template
+    // Original implementations: http://prng.di.unimi.it
+    //
+    // Xoshiro<UInt,4,S> is xoshiro128 (UInt = std::uint32_t) or xoshiro256 (UInt = std::uint64_t);
+    // Xoshiro<std::uint64_t,2,S> is xoroshiro128. The scrambler S is
+    //
+    //     Plus     : fastest; the lowest bits are weak, fine for floating-point output,
+    //     PlusPlus : full-quality integer output,
+    //     StarStar : full-quality integer output.
+    //
+    // Jump() advances by the square root of the period, LongJump() by its 3/4-th power. The jump
+    // polynomials depend only on the linear engine, not on the scrambler (except for xoroshiro128++,
+    // which uses different shift constants).
+    enum class Scrambler
+    {
+        Plus,
+        PlusPlus,
+        StarStar
+    };
+
+    template<typename UInt_T, std::size_t N, Scrambler S>
+    class Xoshiro
+    {
+        static_assert(
+            (N == 4 && (std::is_same_v<UInt_T,std::uint32_t> || std::is_same_v<UInt_T,std::uint64_t>))
+            ||
+            (N == 2 && std::is_same_v<UInt_T,std::uint64_t>),
+            "Xoshiro: Supported are xoshiro128, xoshiro256 and xoroshiro128."
+        );
+
+    public:
+
+        using UInt = UInt_T;
+
+        using state_type  = std::array<UInt,N>;
+        using result_type = UInt;
+
+        static constexpr Scrambler scrambler = S;
+
+        static constexpr std::size_t word_bits  = 8 * sizeof(UInt);
+        static constexpr std::size_t state_bits = N * word_bits;
+
+        // Jump() advances by 2^jump_exponent steps.
+        static constexpr std::size_t jump_exponent = state_bits / 2;
+
+        explicit constexpr Xoshiro(const std::uint64_t seed) noexcept
+        :   state( SeedState( seed ) )
+        {}
+
+        explicit constexpr Xoshiro(const state_type state_) noexcept
+        :   state(state_)
+        {}
+
+        constexpr result_type operator()() noexcept
+        {
+            return Step( state );
+        }
+
+        // Advances the state s by one step and returns the output. The same function is used on
+        // the structure-of-arrays states of the SIMD lanes (see Lanes.hpp).
+        force_inline static constexpr result_type Step( state_type & s ) noexcept
+        {
+            if constexpr ( N == 4 )
+            {
+                const UInt result = Scramble( s );
+
+                const UInt t = s[1] << ((word_bits == 64) ? 17 : 9);
+                s[2] ^= s[0];
+                s[3] ^= s[1];
+                s[1] ^= s[2];
+                s[0] ^= s[3];
+                s[2] ^= t;
+                s[3] = rotl( s[3], (word_bits == 64) ? 45 : 11 );
+
+                return result;
+            }
+            else
+            {
+                const UInt result = Scramble( s );
+
+                const UInt s0 = s[0];
+                const UInt s1 = s[1] ^ s0;
+
+                if constexpr ( S == Scrambler::PlusPlus )
+                {
+                    s[0] = rotl( s0, 49 ) ^ s1 ^ (s1 << 21);
+                    s[1] = rotl( s1, 28 );
+                }
+                else
+                {
+                    s[0] = rotl( s0, 24 ) ^ s1 ^ (s1 << 16);
+                    s[1] = rotl( s1, 37 );
+                }
+
+                return result;
+            }
+        }
+
+        // Equivalent to 2^jump_exponent calls to operator(); it can be used to generate
+        // 2^jump_exponent non-overlapping subsequences for parallel computations.
+        constexpr void Jump() noexcept
+        {
+            Apply( JumpPolynomial() );
+        }
+
+        // Equivalent to 2^(3/4 state_bits) calls to operator(); it can be used to generate
+        // starting points, from each of which Jump() generates non-overlapping subsequences
+        // for parallel distributed computations.
+        constexpr void LongJump() noexcept
+        {
+            Apply( LongJumpPolynomial() );
+        }
+
+        static constexpr result_type min() noexcept
+        {
+            return std::numeric_limits<result_type>::lowest();
+        }
+
+        static constexpr result_type max() noexcept
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        constexpr state_type State() const noexcept
+        {
+            return state;
+        }
+
+        constexpr void SetState(const state_type state_) noexcept
+        {
+            state = state_;
+        }
+
+        static std::string ClassName()
+        {
+            const std::string name = (N == 2)
+                ? std::string("Xoroshiro128")
+                : std::string("Xoshiro") + std::to_string(state_bits);
+
+            switch( S )
+            {
+                case Scrambler::PlusPlus: return name + "PlusPlus";
+                case Scrambler::StarStar: return name + "StarStar";
+                default:                  return name + "Plus";
+            }
+        }
+
+        friend bool operator ==(const Xoshiro& lhs, const Xoshiro& rhs) noexcept
+        {
+            return (lhs.state == rhs.state);
+        }
+
+        friend bool operator !=(const Xoshiro& lhs, const Xoshiro& rhs) noexcept
+        {
+            return (lhs.state != rhs.state);
+        }
+
+    private:
+
+        force_inline static constexpr UInt rotl( const UInt x, const int k ) noexcept
+        {
+            return (x << k) | (x >> (static_cast<int>(word_bits) - k));
+        }
+
+        force_inline static constexpr UInt Scramble( const state_type & s ) noexcept
+        {
+            // Index of the last word: s[3] for xoshiro, s[1] for xoroshiro.
+            constexpr std::size_t last = N - 1;
+
+            if constexpr ( S == Scrambler::Plus )
+            {
+                return s[0] + s[last];
+            }
+            else if constexpr ( S == Scrambler::PlusPlus )
+            {
+                constexpr int r = (N == 2) ? 17 : ((word_bits == 64) ? 23 : 7);
+
+                return rotl( s[0] + s[last], r ) + s[0];
+            }
+            else
+            {
+                return rotl( s[(N == 2) ? 0 : 1] * 5, 7 ) * 9;
+            }
+        }
+
+        static constexpr state_type SeedState( const std::uint64_t seed ) noexcept
+        {
+            const std::array<std::uint64_t,4> seq = SplitMix64{ seed }.generateSeedSequence<4>();
+
+            state_type s = {};
+
+            for( std::size_t k = 0; k < N; ++k )
+            {
+                s[k] = static_cast<UInt>( (word_bits == 64) ? seq[k] : (seq[k] >> 32) );
+            }
+
+            return s;
+        }
+
+        static constexpr state_type JumpPolynomial() noexcept
+        {
+            if constexpr ( N == 2 )
+            {
+                if constexpr ( S == Scrambler::PlusPlus )
+                {
+                    return { 0x2bd7a6a6e99c2ddc, 0x0992ccaf6a6fca05 };
+                }
+                else
+                {
+                    return { 0xdf900294d8f554a5, 0x170865df4b3201fc };
+                }
+            }
+            else if constexpr ( word_bits == 32 )
+            {
+                return { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+            }
+            else
+            {
+                return { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+            }
+        }
+
+        static constexpr state_type LongJumpPolynomial() noexcept
+        {
+            if constexpr ( N == 2 )
+            {
+                if constexpr ( S == Scrambler::PlusPlus )
+                {
+                    return { 0x360fd5f2cf8d5d99, 0x9c6e6877736c46e3 };
+                }
+                else
+                {
+                    return { 0xd2a98b26625eee7b, 0xdddf9b1090aa7ac1 };
+                }
+            }
+            else if constexpr ( word_bits == 32 )
+            {
+                return { 0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662 };
+            }
+            else
+            {
+                return { 0x76e15d3efefdcbbf, 0xc5004e441c522fb3, 0x77710069854ee241, 0x39109bb02acbe635 };
+            }
+        }
+
+        constexpr void Apply( const state_type & jump ) noexcept
+        {
+            state_type s = {};
+
+            for( std::size_t a = 0; a < N; ++a )
+            {
+                for( std::size_t b = 0; b < word_bits; ++b )
+                {
+                    if( jump[a] & static_cast<UInt>(1) << b )
+                    {
+                        for( std::size_t k = 0; k < N; ++k )
+                        {
+                            s[k] ^= state[k];
+                        }
+                    }
+                    operator()();
+                }
+            }
+
+            state = s;
+        }
+
+    private:
+
+        state_type state;
+    };
+
+    using Xoshiro256Plus       = Xoshiro<std::uint64_t,4,Scrambler::Plus    >;
+    using Xoshiro256PlusPlus   = Xoshiro<std::uint64_t,4,Scrambler::PlusPlus>;
+    using Xoshiro256StarStar   = Xoshiro<std::uint64_t,4,Scrambler::StarStar>;
+
+    using Xoshiro128Plus       = Xoshiro<std::uint32_t,4,Scrambler::Plus    >;
+    using Xoshiro128PlusPlus   = Xoshiro<std::uint32_t,4,Scrambler::PlusPlus>;
+    using Xoshiro128StarStar   = Xoshiro<std::uint32_t,4,Scrambler::StarStar>;
+
+    using Xoroshiro128Plus     = Xoshiro<std::uint64_t,2,Scrambler::Plus    >;
+    using Xoroshiro128PlusPlus = Xoshiro<std::uint64_t,2,Scrambler::PlusPlus>;
+    using Xoroshiro128StarStar = Xoshiro<std::uint64_t,2,Scrambler::StarStar>;
+
+    // Polar method for a pair of standard normal floats from 24-bit integer coordinates.
+    // Consumes 64 bits per attempt (two outputs of a 32-bit engine).
+    // Returns the number of rejected attempts.
+    template<typename Engine>
+    force_inline std::uint32_t getNormalFloatPair( Engine & random_engine, float & a, float & b )
+    {
+        std::int64_t ix;
+        std::int64_t iy;
+        std::int64_t is;
+
+        constexpr std::int64_t threshold = (std::int64_t(1) << 46);
+
+        std::uint32_t rejections = std::uint32_t(-1);
+
+        do
+        {
+            ++rejections;
+
+            const std::uint64_t bits = Bits64( random_engine );
+
+            ix = static_cast<std::int64_t>(
+                static_cast<std::int32_t>( static_cast<std::uint32_t>(bits      ) ) >> 8
+            );
+
+            iy = static_cast<std::int64_t>(
+                static_cast<std::int32_t>( static_cast<std::uint32_t>(bits >> 32) ) >> 8
+            );
+
+            is = ix * ix + iy * iy;
+        } while ( is > threshold || is == std::int64_t(0) );
+
+        const float x = 0x1.0p-23f * static_cast<float>( ix );
+        const float y = 0x1.0p-23f * static_cast<float>( iy );
+        const float s = 0x1.0p-46f * static_cast<float>( is );
+
+        const float r = std::sqrt(- 2.0f * std::log(s) / s );
+        a = r * x;
+        b = r * y;
+
+        return rejections;
+    }
+}